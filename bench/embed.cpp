@@ -0,0 +1,36 @@
+// Includes
+
+#include "cll.hpp"
+#include <chrono>
+#include <iostream>
+
+// Embedding benchmark
+// Runs small programs through one libcll interpreter the way a host would: each loads a script that calls a host
+// function, calls a function declared by it and resets the interpreter. Prints the programs run per second.
+
+static const std::string script =
+   "let scale = host_scale()\n"
+   "fn area(width, height) {\n"
+   "   return width * height * scale\n"
+   "}\n";
+
+int main() {
+   cll::Interpreter interpreter;
+   interpreter.define("host_scale", [](const std::vector<cll::Value>&) {
+      return cll::Value(2);
+   });
+
+   constexpr int programs = 20000;
+   double total = 0;
+
+   auto start = std::chrono::steady_clock::now();
+   for (int i = 0; i < programs; ++i) {
+      interpreter.load(script);
+      total += interpreter.call("area", {i, 3}).as_number();
+      interpreter.reset();
+   }
+   std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+   std::cout << "Ran " << programs << " programs in " << elapsed.count() << " s: " << programs / elapsed.count() << " programs/s\n";
+   return (total > 0 ? 0 : 1);
+}
@@ -0,0 +1,56 @@
+// Includes
+
+#include "cll.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Isolate scaling benchmark
+// Runs one libcll interpreter per thread, each loading a program and calling a function declared by it in a loop,
+// for every power of two up to the number of hardware threads. Prints the calls made per second and the speedup
+// over a single thread, which stays close to the thread count as interpreters share no state.
+
+static const std::string script =
+   "fn work(limit) {\n"
+   "   let total, index = 0, 0\n"
+   "   while index < limit {\n"
+   "      total += index % 7\n"
+   "      index++\n"
+   "   }\n"
+   "   return total\n"
+   "}\n";
+
+static double measure(unsigned threads, int calls) {
+   auto run = [calls] {
+      cll::Interpreter interpreter;
+      interpreter.load(script);
+      for (int i = 0; i < calls; ++i) {
+         interpreter.call("work", {1000});
+      }
+   };
+
+   auto start = std::chrono::steady_clock::now();
+   std::vector<std::thread> workers;
+   for (unsigned i = 0; i < threads; ++i) {
+      workers.emplace_back(run);
+   }
+   for (auto& worker : workers) {
+      worker.join();
+   }
+   std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+   return threads * calls / elapsed.count();
+}
+
+int main() {
+   unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+   double single = 0;
+
+   for (unsigned threads = 1; threads <= hardware; threads = (threads * 2 > hardware && threads != hardware ? hardware : threads * 2)) {
+      double throughput = measure(threads, 2000);
+      single = (threads == 1 ? throughput : single);
+      std::cout << threads << " threads: " << throughput << " calls/s, " << throughput / single << "x\n";
+   }
+   return 0;
+}
@@ -0,0 +1,83 @@
+// Includes
+
+#include "error.hpp"
+#include "file.hpp"
+#include "lexer.hpp"
+#include "scan.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// Lexer throughput benchmark
+// Lexes a file given as the argument, or a generated program, with every scan level the processor supports and
+// on every hardware thread, and prints the best throughput out of several runs in MB/s.
+
+static std::string generate(std::size_t size) {
+   const std::string chunk =
+      "// Sums the squares of all numbers below a limit\n"
+      "fn sum_of_squares(limit: number) -> number {\n"
+      "   let total = 0, index = 0\n"
+      "   while index < limit {\n"
+      "      total += index * index   /* squared */\n"
+      "      ++index\n"
+      "   }\n"
+      "   return total\n"
+      "}\n\n"
+      "let message = \"The sum of squares below one hundred is\", tab = \"\\t\"\n"
+      "println(message, tab, sum_of_squares(100), 'c', 0x1F, 1_000.5e-3)\n\n";
+
+   std::string code;
+   code.reserve(size + chunk.size());
+   while (code.size() < size) {
+      code += chunk;
+   }
+   return code;
+}
+
+static double measure(std::string_view code, unsigned threads, int runs) {
+   double best = 0;
+   for (int i = 0; i < runs; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      Lexer lexer (code);
+      auto& tokens = lexer.lex(threads);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      if (tokens.empty()) {
+         return 0;
+      }
+      best = std::max(best, code.size() / elapsed.count() / 1e6);
+   }
+   return best;
+}
+
+int main(int argc, char* argv[]) {
+   file::Mapping mapping;
+   std::string generated;
+   std::string_view code;
+
+   if (argc > 1) {
+      mapping = file::Mapping(argv[1]);
+      code = mapping.view();
+   } else {
+      generated = generate(16 * 1024 * 1024);
+      code = generated;
+   }
+   err::set_program_code(code);
+
+   const char* names[] {"scalar", "sse2", "avx2"};
+   std::cout << "Lexing " << code.size() / 1e6 << " MB\n";
+
+   for (auto level : {scan::Level::scalar, scan::Level::sse2, scan::Level::avx2}) {
+      if (level > scan::best_level()) {
+         break;
+      }
+
+      scan::set_level(level);
+      std::cout << names[int(level)] << ": " << measure(code, 1, 5) << " MB/s\n";
+   }
+
+   unsigned threads = std::thread::hardware_concurrency();
+   std::cout << names[int(scan::level())] << " on " << threads << " threads: " << measure(code, threads, 5) << " MB/s\n";
+   return 0;
+}
@@ -0,0 +1,66 @@
+// Includes
+
+#include "checker.hpp"
+#include "environment.hpp"
+#include "error.hpp"
+#include "functions.hpp"
+#include "inference.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "module.hpp"
+#include "parser.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Startup benchmark
+// Measures what every run pays before and around a tiny program: making the global environment and looking up every
+// builtin in it, and lexing, parsing, checking and running a script that uses builtins and properties. Prints the
+// best time of several runs in microseconds.
+
+static const std::string script =
+   "let numbers = [number(\"4\"), 2]\n"
+   "numbers.push(string(true), numbers.size())\n"
+   "let total = numbers.at(0) + numbers.last()\n";
+
+template<typename F>
+static double measure(const F& function, int iterations, int runs) {
+   double best = -1;
+   for (int i = 0; i < runs; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      for (int j = 0; j < iterations; ++j) {
+         function();
+      }
+      std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+      double time = elapsed.count() / iterations;
+      best = (best < 0 ? time : std::min(best, time));
+   }
+   return best;
+}
+
+int main() {
+   err::set_program_code(script);
+
+   auto environment = measure([] {
+      Environment global;
+      for (auto& builtin : fun::builtins) {
+         global.get_variable(std::string(builtin.name), err::nline);
+      }
+   }, 10000, 5);
+   std::cout << "Global environment: " << environment << " us\n";
+
+   auto run = measure([] {
+      Lexer lexer (script);
+      Parser parser (lexer.lex());
+      auto& program = parser.parse();
+      Checker().check(program);
+      TypeInference().analyze(program);
+
+      mod::Registry modules (".");
+      Environment global;
+      Interpreter(modules).evaluate(program, global);
+   }, 10000, 5);
+   std::cout << "Tiny script: " << run << " us\n";
+   return 0;
+}
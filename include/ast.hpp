@@ -15,7 +15,8 @@ enum class StmtType : char {
    break_stmt, continue_stmt, return_stmt, unless_stmt,
    assignment, ternary, binary, unary, member, property,
    call, args,
-   identifier, number, character, string, array, null, program
+   identifier, number, character, string, array, null, program,
+   lazy, import_stmt, try_stmt
 };
 
 constexpr std::string_view stmt_type_str[] {
@@ -23,7 +24,29 @@ constexpr std::string_view stmt_type_str[] {
    "BreakStatement", "ContinueStatement", "ReturnStatement", "UnlessStatement",
    "AssignmentExpression", "TernaryExpression", "BinaryExpression", "UnaryExpression", "MemberAccess", "PropertyAccess",
    "CallExpression", "ArgumentListExpression",
-   "IdentifierLiteral", "NumberLiteral", "CharacterLiteral", "StringLiteral", "ArrayLiteral", "NullLiteral", "Program"
+   "IdentifierLiteral", "NumberLiteral", "CharacterLiteral", "StringLiteral", "ArrayLiteral", "NullLiteral", "Program",
+   "LazyBody", "ImportStatement", "TryStatement"
+};
+
+// Static types (see TypeInference)
+
+enum class StaticType : char {
+   unknown, dynamic, null, number, character, string, boolean, array, function
+};
+
+constexpr std::string_view static_type_str[] {
+   "Unknown", "Dynamic", "Null", "Number", "Character", "String", "Boolean", "Array", "Function"
+};
+
+// Type annotation
+// Unknown means the declaration is not annotated, dynamic is the 'any' annotation
+
+struct Annotation {
+   StaticType type = StaticType::unknown;
+   StaticType element = StaticType::unknown;
+
+   bool accepts_any() const;
+   std::string str() const;
 };
 
 // Statement definition
@@ -43,11 +66,15 @@ T& get_stmt(Stmt& stmt) {
 
 struct Statement {
    StmtType type;
+   StaticType static_type = StaticType::unknown;
    int line = 0;
 
    Statement(StmtType type, int line);
    virtual ~Statement() = default;
-   virtual Stmt copy() const = 0;
+
+   // Copies keep the analysis results, clone only copies the node itself
+   Stmt copy() const;
+   virtual Stmt clone() const = 0;
 };
 
 // Statements
@@ -63,10 +90,11 @@ struct VarDeclaration : public Statement {
    static Stmt make(bool constant, std::vector<Stmt> identifiers, std::vector<Stmt> values, int line) {
       return std::make_unique<VarDeclaration>(constant, std::move(identifiers), std::move(values), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Function declaration statement
+// Anonymous functions are expressions, their identifier is a null literal
 
 struct FnDeclaration : public Statement {
    Stmt identifier;
@@ -76,12 +104,27 @@ struct FnDeclaration : public Statement {
    Stmt return_def;
    Stmt body;
    int def_args;
+   Annotation return_type;
+
+   // Parameter types seen by a profile and the body specialized for them (see TypeInference)
+   std::vector<StaticType> guards;
+   Stmt guarded_body;
+
+   // Variables of enclosing functions and blocks the body uses (see Checker). 'depth' counts the environments from
+   // the declaration to the one holding the variable, or is -1 if it is looked up by name. A function using its own
+   // name is 'recursive' instead of capturing itself.
+   struct Capture {
+      std::string identifier;
+      int depth;
+   };
+   std::vector<Capture> captures;
+   bool recursive = false;
 
    FnDeclaration(Stmt identifier, std::vector<Stmt> arguments, std::vector<Stmt> argument_def, Stmt returns, Stmt return_def, Stmt body, int def_args, int line);
    static Stmt make(Stmt identifier, std::vector<Stmt> arguments, std::vector<Stmt> argument_def, Stmt returns, Stmt return_def, Stmt body, int def_args, int line) {
       return std::make_unique<FnDeclaration>(std::move(identifier), std::move(arguments), std::move(argument_def), std::move(returns), std::move(return_def), std::move(body), def_args, line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Exists statement
@@ -93,7 +136,7 @@ struct ExistsStmt : public Statement {
    static Stmt make(Stmt identifier, int line) {
       return std::make_unique<ExistsStmt>(std::move(identifier), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Delete statement
@@ -105,7 +148,7 @@ struct DeleteStmt : public Statement {
    static Stmt make(std::vector<Stmt> identifiers, int line) {
       return std::make_unique<DeleteStmt>(std::move(identifiers), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // If-else statement
@@ -122,7 +165,7 @@ struct IfElseStmt : public Statement {
    static Stmt make(Stmt ifclause, std::vector<Stmt> elifclauses, int line) {
       return std::make_unique<IfElseStmt>(std::move(ifclause), std::move(elifclauses), std::nullopt, line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // If clause statement
@@ -136,7 +179,7 @@ struct IfClauseStmt : public Statement {
    static Stmt make(const std::string& keyword, Stmt expr, Stmt stmt, int line) {
       return std::make_unique<IfClauseStmt>(keyword, std::move(expr), std::move(stmt), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // While loop statement
@@ -150,7 +193,7 @@ struct WhileStmt : public Statement {
    static Stmt make(bool infinite, Stmt expr, Stmt stmt, int line) {
       return std::make_unique<WhileStmt>(infinite, std::move(expr), std::move(stmt), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // For loop statement
@@ -165,23 +208,29 @@ struct ForStmt : public Statement {
    static Stmt make(std::optional<Stmt> initexpr, std::optional<Stmt> condition, std::optional<Stmt> loopexpr, Stmt stmt, int line) {
       return std::make_unique<ForStmt>(std::move(initexpr), std::move(condition), std::move(loopexpr), std::move(stmt), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Break statement
 
 struct BreakStmt : public Statement {
+   // Set by the Checker when a loop of the same function encloses the statement
+   bool in_loop = false;
+
    BreakStmt(int line);
    static Stmt make(int line) { return std::make_unique<BreakStmt>(line); }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Continue statement
 
 struct ContinueStmt : public Statement {
+   // Set by the Checker when a loop of the same function encloses the statement
+   bool in_loop = false;
+
    ContinueStmt(int line);
    static Stmt make(int line) { return std::make_unique<ContinueStmt>(line); }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Return statement
@@ -193,7 +242,7 @@ struct ReturnStmt : public Statement {
    static Stmt make(Stmt value, int line) {
       return std::make_unique<ReturnStmt>(std::move(value), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Unless statement
@@ -206,7 +255,38 @@ struct UnlessStmt : public Statement {
    static Stmt make(Stmt expr, Stmt stmt, int line) {
       return std::make_unique<UnlessStmt>(std::move(expr), std::move(stmt), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
+};
+
+// Import statement
+// 'path' is the canonical path of the imported file, resolved against the directory of the importing file when
+// the modules of a program are loaded
+
+struct ImportStmt : public Statement {
+   std::string file;
+   Stmt identifier;
+   std::string path;
+
+   ImportStmt(const std::string& file, Stmt identifier, int line);
+   static Stmt make(const std::string& file, Stmt identifier, int line) {
+      return std::make_unique<ImportStmt>(file, std::move(identifier), line);
+   }
+   Stmt clone() const override;
+};
+
+// Try statement
+// Errors raised while running 'body' run 'handler' instead, with the error declared as 'identifier' if given
+
+struct TryStmt : public Statement {
+   Stmt body;
+   std::optional<Stmt> identifier;
+   Stmt handler;
+
+   TryStmt(Stmt body, std::optional<Stmt> identifier, Stmt handler, int line);
+   static Stmt make(Stmt body, std::optional<Stmt> identifier, Stmt handler, int line) {
+      return std::make_unique<TryStmt>(std::move(body), std::move(identifier), std::move(handler), line);
+   }
+   Stmt clone() const override;
 };
 
 // Expressions
@@ -222,7 +302,7 @@ struct AssignmentExpr : public Statement {
    static Stmt make(Type op, Stmt left, Stmt right, int line) {
       return std::make_unique<AssignmentExpr>(op, std::move(left), std::move(right), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Ternary expression
@@ -236,7 +316,7 @@ struct TernaryExpr : public Statement {
    static Stmt make(Stmt left, Stmt middle, Stmt right, int line) {
       return std::make_unique<TernaryExpr>(std::move(left), std::move(middle), std::move(right), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Binary expression
@@ -250,7 +330,7 @@ struct BinaryExpr : public Statement {
    static Stmt make(Type op, Stmt left, Stmt right, int line) {
       return std::make_unique<BinaryExpr>(op, std::move(left), std::move(right), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Unary expression
@@ -263,7 +343,7 @@ struct UnaryExpr : public Statement {
    static Stmt make(Type op, Stmt value, int line) {
       return std::make_unique<UnaryExpr>(op, std::move(value), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Member access expression
@@ -276,7 +356,7 @@ struct MemberAccess : public Statement {
    static Stmt make(Stmt left, Stmt key, int line) {
       return std::make_unique<MemberAccess>(std::move(left), std::move(key), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Property access expression
@@ -289,7 +369,7 @@ struct PropertyAccess : public Statement {
    static Stmt make(Stmt left, std::vector<Stmt> right, int line) {
       return std::make_unique<PropertyAccess>(std::move(left), std::move(right), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Call expression
@@ -303,7 +383,7 @@ struct CallExpr : public Statement {
       return std::make_unique<CallExpr>(std::move(args), std::move(identifier), line);
    }
 
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Argument list expression
@@ -316,7 +396,7 @@ struct ArgsListExpr : public Statement {
       return std::make_unique<ArgsListExpr>(std::move(args), line);
    }
 
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Literals
@@ -325,12 +405,13 @@ struct ArgsListExpr : public Statement {
 
 struct IdentLiteral : public Statement {
    std::string identifier;
+   Annotation annotation;
 
    IdentLiteral(const std::string& identifier, int line);
    static Stmt make(const std::string& identifier, int line) {
       return std::make_unique<IdentLiteral>(identifier, line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Number literal
@@ -343,7 +424,7 @@ struct NumberLiteral : public Statement {
       return std::make_unique<NumberLiteral>(number, line);
    }
 
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Character literal
@@ -355,7 +436,7 @@ struct CharLiteral : public Statement {
    static Stmt make(char ch, int line) {
       return std::make_unique<CharLiteral>(ch, line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // String literal
@@ -367,7 +448,7 @@ struct StringLiteral : public Statement {
    static Stmt make(const std::string& string, int line) {
       return std::make_unique<StringLiteral>(string, line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Array literal
@@ -379,7 +460,7 @@ struct ArrayLiteral : public Statement {
    static Stmt make(std::vector<Stmt> array, int line) {
       return std::make_unique<ArrayLiteral>(std::move(array), line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Null literal
@@ -389,7 +470,7 @@ struct NullLiteral : public Statement {
    static Stmt make(int line = 0) {
       return std::make_unique<NullLiteral>(line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
 };
 
 // Program (scope)
@@ -401,7 +482,21 @@ struct Program : public Statement {
    static Stmt make(int line = 0) {
       return std::make_unique<Program>(line);
    }
-   Stmt copy() const override;
+   Stmt clone() const override;
+};
+
+// Lazy body
+// Function body that was only brace-matched, its tokens from 'begin' up to 'end' are parsed by the first call
+
+struct LazyBody : public Statement {
+   std::vector<Token>* tokens;
+   size_t begin, end;
+
+   LazyBody(std::vector<Token>* tokens, size_t begin, size_t end, int line);
+   static Stmt make(std::vector<Token>* tokens, size_t begin, size_t end, int line) {
+      return std::make_unique<LazyBody>(tokens, begin, end, line);
+   }
+   Stmt clone() const override;
 };
 
 #endif
@@ -0,0 +1,23 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+// Includes
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Batch runner
+// Runs many scripts, each in a forked process of its own so that nothing one of them does reaches the others, with at
+// most a given number running at once. The output of every script is captured and printed in the order the scripts
+// were given once it and the scripts before it finished, followed by a summary of exit codes and times on stderr.
+
+namespace batch {
+   // Runs a script in the forked process and returns its exit code, errors and exit() are reported as usual
+   using Runner = std::function<int(const std::string& script)>;
+
+   // Returns the first non-zero exit code of the scripts in order, or 0
+   int run(const std::vector<std::string>& scripts, unsigned jobs, const Runner& runner);
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+// Includes
+
+#include "ast.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Cache
+// Parsed programs are stored in a compact binary form, one file per script named after the hash of its source.
+// The file also records the interpreter version, so another version sees a miss and overwrites it, and the time
+// lexing and parsing took, which a hit reports as saved.
+
+namespace cache {
+   // Directory used without --cache-dir, empty if there is no home directory
+   std::string default_directory();
+
+   // Loads the program cached for the source and the nanoseconds parsing it took, returns false if there is none
+   // or it cannot be used
+   bool load(const std::string& directory, std::string_view code, std::uint64_t hash, Program& program, std::uint64_t& parse_time);
+
+   // Stores a parsed program, a cache that cannot be written is skipped
+   void store(const std::string& directory, std::string_view code, std::uint64_t hash, const Program& program, std::uint64_t parse_time);
+
+   // A statement in the form of cached programs, for other files holding syntax trees. Writing returns false if the
+   // statement cannot be stored, reading returns null if the data at the position is not a statement, and moves the
+   // position past it otherwise.
+   bool write_stmt(std::string& data, const Stmt& stmt);
+   Stmt read_stmt(std::string_view data, std::size_t& position);
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef CHECKER_HPP
+#define CHECKER_HPP
+
+// Includes
+
+#include "ast.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Checker
+// Semantic pass run after parsing that reports errors which do not depend on how the program runs, before any of it
+// runs: jumps outside of a loop or function, invalid parameters and assignment targets, and assigning to, deleting
+// or calling with the wrong argument count a constant or function that every run resolves to.
+// Jumps inside a loop of their own function are marked, so the interpreter does not look for a loop at runtime.
+// Functions are given the variables of enclosing scopes they use, which they capture when declared.
+
+class Checker {
+   struct Constant {
+      bool function = false;
+      size_t parameters = 0;
+      int def_args = 0;
+   };
+
+   // 'declared' holds every identifier declared directly in the scope, 'constants' the constants declared before
+   // the statement being checked, which exist whenever a statement after them runs
+   struct Scope {
+      std::unordered_set<std::string> declared;
+      std::unordered_map<std::string, Constant> constants;
+   };
+
+   // Function whose body is being checked and the index of the scope of its body
+   struct Frame {
+      FnDeclaration* decl;
+      size_t scope;
+   };
+
+   std::vector<Scope> scopes;
+   std::vector<Frame> frames;
+   int loops = 0, functions = 0;
+
+   // Lazily parsed bodies are checked without the scopes around them, whose variables are looked up by name
+   bool detached = false;
+
+   // Statement checking functions
+
+   void check_stmt(Stmt& stmt);
+   void check_block(std::vector<Stmt>& statements);
+   void check_statement(Stmt& stmt);
+   void check_var_decl(Stmt& stmt);
+   void check_fn_decl(Stmt& stmt);
+   void check_fn_body(FnDeclaration& decl);
+   void check_for_loop(Stmt& stmt);
+   void check_try_stmt(Stmt& stmt);
+
+   // Expression checking functions
+
+   void check_assignment(Stmt& expr);
+   void check_unary_expr(Stmt& expr);
+   void check_call_expr(Stmt& expr);
+
+   // Utility functions
+
+   void declare(Scope& scope, const Stmt& stmt);
+   const Constant* resolve(const std::string& identifier) const;
+   int scope_of(const std::string& identifier) const;
+   void use(const std::string& identifier);
+
+public:
+   // Check functions
+
+   Checker();
+   void check(Program& program);
+   void check(Stmt& stmt);
+   void check(FnDeclaration& decl);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef CLL_HPP
+#define CLL_HPP
+
+// Includes
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Embedding API
+// Public header of libcll, the interpreter as a library. An interpreter loads any number of programs into one global
+// environment and calls their functions by name, without starting a process for each of them. Resetting it drops
+// everything the programs declared, functions defined by the host are kept.
+// Errors programs do not catch are thrown to the host as cll::Error, and exit() throws cll::Exit. The interpreter
+// stays usable, what a program declared before it failed is kept.
+
+namespace cll {
+   // Value passed between the host and programs, functions and modules cannot be passed
+   class Value {
+   public:
+      using Array = std::vector<Value>;
+
+      Value(std::nullptr_t = nullptr);
+      Value(bool boolean);
+      Value(int number);
+      Value(double number);
+      Value(char ch);
+      Value(const char* string);
+      Value(std::string string);
+      Value(Array array);
+
+      bool is_null() const;
+      bool is_bool() const;
+      bool is_number() const;
+      bool is_char() const;
+      bool is_string() const;
+      bool is_array() const;
+
+      // Throw std::bad_variant_access if the value holds another type
+      bool as_bool() const;
+      double as_number() const;
+      char as_char() const;
+      const std::string& as_string() const;
+      const Array& as_array() const;
+
+      // Value as printed by programs
+      std::string str() const;
+
+   private:
+      std::variant<std::nullptr_t, bool, double, char, std::string, Array> value;
+   };
+
+   // Error raised by a program and not caught by it, 'line' is -1 if the error has none and 'file' is empty for
+   // programs loaded as code
+   class Error : public std::runtime_error {
+   public:
+      int line, code;
+      std::string file;
+
+      Error(const std::string& message, int line, int code, std::string file);
+   };
+
+   // Thrown when a program calls exit()
+   struct Exit {
+      int code;
+   };
+
+   // Limits of every load and call, zero is unlimited. Steps are loop iterations and calls, memory is how much the
+   // values made since the load or call started hold, in bytes. Exceeding one raises an error programs can catch.
+   struct Budget {
+      std::uint64_t steps = 0, memory = 0, milliseconds = 0;
+   };
+
+   // Exceptions derived from std::exception thrown by host functions are raised as errors programs can catch
+   using HostFunction = std::function<Value(const std::vector<Value>& args)>;
+
+   class Interpreter {
+      struct State;
+      std::unique_ptr<State> state;
+
+   public:
+      Interpreter();
+      Interpreter(Interpreter&& other) noexcept;
+      Interpreter& operator=(Interpreter&& other) noexcept;
+      ~Interpreter();
+
+      // Declares a constant function every program can call, kept across resets. Defining a name twice throws an error
+      void define(const std::string& name, HostFunction function);
+
+      // Lexes, parses and checks a program, then runs its top-level statements. What it declares is visible to the
+      // programs loaded after it. Imports of code are resolved against the working directory, those of a file
+      // against its directory.
+      void load(const std::string& code);
+      void load_file(const std::string& path);
+
+      // Variables declared by the loaded programs or the host
+      bool exists(const std::string& name) const;
+      Value get(const std::string& name) const;
+      Value call(const std::string& name, const std::vector<Value>& args = {});
+
+      // Drops every program loaded and everything declared since the interpreter was made or last reset
+      void reset();
+
+      // Budget of the loads and calls made after it is set, kept across resets
+      void set_budget(const Budget& budget);
+   };
+}
+
+#endif
@@ -4,31 +4,83 @@
 // Includes
 
 #include "values.hpp"
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
+// Cell
+// Variable captured by a closure, shared by the environment declaring it and the closure's. The cell of a variable
+// declared after the closure was made holds no value until then.
+
+struct Cell {
+   Value value;
+   Annotation annotation;
+   bool constant = false;
+};
+
 // Environment
 
 class Environment {
    Environment* parent;
    std::unordered_map<std::string, Value> variables;
    std::unordered_set<std::string> constants;
+   std::unordered_map<std::string, Annotation> annotations;
+   std::unordered_map<std::string, std::shared_ptr<Cell>> cells;
+
+   // Global environments hold the constants of fun::builtins without declaring them, embedded programs have theirs
+   // below a host environment holding them instead
+   bool builtins = false;
+   bool outermost = false;
+
+   void check_annotation(const std::string& identifier, const Value& value, int line) const;
+   bool is_constant(const std::string& identifier) const;
+   Value& slot(const std::string& identifier);
+
+   Cell* find_cell(const std::string& identifier) const {
+      if (cells.empty()) {
+         return nullptr;
+      }
+      auto it = cells.find(identifier);
+      return (it != cells.end() && it->second->value ? it->second.get() : nullptr);
+   }
 
 public:
-   Environment(Environment* parent);
+   Environment(Environment* parent, bool global = false);
    Environment();
 
    // Edit functions
 
-   void declare_variable(const std::string& identifier, Value value, bool constant, int line);
+   void declare_variable(const std::string& identifier, Value value, bool constant, int line, const Annotation& annotation = {});
    void assign_variable(const std::string& identifier, Value value, int line);
    void delete_variable(const std::string& identifier, int line);
+   void assign_number(const std::string& identifier, long double number, int line);
 
    // Access functions
 
    bool variable_exists(const std::string& identifier);
    Value get_variable(const std::string& identifier, int line);
+   long double get_number(const std::string& identifier, int line);
    Environment& resolve_variable(const std::string& identifier, int line);
+   Environment* global();
+
+   // Closure functions
+
+   std::shared_ptr<Cell> capture(const std::string& identifier, int depth);
+   void bind(const std::string& identifier, std::shared_ptr<Cell> cell);
+
+   // Calls the function with every variable declared in this environment, whether it is constant and its annotation
+   template<typename F>
+   void each_variable(const F& function) const {
+      for (const auto& [identifier, value] : variables) {
+         auto annotation = annotations.find(identifier);
+         function(identifier, value, constants.count(identifier) != 0, (annotation == annotations.end() ? Annotation {} : annotation->second));
+      }
+      for (const auto& [identifier, cell] : cells) {
+         if (cell->value) {
+            function(identifier, cell->value, cell->constant, cell->annotation);
+         }
+      }
+   }
 };
 
 #endif
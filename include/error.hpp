@@ -4,15 +4,46 @@
 // Includes
 
 #include <string>
+#include <string_view>
 
 // Errors
 
 namespace err {
    constexpr int nline = -1;
 
-   void set_program_code(std::string& code);
+   // Code shown around the line of an error, 'file' is empty for the main program. Every thread has its own.
+   struct Source {
+      std::string_view code, file;
+   };
+
+   // Line of code shown around the line of an error, 'number' is 0 if there is none
+   struct Context {
+      int number = 0;
+      std::string code;
+   };
+
+   // Raised errors unwind to the innermost try statement, or to the entry point that reports them. The code around
+   // the line is copied when the error is raised, as the code it was raised in might be gone when it is reported.
+   struct Error {
+      std::string message;
+      int line, code;
+      std::string file;
+      Context previous, current, next;
+   };
+
+   // Raised by exit(), try statements do not catch it
+   struct Exit {
+      int code;
+   };
+
+   void set_program_code(std::string_view code, std::string_view file = {});
+   Source program_code();
    [[noreturn]] void raise(const std::string& msg, int line, int code = -1);
    [[noreturn]] void exit(int code = 0);
+
+   // Print the error or exit code, then end the process
+   [[noreturn]] void report(const Error& error);
+   [[noreturn]] void report(const Exit& exit);
 }
 
 #endif
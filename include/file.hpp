@@ -3,13 +3,33 @@
 
 // Includes
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 // File
 
 namespace file {
+   // Read-only memory mapping of a file, the source code is lexed directly from it
+   class Mapping {
+      const char* data = nullptr;
+      std::size_t size = 0, released = 0;
+
+   public:
+      Mapping() = default;
+      Mapping(const std::string& file);
+      Mapping(Mapping&& other) noexcept;
+      Mapping& operator=(Mapping&& other) noexcept;
+      ~Mapping();
+
+      std::string_view view() const;
+
+      // Drops the pages before offset from memory, once a streamed program was lexed past them
+      void release(std::size_t offset);
+   };
+
    bool exists(const std::string& file);
-   std::string read(const std::string& file);   
+   std::uint64_t hash(std::string_view code);
 }
 
 #endif
@@ -4,6 +4,9 @@
 // Includes
 
 #include "values.hpp"
+#include <functional>
+#include <string>
+#include <string_view>
 #include <vector>
 
 // Functions
@@ -36,6 +39,43 @@ namespace fun {
    Value number(std::vector<Value>& args, Environment* env, int line);
    Value char_(std::vector<Value>& args, Environment* env, int line);
    Value bool_(std::vector<Value>& args, Environment* env, int line);
+
+   // Snapshot functions
+   // Scripts are checkpointed by the handler of the thread running them, which is only set by the command line
+
+   extern thread_local std::function<void(const std::string& file, int line)> checkpoint_handler;
+
+   Value checkpoint(std::vector<Value>& args, Environment* env, int line);
+
+   // Builtin table
+   // Constants of every global environment. The table is constant-initialized, so nothing is allocated at startup,
+   // and values are only made when a global environment looks one up. 'call' is null for null, true and false.
+
+   using Native = Value (*)(std::vector<Value>& args, Environment* env, int line);
+
+   struct Builtin {
+      std::string_view name;
+      Native call = nullptr;
+      StaticType returns = StaticType::dynamic;
+   };
+
+   inline constexpr Builtin builtins[] {
+      {"null"}, {"true"}, {"false"},
+      {"print", print}, {"println", println}, {"printf", printf}, {"printfln", printfln}, {"format", format, StaticType::string},
+      {"raise", raise}, {"assert", assert}, {"throw", throw_}, {"exit", exit},
+      {"input", input, StaticType::string}, {"inputnum", inputnum, StaticType::number}, {"inputch", inputch, StaticType::character},
+      {"string", string, StaticType::string}, {"number", number, StaticType::number}, {"char", char_, StaticType::character}, {"bool", bool_, StaticType::boolean},
+      {"checkpoint", checkpoint, StaticType::null}
+   };
+
+   // Builtin named 'name', or null if there is none
+   const Builtin* find_builtin(std::string_view name);
+
+   // Value of a builtin, made anew for every lookup like copies of variables are
+   Value make_builtin(const Builtin& builtin);
+
+   // Static type of a builtin's value
+   StaticType builtin_type(const Builtin& builtin);
 }
 
 #endif
@@ -0,0 +1,122 @@
+#ifndef INFERENCE_HPP
+#define INFERENCE_HPP
+
+// Includes
+
+#include "profile.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Type inference
+// Flow-sensitive pass that stores the proven type of every expression in Statement::static_type.
+// Anything that cannot be proven is left dynamic and evaluated through the generic paths.
+// Annotated variables always keep their declared type, since the environment checks every value stored in them.
+
+class TypeInference {
+   struct Binding {
+      StaticType type;
+      size_t variable;
+      Annotation declared = {};
+      StaticType returns = StaticType::unknown;
+   };
+
+   struct Scope {
+      std::unordered_map<std::string, Binding> bindings;
+      std::unordered_set<std::string> tainted;
+   };
+
+   struct Flow {
+      std::vector<Scope> scopes;
+      bool reachable = true;
+   };
+
+   struct Loop {
+      size_t depth;
+      std::vector<Flow> breaks, continues;
+   };
+
+   struct Block {
+      size_t depth;
+      std::vector<Flow> returns;
+   };
+
+   struct Variable {
+      size_t context;
+      std::string identifier;
+      StaticType type;
+      int line;
+   };
+
+   Flow flow;
+   std::vector<Loop> loops;
+   std::vector<Block> blocks;
+   std::vector<Flow> tries;
+   std::unordered_set<std::string> free_assigned;
+   std::vector<StmtType> pending;
+   size_t fn_base = 0, context = 0;
+   std::string fn_name;
+   const Profile* profile;
+   StaticType fn_returns = StaticType::unknown;
+   bool stray_jumps = false, streaming = false;
+
+   std::vector<std::string> contexts {"<top-level>"};
+   std::vector<Variable> variables;
+   std::unordered_map<const Statement*, size_t> variable_index;
+   std::unordered_map<const Statement*, size_t> specialized;
+
+   // Statement analysis functions
+
+   StaticType analyze_stmt(Stmt& stmt);
+   StaticType analyze_block(Program& program, bool scoped);
+   StaticType analyze_statement(Stmt& stmt);
+   StaticType analyze_var_decl(Stmt& stmt);
+   StaticType analyze_fn_decl(Stmt& stmt);
+   std::unordered_set<std::string> analyze_fn_body(FnDeclaration& decl, Stmt& body, const std::vector<StaticType>& guards);
+   std::unordered_set<std::string> lazy_assigned(const LazyBody& body);
+   void taint(const std::unordered_set<std::string>& assigned);
+   StaticType analyze_del_stmt(Stmt& stmt);
+   StaticType analyze_if_else_stmt(Stmt& stmt);
+   StaticType analyze_while_loop(Stmt& stmt);
+   StaticType analyze_for_loop(Stmt& stmt);
+   StaticType analyze_unless_stmt(Stmt& stmt);
+   StaticType analyze_try_stmt(Stmt& stmt);
+   StaticType analyze_jump(Stmt& stmt);
+
+   // Expression analysis functions
+
+   StaticType analyze_assignment(Stmt& expr);
+   StaticType analyze_ternary_expr(Stmt& expr);
+   StaticType analyze_binary_expr(Stmt& expr);
+   StaticType analyze_unary_expr(Stmt& expr);
+   StaticType analyze_property_access(Stmt& expr);
+   StaticType analyze_call_expr(Stmt& expr);
+
+   // Utility functions
+
+   Binding* resolve(const std::string& identifier, bool& tainted);
+   StaticType type_of(const std::string& identifier);
+   StaticType element_type(const Stmt& array);
+   void declare(const Stmt& identifier, StaticType type);
+   void assign(const std::string& identifier, StaticType type, int line);
+   void remove(const std::string& identifier);
+   void record(Binding& binding, StaticType type);
+   void merge(Flow& into, const Flow& other);
+   void settle(bool unconditional);
+   void call_boundary();
+   void catchable();
+   Flow truncate(size_t depth) const;
+   bool same(const Flow& f1, const Flow& f2) const;
+
+public:
+   // Analysis functions
+
+   TypeInference(const Profile* profile = nullptr);
+   void analyze(Program& program);
+   void begin();
+   void analyze(Stmt& stmt);
+   void analyze(FnDeclaration& decl);
+   void dump() const;
+};
+
+#endif
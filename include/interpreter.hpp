@@ -5,17 +5,54 @@
 
 #include "ast.hpp"
 #include "environment.hpp"
+#include "jit.hpp"
+#include "profile.hpp"
+#include <chrono>
 #include <stack>
+#include <vector>
+
+namespace mod { struct Module; class Registry; }
 
 // Interpreter
 
 class Interpreter {
-   std::stack<int> loop_stack, fn_stack, return_stack;
-   int fn_counter = 0;
+   std::stack<int> loop_stack, return_stack;
+   int fn_counter = 0, stream_id = 0;
    bool should_break = false, should_continue = false;
+   mod::Registry& modules;
+   Profile* profile;
+   bool jit;
+
+   // Modules being run by import statements and the files they were imported as
+   std::vector<std::pair<mod::Module*, std::string>> importing;
+
+public:
+   // Limits of a run, zero is unlimited. Steps are loop iterations and calls, memory is how much the values made by
+   // the run hold, in bytes, and time is the wall-clock time since it started, in milliseconds.
+   struct Budget {
+      std::uint64_t steps = 0, memory = 0, milliseconds = 0;
+   };
+
+private:
+   Budget budget;
+   bool budgeted = false, expired = false;
+   std::uint64_t steps = 0, grace = 0;
+   mem::Account memory;
+   std::chrono::steady_clock::time_point time_start;
+
+   // Budget functions, charged at loop back-edges and calls
+
+   void charge(int line) {
+      if (budgeted) {
+         spend(line);
+      }
+   }
+
+   void spend(int line);
 
    // Statement evaluation functions
 
+   bool evaluate_step(Environment& env, Stmt stmt, int id, Value& last);
    Value evaluate_stmt(Environment& env, Stmt stmt);
    Value evaluate_var_decl(Environment& env, Stmt stmt);
    Value evaluate_fn_decl(Environment& env, Stmt stmt);
@@ -25,6 +62,8 @@ class Interpreter {
    Value evaluate_while_loop(Environment& env, Stmt stmt);
    Value evaluate_for_loop(Environment& env, Stmt stmt);
    Value evaluate_unless_stmt(Environment& env, Stmt stmt);
+   Value evaluate_import_stmt(Environment& env, Stmt stmt);
+   Value evaluate_try_stmt(Environment& env, Stmt stmt);
 
    // Expression evaluation functions
 
@@ -38,11 +77,47 @@ class Interpreter {
    Value evaluate_call_expr(Environment& env, Stmt expr);
    Value evaluate_primary_expr(Environment& env, Stmt expr);
 
+   // Statically typed evaluation functions
+
+   long double evaluate_number(Environment& env, Stmt& expr);
+   long double evaluate_arithmetic(Type op, long double left, long double right, int line);
+   Value evaluate_number_comparison(Environment& env, BinaryExpr& binary);
+
+   // Compiled code functions
+
+   Value call_compiled(const Function& fn, const jit::Code& code, std::vector<Value>& args, int line);
+
+   // Lazy parsing functions
+
+   static Stmt parse_decl(const Function& fn, bool lazy_nested);
+   void parse_lazy(Function& fn);
+
 public:
    // Evaluation functions
 
+   Interpreter(mod::Registry& modules, Profile* profile = nullptr, bool jit = false);
    Value evaluate(Program& program, Environment& env);
+   void begin();
+   bool evaluate(Stmt stmt, Environment& env);
    Value call_function(Environment& env, Value func, std::vector<Value>& args, int line);
+
+   // Depth of the loops, returns and imports being evaluated. Unwinding to a frame drops those entered after it was
+   // taken, as raised errors leave them without finishing them.
+   struct Frame {
+      size_t loops = 0, returns = 0, importing = 0;
+   };
+
+   Frame frame() const;
+   void unwind(const Frame& frame);
+
+   // Parses the whole body of a lazily parsed function, functions declared in it included, without running it
+   static Stmt parse_body(const Function& fn);
+
+   // Sets the budget and starts a run, exceeding it raises an error that try statements catch. Their handlers get a
+   // few more steps, after which the error is raised again and no longer caught. Functions are not compiled and
+   // compiled ones are interpreted while a budget is set, as machine code is never charged.
+   void set_budget(const Budget& budget);
+   void restart_budget();
 };
 
 #endif
@@ -0,0 +1,43 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+// Includes
+
+#include "ast.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Baseline JIT
+// Compiles functions that only work on numbers to x86-64 machine code. Numbers stay long doubles on the x87 stack,
+// so compiled code computes exactly the same results as the interpreter. Anything the compiler does not handle
+// leaves the function to the interpreter.
+
+namespace jit {
+   // Filled by compiled code when an arithmetic error occurs, see Interpreter::call_compiled()
+   struct Status {
+      std::int32_t op = 0;
+      std::int32_t line = 0;
+      long double value = 0;
+   };
+
+   using Entry = long double (*)(const long double* args, Status* status);
+
+   class Code {
+      void* memory;
+      size_t size;
+
+   public:
+      Entry entry;
+
+      Code(const std::vector<std::uint8_t>& code);
+      ~Code();
+      Code(const Code&) = delete;
+      Code& operator=(const Code&) = delete;
+   };
+
+   bool available();
+   std::shared_ptr<const Code> compile(const FnDeclaration& decl, const Program& body, const std::vector<StaticType>& parameters);
+}
+
+#endif
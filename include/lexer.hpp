@@ -3,15 +3,39 @@
 
 // Includes
 
+#include "fmt.hpp"
 #include "tokens.hpp"
+#include <deque>
 #include <vector>
 
 // Lexer
+// Large sources can be lexed in parallel. The source is split into chunks at line starts and every chunk is lexed
+// on its own thread as if it started outside of strings and comments. The chunks are then stitched together by
+// lexing sequentially from where the previous chunk ended until a token of the next chunk starts at the same
+// position, from where on both agree and the rest of the chunk is reused with its lines shifted.
 
 class Lexer {
-   const std::string& code;
+   // Thrown instead of raising errors while lexing a chunk, as its start might be inside a string or comment
+   struct Speculation {};
+
+   std::string_view code;
    std::vector<Token> tokens;
-   int index = 0, line = 1;
+   std::deque<std::string> strings;
+   std::size_t index = 0;
+   int line = 1;
+
+   // Chunk state, 'starts' holds the position every token starts at
+   std::vector<Lexer> chunks;
+   std::vector<std::size_t> starts;
+   std::size_t begin = 0, end = 0;
+   bool speculative = false, failed = false;
+
+   // Lex functions
+
+   Lexer(std::string_view code, std::size_t begin, std::size_t end);
+   void step();
+   void lex_chunk();
+   void stitch(Lexer& chunk);
 
    // Helper functions
 
@@ -20,11 +44,26 @@ class Lexer {
    char advance();
    char get_escape_code(char escape);
 
+   template<typename... Args>
+   void raise_if(int line, bool cond, const char* error, const Args&... args) {
+      if (cond && speculative) {
+         throw Speculation {};
+      }
+      fmt::raise_if(line, cond, error, args...);
+   }
+
 public:
-   // Lex functions
+   // Sources smaller than this are not split
+   static constexpr std::size_t min_chunk_size = 1 << 20;
+
+   Lexer(std::string_view code);
+   std::vector<Token>& lex(unsigned threads = 1);
+
+   // Streaming functions, tokens are lexed one at a time
 
-   Lexer(const std::string& code);
-   std::vector<Token>& lex();
+   Token next();
+   void release(const std::vector<Token>& kept);
+   std::size_t position() const;
 };
 
 #endif
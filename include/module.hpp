@@ -0,0 +1,64 @@
+#ifndef MODULE_HPP
+#define MODULE_HPP
+
+// Includes
+
+#include "ast.hpp"
+#include "environment.hpp"
+#include "file.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Module
+// Every imported file is loaded once per registry, however many files import it. Loading the imports of a program
+// resolves their paths and lexes, parses and checks the modules not loaded yet on a pool of threads. Modules are
+// loaded a level of the import graph at a time, as the imports of a module are known once it is parsed.
+// A module runs the first time one of its imports is evaluated, in an environment of its own.
+// Each interpreter instance owns a registry, so instances running on different threads share no modules.
+
+namespace mod {
+   struct Module {
+      std::string path;
+      file::Mapping source;
+      std::unique_ptr<Lexer> lexer;
+      std::unique_ptr<Parser> parser;
+      Program* program = nullptr;
+
+      // Set once the module starts running, 'initialized' once it finished. Modules are run once, so the error a
+      // module failed with is raised again by every later import of it.
+      std::unique_ptr<Environment> env;
+      bool initialized = false;
+      std::optional<err::Error> error;
+   };
+
+   class Registry {
+      std::filesystem::path directory;
+      std::unordered_map<std::string, std::unique_ptr<Module>> modules;
+
+      void resolve(const std::vector<ImportStmt*>& imports, const std::filesystem::path& directory, std::vector<Module*>& pending);
+      void load(const std::vector<ImportStmt*>& imports);
+
+   public:
+      // 'directory' is the directory imports of the main program are resolved against, hosts loading several
+      // programs set it for each one
+      Registry(const std::string& directory);
+      void set_directory(const std::string& directory);
+
+      // Loads the modules imported by a statement or program of the main program, and the modules they import.
+      // Programs whose code does not contain the keyword are not searched.
+      void load(Stmt& stmt);
+      void load(Program& program, std::string_view code);
+
+      // Module of a loaded import
+      Module& get(const ImportStmt& import);
+   };
+}
+
+#endif
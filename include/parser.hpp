@@ -4,15 +4,26 @@
 // Includes
 
 #include "ast.hpp"
+#include "lexer.hpp"
 #include "tokens.hpp"
 #include <vector>
 
 // Parser
+// Parses a lexed program at once, or streams the top-level statements of a program that is lexed on demand.
+// Lazy parsers only brace-match function bodies, which are parsed by parse_body() when the function is first called.
 
 class Parser {
+   // Streamed tokens are kept in 'window' from the previous token until the one after peek()
+   std::vector<Token> window;
    std::vector<Token>& tokens;
+   Lexer* lexer = nullptr;
    Program program;
    size_t index = 0;
+   int depth = 0;
+   bool lazy = false;
+
+   // Nesting limit of expressions, deeper programs would exhaust the native stack
+   static constexpr int max_depth = 4096;
 
    // Parse statement functions
 
@@ -26,24 +37,19 @@ class Parser {
    Stmt parse_while_loop();
    Stmt parse_for_loop();
    Stmt parse_block();
+   Stmt skip_block();
    Stmt parse_return_stmt();
+   Stmt parse_import_stmt();
+   Stmt parse_try_stmt();
    Stmt parse_unless_stmt(Stmt stmt);
+   void parse_annotation(Stmt& identifier);
+   Annotation parse_type();
 
    // Parse expression functions
 
    Stmt parse_expr();
-   Stmt parse_ternary_expr();
-   Stmt parse_value_or_expr();
-   Stmt parse_assignment_expr();
-   Stmt parse_logical_or_expr();
-   Stmt parse_logical_and_expr();
-   Stmt parse_equality_expr();
-   Stmt parse_relational_expr();
-   Stmt parse_additive_expr();
-   Stmt parse_multiplicative_expr();
-   Stmt parse_exponentiative_expr();
+   Stmt parse_binary_expr(int power);
    Stmt parse_unary_expr();
-   Stmt parse_reverse_unary_expr();
    Stmt parse_property_access();
    Stmt parse_call_expr();
    Stmt parse_args_list();
@@ -53,15 +59,21 @@ class Parser {
    // Utility functions
 
    void advance();
+   void fill();
    bool is(Type type) const;
+   bool is_type_name() const;
    Token& current();
+   const Token& peek() const;
    int line() const;
 
 public:
    // Parse functions
 
-   Parser(std::vector<Token>& tokens);
+   Parser(std::vector<Token>& tokens, bool lazy = false);
+   Parser(Lexer& lexer);
    Program& parse();
+   Stmt next();
+   Stmt parse_body(size_t begin);
 };
 
 #endif
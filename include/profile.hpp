@@ -0,0 +1,43 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+// Includes
+
+#include "values.hpp"
+#include <cstdint>
+#include <map>
+#include <tuple>
+
+// Type feedback profile
+// Records how often every function is called and which value types its parameters receive. Entries are keyed by
+// the hash of the source code and the line and name of the function, so one profile can be shared by many scripts.
+
+class Profile {
+public:
+   struct FnProfile {
+      std::uint64_t calls = 0;
+      std::vector<std::uint16_t> parameters;
+   };
+
+private:
+   using Key = std::tuple<std::uint64_t, int, std::string>;
+
+   std::uint64_t source;
+   std::map<Key, FnProfile> functions;
+
+public:
+   Profile(std::uint64_t source = 0);
+
+   // Profile functions
+
+   void load(const std::string& file);
+   void save(const std::string& file) const;
+   void record(const Function& fn, const std::vector<Value>& args);
+
+   // Access functions
+
+   std::vector<StaticType> guards(int line, const std::string& identifier, size_t parameters) const;
+   const FnProfile* find(int line, const std::string& identifier) const;
+};
+
+#endif
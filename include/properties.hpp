@@ -10,7 +10,6 @@
 namespace prop {
    // Property functions
 
-   void init();
    bool exists(const std::string& name, ValueType type);
    bool overrides(const std::string& name, ValueType type);
    Value get(const std::string& name, ValueType type);
@@ -31,6 +30,12 @@ namespace prop {
    Value array_clear(std::vector<Value>& args, Environment* env, int line);
    Value array_fill(std::vector<Value>& args, Environment* env, int line);
    Value array_join(std::vector<Value>& args, Environment* env, int line);
+
+   // Error functions
+
+   Value error_message(std::vector<Value>& args, Environment* env, int line);
+   Value error_line(std::vector<Value>& args, Environment* env, int line);
+   Value error_code(std::vector<Value>& args, Environment* env, int line);
 }
 
 #endif
@@ -0,0 +1,27 @@
+#ifndef RECORDS_HPP
+#define RECORDS_HPP
+
+// Includes
+
+#include "interpreter.hpp"
+#include <string>
+#include <string_view>
+
+// Record mode
+// Passes every record of stdin, a line or a part ending with another delimiter, to the 'map' function of a script and
+// writes what it returns to stdout, like awk. Stdin is read in large blocks and cut into batches of records, which
+// worker threads map at once. Every worker runs the script in an interpreter of its own, so they share no state, and
+// batches are written in the order they were read. What the script prints while mapping a record is written before
+// what it returns.
+//
+// If the script also declares 'reduce(acc, x)', the results are combined instead of written: every worker combines
+// the results of a batch, and the results of the batches are combined in order once stdin ends. Null results are
+// skipped in both cases.
+
+namespace rec {
+   // Runs the script once per worker, without calling main(), then maps stdin and returns the exit code. Every worker
+   // has the budget for the whole run.
+   int map(std::string_view code, const std::string& directory, unsigned workers, char delimiter, bool jit, const Interpreter::Budget& budget);
+}
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef RUNTIME_HPP
+#define RUNTIME_HPP
+
+// Includes
+
+#include "environment.hpp"
+#include "fmt.hpp"
+#include "functions.hpp"
+#include "properties.hpp"
+#include <cmath>
+
+// Runtime
+// Helpers for the C++ code generated by Transpiler. Every variable is a Slot instead of an Environment entry,
+// the helpers raise the same errors as Environment and Interpreter.
+
+namespace rt {
+   struct Slot {
+      Value value;
+      const Annotation* annotation = nullptr;
+      bool constant = false;
+   };
+
+   // Operands are aggregates, so they are evaluated from left to right like in the interpreter
+   struct Operands {
+      Value left, right;
+   };
+
+   struct Numbers {
+      long double left, right;
+   };
+
+   // Variable functions
+
+   inline void check(const Slot& slot, const Value& value, const char* identifier, int line) {
+      if (slot.annotation) {
+         fmt::raise_if(line, !value->matches(*slot.annotation), "Expected '{}' to be '{}', got '{}' instead.", identifier, slot.annotation->str(), value_type_str[int(value->type)]);
+      }
+   }
+
+   inline const Value& get(const Slot& slot, const char* identifier, int line) {
+      fmt::raise_if(line, !slot.value, "Variable '{}' does not exist in the given scope.", identifier);
+      return slot.value;
+   }
+
+   inline long double number(const Slot& slot, const char* identifier, int line) {
+      auto& value = get(slot, identifier, line);
+      return (value->type == ValueType::number ? static_cast<const NumberValue&>(*value).number : value->as_number());
+   }
+
+   inline void declare(Slot& slot, Value value, bool constant, const Annotation* annotation, const char* identifier, int line) {
+      fmt::raise_if(line, slot.constant, "Cannot shadow constant variable '{}'.", identifier);
+      slot.constant = constant;
+      slot.annotation = annotation;
+      check(slot, value, identifier, line);
+      slot.value = std::move(value);
+   }
+
+   inline const Value& assign(Slot& slot, Value value, const char* identifier, int line) {
+      get(slot, identifier, line);
+      fmt::raise_if(line, slot.constant, "Cannot assign to constant '{}'.", identifier);
+      check(slot, value, identifier, line);
+      slot.value = std::move(value);
+      return slot.value;
+   }
+
+   inline long double assign_number(Slot& slot, long double number, const char* identifier, int line) {
+      auto& value = get(slot, identifier, line);
+      fmt::raise_if(line, slot.constant, "Cannot assign to constant '{}'.", identifier);
+
+      if (value->type == ValueType::number) {
+         static_cast<NumberValue&>(*slot.value).number = number;
+      } else {
+         auto boxed = NumberValue::make(number, line);
+         check(slot, boxed, identifier, line);
+         slot.value = std::move(boxed);
+      }
+      return number;
+   }
+
+   inline void remove(Slot& slot, const char* identifier, int line) {
+      get(slot, identifier, line);
+      fmt::raise_if(line, slot.constant, "Cannot delete constant '{}'.", identifier);
+      slot.value.reset();
+      slot.annotation = nullptr;
+   }
+
+   // Operator functions
+
+   inline long double arithmetic(Type op, Numbers numbers, int line) {
+      auto [left, right] = numbers;
+      switch (op) {
+      case Type::plus:
+         return left + right;
+      case Type::minus:
+         return left - right;
+      case Type::multiply:
+         return left * right;
+      case Type::divide:
+         fmt::raise_if(line, right == 0, "Division by zero error: {} / 0.", left);
+         return left / right;
+      case Type::remainder:
+         fmt::raise_if(line, right == 0, "Division by zero error: {} %/%% 0.", left);
+         return std::remainder(left, right);
+      case Type::exponentiate:
+         return std::pow(left, right);
+      default:
+         fmt::raise(line, "Unsupported binary command '{}'.", type_str[int(op)]);
+      }
+   }
+
+   inline bool compare(Type op, Numbers numbers, int line) {
+      auto [left, right] = numbers;
+      switch (op) {
+      case Type::divisible:
+         return arithmetic(Type::remainder, {left, right}, line) == 0;
+      case Type::equals:
+      case Type::really_equals:
+         return left == right;
+      case Type::not_equals:
+      case Type::really_not_equals:
+         return left != right;
+      case Type::greater:
+         return left > right;
+      case Type::greater_equal:
+         return !(right > left);
+      case Type::smaller:
+         return right > left;
+      case Type::smaller_equal:
+         return !(left > right);
+      default:
+         fmt::raise(line, "Unsupported binary command '{}'.", type_str[int(op)]);
+      }
+   }
+
+   inline Value binary(Type op, Operands operands, int line) {
+      auto& [left, right] = operands;
+      left->line = line;
+
+      switch (op) {
+      case Type::plus:
+         return left->add(right);
+      case Type::minus:
+         return left->subtract(right);
+      case Type::multiply:
+         return left->multiply(right);
+      case Type::divide:
+         return left->divide(right);
+      case Type::remainder:
+         return left->remainder(right);
+      case Type::exponentiate:
+         return left->exponentiate(right);
+      case Type::divisible:
+         return BoolValue::make(!left->remainder(right)->as_bool(), line);
+      case Type::equals:
+         return BoolValue::make(left->equal(right), line);
+      case Type::really_equals:
+         return BoolValue::make(left->type == right->type && left->equal(right), line);
+      case Type::not_equals:
+         return BoolValue::make(!left->equal(right), line);
+      case Type::really_not_equals:
+         return BoolValue::make(left->type != right->type || !left->equal(right), line);
+      case Type::greater:
+         return BoolValue::make(left->greater(right, ">"), line);
+      case Type::greater_equal:
+         return BoolValue::make(!right->greater(left, ">="), line);
+      case Type::smaller:
+         return BoolValue::make(right->greater(left, "<"), line);
+      case Type::smaller_equal:
+         return BoolValue::make(!left->greater(right, "<="), line);
+      default:
+         fmt::raise(line, "Unsupported binary command '{}'.", type_str[int(op)]);
+      }
+   }
+
+   inline Value unary(Type op, Value value, int line) {
+      switch (op) {
+      case Type::plus:
+         return value;
+      case Type::minus:
+         return value->negate();
+      case Type::increment:
+         return value->increment();
+      case Type::decrement:
+         return value->decrement();
+      case Type::log_not:
+         return BoolValue::make(!value->as_bool(), value->line);
+      default:
+         fmt::raise(line, "Unsupported unary command '{}'.", type_str[int(op)]);
+      }
+   }
+
+   // Compound assignment reads the variable after its right side was evaluated
+   inline Value compound(Type op, Value right, const Slot& slot, const char* identifier, int line) {
+      auto& left = get(slot, identifier, line);
+      switch (op) {
+      case Type::plus_eq:
+         return left->add(right);
+      case Type::minus_eq:
+         return left->subtract(right);
+      case Type::multiply_eq:
+         return left->multiply(right);
+      case Type::divide_eq:
+         return left->divide(right);
+      case Type::remainder_eq:
+         return left->remainder(right);
+      case Type::exponentiate_eq:
+         return left->exponentiate(right);
+      default:
+         fmt::raise(line, "Unsupported assignment command '{}'.", type_str[int(op)]);
+      }
+   }
+
+   inline Value member(Operands operands, int line) {
+      auto& [left, key] = operands;
+      if (left->type == ValueType::array) {
+         auto& array = get_value<Array>(left);
+         fmt::raise_if(line, key->as_number() >= array.array.size(), "Index out of bounds. Array size is {}, while index is {}.", array.array.size(), key->as_number());
+         return array.array.at(key->as_number())->copy();
+      } else if (left->type == ValueType::string) {
+         auto& string = get_value<StringValue>(left);
+         fmt::raise_if(line, key->as_number() >= string.string.size(), "Index out of bounds. String size is {}, while index is {}.", string.string.size(), key->as_number());
+         return CharValue::make(string.string.at(key->as_number()), string.line);
+      }
+      fmt::raise(line, "Invalid member access: '{}'['{}'].", value_type_str[int(left->type)], value_type_str[int(key->type)]);
+   }
+
+   // Call functions
+
+   inline Value call(const Value& function, std::vector<Value>& args, int line) {
+      fmt::raise_if(line, function->type != ValueType::native_fn, "Attempted to call '{}', but only 'NativeFunction' and 'Function' are callable.", value_type_str[int(function->type)]);
+      return get_value<NativeFn>(function).call(args, nullptr, line);
+   }
+
+   // Calls a property on left. Properties assign the variable they were called on through the environment they
+   // are given, so it is declared in a scratch environment and written back to its slot if it was assigned.
+   inline Value property(const Value& left, const char* name, std::vector<Value>& args, Slot*& slot, const char* identifier, int line) {
+      fmt::raise_if(line, !prop::exists(name, left->type), "Property '{}' for type '{}' does not exist.", name, value_type_str[int(left->type)]);
+      auto function = prop::get(name, left->type);
+      fmt::raise_if(line, function->type != ValueType::native_fn, "Cannot call property '{}' as it is not a function, but '{}' instead.", name, value_type_str[int(left->type)]);
+
+      if (!slot) {
+         return call(function, args, line);
+      }
+
+      Environment env (nullptr);
+      env.declare_variable(identifier, NullValue::make(line), false, line);
+      args.front() = IdentValue::make(identifier, line);
+      auto result = get_value<NativeFn>(function).call(args, &env, line);
+
+      if (auto value = env.get_variable(identifier, line); value->type != ValueType::null) {
+         assign(*slot, std::move(value), identifier, line);
+      }
+      slot = (prop::overrides(name, left->type) ? slot : nullptr);
+      return result;
+   }
+
+   inline void arity(const std::vector<Value>& args, size_t parameters, size_t defaults, int line) {
+      fmt::raise_if(line, args.size() > parameters || args.size() < parameters - defaults, "Expected 'CallExpression' argument count to match function declaration parameter count. {} != {}.", args.size(), parameters);
+   }
+
+   inline Value returns(Value value, const Annotation* annotation, const char* identifier, int line) {
+      if (annotation) {
+         fmt::raise_if(line, !value || !value->matches(*annotation), "Expected '{}' to return '{}', got '{}' instead.", identifier, annotation->str(), (value ? value_type_str[int(value->type)] : value_type_str[int(ValueType::null)]));
+      }
+      return (value ? std::move(value) : NullValue::make(line));
+   }
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+// Includes
+
+#include <cstddef>
+#include <string_view>
+
+// Scan
+// Character scanning used by the lexer. Runs of bytes are classified 32 (AVX2) or 16 (SSE2) bytes at a time on
+// x86-64, other targets use the scalar versions. Every function returns the index of the first byte that does not
+// belong to the scanned run, or the size of the code if the run reaches its end.
+
+namespace scan {
+   enum class Level : char {
+      scalar, sse2, avx2
+   };
+
+   Level best_level();
+   Level level();
+   void set_level(Level level);
+
+   // Skips spaces, tabs and line breaks, counting the line breaks
+   std::size_t whitespace(std::string_view code, std::size_t index, int& line);
+
+   // Skips letters, digits and underscores
+   std::size_t identifier(std::string_view code, std::size_t index);
+
+   // Finds the first of two characters
+   std::size_t find(std::string_view code, std::size_t index, char first, char second);
+
+   // Finds the '*' of the closing "*/" of a block comment, counting the line breaks before it
+   std::size_t block_comment(std::string_view code, std::size_t index, int& line);
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+// Includes
+
+#include "environment.hpp"
+#include <string>
+
+class Interpreter;
+
+// Server
+// Serves calls to the functions of a program that already ran, the prelude, over a Unix domain socket. Workers are
+// forked once the prelude ran, so each starts from its environment, shared copy-on-write, instead of running it
+// again. Every worker accepts connections from the shared socket and answers the requests on them one at a time.
+//
+// A request is a line holding a call of a function declared by the prelude, with literals as arguments:
+//    area(3, 4.5)
+// and is answered by a line holding 'ok' and the returned value, or 'error' and the message of the error raised:
+//    ok 13.5
+// Backslashes and newlines in the answer are escaped as '\\' and '\n'.
+
+namespace srv {
+   // Serves until the server is interrupted or terminated, then prints the latency percentiles of the requests
+   // served to stderr and returns the exit code
+   int serve(const std::string& socket, unsigned workers, Interpreter& interpreter, Environment& global);
+}
+
+#endif
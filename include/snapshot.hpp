@@ -0,0 +1,40 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+// Includes
+
+#include "environment.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Snapshots
+// checkpoint() writes the variables of the global environment to a file, and --restore declares them again and
+// resumes the script at the top-level statement the snapshot was taken in, or after it if the statement is the call.
+// Numbers and counts are fixed-width, so they are read in place from the mapped file. Functions are stored with their
+// syntax trees in the form of the parse cache, and refer to the global environment once restored. Modules are
+// stored as the file they were imported from, and imported again when restored.
+
+namespace snap {
+   // Script a snapshot was taken from, the hash of its source and the top-level statement to resume from
+   struct Point {
+      std::string script;
+      std::uint64_t hash = 0, statement = 0;
+   };
+
+   // Writes the snapshot to a temporary file renamed over the file, so a crash never leaves half a snapshot. Host
+   // functions and functions declared in modules cannot be stored and raise an error.
+   void save(const std::string& file, const Point& point, const Environment& global, int line);
+
+   // Where the snapshot in the file was taken
+   Point point(const std::string& file);
+
+   // Imports the file at a canonical path as a module of the given name, running it if it was not imported yet
+   using Importer = std::function<Value(const std::string& identifier, const std::string& path)>;
+
+   // Declares the variables of the snapshot in the global environment, functions show errors in the code of the script
+   void restore(const std::string& file, Environment& global, std::string_view code, const Importer& import);
+}
+
+#endif
@@ -3,62 +3,155 @@
 
 // Includes
 
+#include <array>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <string_view>
 
 using namespace std::string_literals;
 
 // Token type
 
 enum class Type : char {
-   eof, keyword, identifier, number, character, string,
+   eof, identifier, number, character, string,
    increment, decrement, assign,
    plus_eq, minus_eq, multiply_eq, divide_eq, remainder_eq, exponentiate_eq,
    plus, minus, multiply, divide, remainder, exponentiate,
    log_and, log_or, log_not, divisible, binary_cond, quesion, colon, equals, really_equals, not_equals, really_not_equals, greater, greater_equal, smaller, smaller_equal,
-   arrow, l_paren, r_paren, l_brace, r_brace, l_bracket, r_bracket, comma, dot, semicolon
+   arrow, l_paren, r_paren, l_brace, r_brace, l_bracket, r_bracket, comma, dot, semicolon,
+   kw_let, kw_con, kw_delete, kw_exists, kw_if, kw_elif, kw_else, kw_while, kw_for, kw_fn, kw_do,
+   kw_break, kw_continue, kw_return, kw_unless, kw_import, kw_try, kw_catch
 };
 
 constexpr std::string_view type_str[] {
-   "EOF", "Keyword", "Identifier", "Number", "Character", "String",
+   "EOF", "Identifier", "Number", "Character", "String",
    "++", "--", "=",
    "+=", "-=", "*=", "/=", "%=", "**=",
    "+", "-", "*", "/", "%", "**",
    "&&", "||", "!", "%%", "??", "?", ":", "==", "===", "!=", "!==", ">", ">=", "<", "<=",
-   "->", "(", ")", "{", "}", "[", "]", ",", ".", ";"
+   "->", "(", ")", "{", "}", "[", "]", ",", ".", ";",
+   "let", "con", "delete", "exists", "if", "elif", "else", "while", "for", "fn", "do",
+   "break", "continue", "return", "unless", "import", "try", "catch"
 };
 
+// Operator groups
+
+constexpr bool is_arithmetic(Type op) {
+   return op == Type::plus || op == Type::minus || op == Type::multiply || op == Type::divide || op == Type::remainder || op == Type::exponentiate;
+}
+
+constexpr bool is_comparison(Type op) {
+   return op == Type::equals || op == Type::really_equals || op == Type::not_equals || op == Type::really_not_equals || op == Type::divisible
+       || op == Type::greater || op == Type::greater_equal || op == Type::smaller || op == Type::smaller_equal;
+}
+
+constexpr bool is_keyword(Type type) {
+   return type >= Type::kw_let && type <= Type::kw_catch;
+}
+
+// Binary operator of a compound assignment operator
+
+constexpr Type compound_op(Type op) {
+   switch (op) {
+   case Type::plus_eq:         return Type::plus;
+   case Type::minus_eq:        return Type::minus;
+   case Type::multiply_eq:     return Type::multiply;
+   case Type::divide_eq:       return Type::divide;
+   case Type::remainder_eq:    return Type::remainder;
+   case Type::exponentiate_eq: return Type::exponentiate;
+   default:                    return op;
+   }
+}
+
 // Token struct
+// Lexemes are views into the source code, literals are decoded once by the lexer
 
 struct Token {
    Type type {};
-   std::string lexeme;
+   std::string_view lexeme;
    int line = 0;
+
+   long double number = 0.0;
+   char ch = 0;
+};
+
+// Perfect hash table
+// The seed is searched for at compile time until no two entries share a slot, so every lookup probes a single slot
+
+template<std::size_t Size, typename T = Type>
+class PerfectHash {
+   static_assert((Size & (Size - 1)) == 0, "Perfect hash table size must be a power of two.");
+
+public:
+   struct Entry {
+      std::string_view text;
+      T type {};
+   };
+
+private:
+   std::array<Entry, Size> table {};
+   std::uint32_t seed = 0;
+
+   // 32-bit FNV-1a starting from the seed
+   static constexpr std::uint32_t hash(std::string_view text, std::uint32_t seed) {
+      for (char ch : text) {
+         seed = (seed ^ static_cast<unsigned char>(ch)) * 16777619u;
+      }
+      return seed;
+   }
+
+   constexpr void build(const Entry* entries, std::size_t count) {
+      for (bool collision = true; collision; ++seed) {
+         for (auto& slot : table) {
+            slot = {};
+         }
+         collision = false;
+
+         for (std::size_t i = 0; i < count && !collision; ++i) {
+            auto& slot = table[hash(entries[i].text, seed) & (Size - 1)];
+            collision = !slot.text.empty();
+            slot = entries[i];
+         }
+      }
+      --seed;
+   }
+
+public:
+   template<std::size_t N>
+   constexpr PerfectHash(const Entry (&entries)[N]) {
+      build(entries, N);
+   }
+
+   template<std::size_t N>
+   constexpr PerfectHash(const std::array<Entry, N>& entries) {
+      build(entries.data(), N);
+   }
+
+   constexpr T find(std::string_view text, T fallback) const {
+      auto& slot = table[hash(text, seed) & (Size - 1)];
+      return (slot.text == text ? slot.type : fallback);
+   }
 };
 
-// Operator map
+// Operator table
 
-static constexpr int max_op_size = 3;
-static std::unordered_map<std::string_view, Type> operators {
+inline constexpr int max_op_size = 3;
+inline constexpr PerfectHash<128> operators {{
    {"++", Type::increment}, {"--", Type::decrement}, {"=", Type::assign},
    {"+=", Type::plus_eq}, {"-=", Type::minus_eq}, {"*=", Type::multiply_eq}, {"/=", Type::divide_eq}, {"%=", Type::remainder_eq}, {"**=", Type::exponentiate_eq},
    {"+", Type::plus}, {"-", Type::minus}, {"*", Type::multiply}, {"/", Type::divide}, {"%", Type::remainder}, {"**", Type::exponentiate},
    {"&&", Type::log_and}, {"||", Type::log_or}, {"!", Type::log_not}, {"%%", Type::divisible}, {"??", Type::binary_cond}, {"?", Type::quesion}, {":", Type::colon}, {"==", Type::equals}, {"===", Type::really_equals}, {"!=", Type::not_equals}, {"!==", Type::really_not_equals}, {">", Type::greater}, {">=", Type::greater_equal}, {"<", Type::smaller}, {"<=", Type::smaller_equal},
    {"->", Type::arrow}, {"(", Type::l_paren}, {")", Type::r_paren}, {"{", Type::l_brace}, {"}", Type::r_brace}, {"[", Type::l_bracket}, {"]", Type::r_bracket}, {",", Type::comma}, {".", Type::dot}, {";", Type::semicolon}
-};
+}};
 
-// Keyword maps
+// Keyword table, keyword operators share the types of their symbols
 
-static std::unordered_set<std::string_view> keywords {
-   "let", "con", "delete", "exists",
-   "if", "elif", "else", "while", "for", "fn", "do",
-   "break", "continue", "return", "unless",
-   "and", "or", "not", "is", "isnot"
-};
-
-static std::unordered_map<std::string_view, Type> keyword_operators {
+inline constexpr PerfectHash<256> keywords {{
+   {"let", Type::kw_let}, {"con", Type::kw_con}, {"delete", Type::kw_delete}, {"exists", Type::kw_exists},
+   {"if", Type::kw_if}, {"elif", Type::kw_elif}, {"else", Type::kw_else}, {"while", Type::kw_while}, {"for", Type::kw_for}, {"fn", Type::kw_fn}, {"do", Type::kw_do},
+   {"break", Type::kw_break}, {"continue", Type::kw_continue}, {"return", Type::kw_return}, {"unless", Type::kw_unless}, {"import", Type::kw_import},
+   {"try", Type::kw_try}, {"catch", Type::kw_catch},
    {"and", Type::log_and}, {"or", Type::log_or}, {"not", Type::log_not}, {"is", Type::really_equals}, {"isnot", Type::really_not_equals}
-};
+}};
 
 #endif
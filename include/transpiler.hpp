@@ -0,0 +1,99 @@
+#ifndef TRANSPILER_HPP
+#define TRANSPILER_HPP
+
+// Includes
+
+#include "ast.hpp"
+#include <map>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Transpiler
+// Generates a standalone C++ translation unit from an analyzed program, linked against the runtime library.
+// Variables become rt::Slot locals and globals resolved at generation time, operators call the same value
+// functions as the interpreter, and expressions proven to be numbers are computed unboxed.
+
+class Transpiler {
+   enum class BlockKind : char {
+      function, lambda, inner, barrier
+   };
+
+   struct Block {
+      BlockKind kind;
+      std::string label, target;
+   };
+
+   struct Loop {
+      std::string next, target;
+      bool barrier = false;
+   };
+
+   // Slots are declared before the statement that binds them, so earlier reads still resolve to outer variables
+   struct Scope {
+      std::unordered_map<std::string, std::string> bound, pending;
+   };
+
+   struct Function {
+      std::string name, identifier;
+      const Annotation* returns = nullptr;
+   };
+
+   std::string code;
+   std::ostringstream out;
+   int depth = 0, counter = 0;
+   bool in_function = false;
+
+   std::vector<Scope> scopes;
+   std::vector<Block> blocks;
+   std::vector<Loop> loops;
+   std::unordered_map<std::string, std::string> functions;
+   std::unordered_map<const Statement*, std::string> function_names;
+   std::unordered_set<std::string> used_labels;
+   std::map<std::pair<StaticType, StaticType>, std::string> annotations;
+   std::vector<std::string> globals, definitions;
+   Function current;
+
+   // Statement generation functions
+
+   void generate_stmt(const Stmt& stmt, const std::string& target);
+   void generate_block(const Program& program, const std::string& target);
+   void generate_statements(const std::vector<Stmt>& statements, const std::string& target);
+   void generate_var_decl(const VarDeclaration& decl, const std::string& target);
+   std::string generate_fn_decl(const FnDeclaration& decl);
+   void generate_if_else(const IfElseStmt& ifelse, const std::string& target);
+   void generate_while_loop(const WhileStmt& while_stmt, const std::string& target);
+   void generate_for_loop(const ForStmt& for_stmt, const std::string& target);
+   void generate_return(const ReturnStmt& return_stmt);
+   void generate_jump(const Stmt& stmt);
+
+   // Expression generation functions
+
+   std::string value(const Stmt& expr);
+   std::string number(const Stmt& expr);
+   std::string condition(const Stmt& expr);
+   std::string assignment(const AssignmentExpr& assignment, bool boxed);
+   std::string call(const CallExpr& call);
+   std::string property(const PropertyAccess& prop);
+   std::string lambda(const Stmt& stmt);
+   std::string arguments(const std::vector<Stmt>& args);
+
+   // Utility functions
+
+   void emit(const std::string& line);
+   void declare_slots(const Stmt& stmt);
+   void collect(const Stmt& stmt, std::vector<std::pair<std::string, bool>>& identifiers) const;
+   std::string slot(const std::string& identifier) const;
+   std::string annotation(const Annotation& annotation);
+   std::string unique(const std::string& prefix, const std::string& identifier);
+   [[noreturn]] void unsupported(int line, const std::string& what) const;
+
+public:
+   // Transpile functions
+
+   Transpiler(std::string_view code);
+   std::string transpile(const Program& program);
+};
+
+#endif
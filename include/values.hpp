@@ -4,23 +4,81 @@
 // Includes
 
 #include "ast.hpp"
+#include "error.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 
 // Value type
 
 enum class ValueType : char {
-   identifier, number, character, string, boolean, array, native_fn, fn, null
+   identifier, number, character, string, boolean, array, native_fn, fn, null, module, error
 };
 
 constexpr std::string_view value_type_str[] {
-   "Identifier", "Number", "Character", "String", "Boolean", "Array", "NativeFunction", "Function", "Null"   
+   "Identifier", "Number", "Character", "String", "Boolean", "Array", "NativeFunction", "Function", "Null", "Module", "Error"
 };
 
-// Value literal definition
+// Memory accounting
+// Interpreters with a memory budget count the bytes held by the values made on their thread while they run, so one
+// is not charged for what another allocates. Values are charged when made and refunded when destroyed, strings and
+// arrays for what they hold as well. Large allocations are reserved before they are made.
 
 struct ValueLiteral;
+
+namespace mem {
+   struct Account {
+      std::uint64_t used = 0, limit = 0;
+      // Set once a reservation was refused, the error was raised by it
+      bool overdrawn = false;
+   };
+
+   extern thread_local Account* account;
+
+   inline void charge(std::uint64_t bytes) {
+      if (account) {
+         account->used += bytes;
+      }
+   }
+
+   // Values made before the run started are refunded as well, and never below nothing
+   inline void refund(std::uint64_t bytes) {
+      if (account) {
+         account->used -= std::min(account->used, bytes);
+      }
+   }
+
+   // Raises an error if the bytes would exceed the budget of the account charged
+   void reserve(std::uint64_t bytes, int line);
+   std::uint64_t object_size(ValueType type);
+   std::uint64_t footprint(const ValueLiteral& value);
+
+   // Makes an account the one charged on this thread while it exists, no account leaves the one charged as it was
+   class Scope {
+      Account* charged;
+      Account* previous = nullptr;
+
+   public:
+      Scope(Account* charged)
+         : charged(charged) {
+         if (charged) {
+            previous = std::exchange(account, charged);
+         }
+      }
+
+      ~Scope() {
+         if (charged) {
+            account = previous;
+         }
+      }
+   };
+}
+
+// Value literal definition
+
 using Value = std::unique_ptr<ValueLiteral>;
 
 template<class T>
@@ -38,9 +96,14 @@ struct ValueLiteral {
    int line = 0;
 
    ValueLiteral(ValueType type, int line);
-   virtual ~ValueLiteral() = default;
+   virtual ~ValueLiteral() {
+      if (mem::account) {
+         mem::refund(mem::object_size(type));
+      }
+   }
 
    void print() const;
+   bool matches(const Annotation& annotation) const;
    virtual std::string as_string() const = 0;
    virtual long double as_number() const = 0;
    virtual char as_char() const = 0;
@@ -119,6 +182,9 @@ struct StringValue : public ValueLiteral {
    std::string string;
 
    StringValue(const std::string& string, int line);
+   ~StringValue() {
+      mem::refund(string.capacity());
+   }
    static Value make(const std::string& string, int line) {
       return std::make_unique<StringValue>(string, line);
    }
@@ -151,8 +217,12 @@ struct BoolValue : public ValueLiteral {
 
 struct Array : public ValueLiteral {
    std::vector<Value> array;
+   std::uint64_t charged = 0;
 
    Array(std::vector<Value> array, int line);
+   ~Array() {
+      mem::refund(charged);
+   }
    static Value make(std::vector<Value> array, int line) {
       return std::make_unique<Array>(std::move(array), line);
    }
@@ -162,6 +232,16 @@ struct Array : public ValueLiteral {
    char as_char() const override;
    bool as_bool() const override;
    Value copy() const override;
+
+   // Charges the elements added to or refunds those removed from the array since it was last charged
+   void recharge() {
+      if (mem::account) {
+         auto size = array.capacity() * sizeof(Value);
+         mem::charge(size);
+         mem::refund(charged);
+         charged = size;
+      }
+   }
 };
 
 // Native (built-in) function value
@@ -187,19 +267,85 @@ struct NativeFn : public ValueLiteral {
 
 // User-defined function value
 
+namespace jit { class Code; }
+
 struct Function : public ValueLiteral {
    std::string identifier;
    std::vector<std::string> parameters;
    std::vector<Value> parameter_def;
+   std::vector<Annotation> parameter_types;
    std::string returns;
    Value return_def;
+   Annotation returns_type, return_type;
    Environment* env;
    Stmt body;
    int def_args;
 
-   Function(const std::string& identifier, const std::vector<std::string>& parameters, std::vector<Value> parameter_def, const std::string& returns, Value return_def, Environment* env, Stmt body, int def_args, int line);
-   static Value make(const std::string& identifier, const std::vector<std::string>& parameters, std::vector<Value> parameter_def, const std::string& returns, Value return_def, Environment* env, Stmt body, int def_args, int line) {
-      return std::make_unique<Function>(identifier, parameters, std::move(parameter_def), returns, std::move(return_def), env, std::move(body), def_args, line);
+   // Body specialized for the profiled parameter types, shared by all copies
+   std::vector<StaticType> guards;
+   std::shared_ptr<const Statement> guarded_body;
+
+   // Machine code of the bodies, if the JIT compiled them
+   std::shared_ptr<const jit::Code> compiled, compiled_guarded;
+
+   // Body of a lazily parsed function and its machine code, filled by the first call and shared by all copies
+   struct Parsed {
+      Stmt body;
+      std::shared_ptr<const jit::Code> compiled;
+   };
+   std::shared_ptr<Parsed> parsed;
+
+   // Code of the file the function was declared in, shown by errors raised in its body
+   err::Source source;
+
+   // Cells of the variables of enclosing scopes the body uses, shared by all copies. Calls look names up in them,
+   // then in 'env', the global environment. The copy a recursive function finds under its own name holds them weakly,
+   // so they do not keep themselves alive, and copies made from it hold them again.
+   std::shared_ptr<Environment> captured;
+   std::weak_ptr<Environment> weak_captured;
+
+   Function(const std::string& identifier, const std::vector<std::string>& parameters, std::vector<Value> parameter_def, std::vector<Annotation> parameter_types, const std::string& returns, Value return_def, Annotation returns_type, Annotation return_type, Environment* env, Stmt body, int def_args, int line);
+   static Value make(const std::string& identifier, const std::vector<std::string>& parameters, std::vector<Value> parameter_def, std::vector<Annotation> parameter_types, const std::string& returns, Value return_def, Annotation returns_type, Annotation return_type, Environment* env, Stmt body, int def_args, int line) {
+      return std::make_unique<Function>(identifier, parameters, std::move(parameter_def), std::move(parameter_types), returns, std::move(return_def), returns_type, return_type, env, std::move(body), def_args, line);
+   }
+
+   std::string as_string() const override;
+   long double as_number() const override;
+   char as_char() const override;
+   bool as_bool() const override;
+   Value copy() const override;
+};
+
+// Module value, the functions of the module's environment are called as its properties
+
+struct ModuleValue : public ValueLiteral {
+   std::string identifier;
+   Environment* env;
+   // Canonical path of the file the module was imported from
+   std::string path;
+
+   ModuleValue(const std::string& identifier, Environment* env, int line);
+   static Value make(const std::string& identifier, Environment* env, int line) {
+      return std::make_unique<ModuleValue>(identifier, env, line);
+   }
+
+   std::string as_string() const override;
+   long double as_number() const override;
+   char as_char() const override;
+   bool as_bool() const override;
+   Value copy() const override;
+};
+
+// Error value, caught by a try statement. 'error_line' is the line the error was raised at, err::nline if it has
+// none.
+
+struct ErrorValue : public ValueLiteral {
+   std::string message;
+   int error_line, code;
+
+   ErrorValue(const std::string& message, int error_line, int code, int line);
+   static Value make(const std::string& message, int error_line, int code, int line) {
+      return std::make_unique<ErrorValue>(message, error_line, code, line);
    }
 
    std::string as_string() const override;
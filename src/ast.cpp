@@ -5,6 +5,27 @@
 Statement::Statement(StmtType type, int line)
    : type(type), line(line) {}
 
+Stmt Statement::copy() const {
+   auto copied = clone();
+   copied->static_type = static_type;
+   return copied;
+}
+
+// Type annotation
+
+bool Annotation::accepts_any() const {
+   return type == StaticType::unknown || type == StaticType::dynamic;
+}
+
+std::string Annotation::str() const {
+   if (type == StaticType::dynamic) {
+      return "Any"s;
+   } else if (type == StaticType::array && element != StaticType::unknown) {
+      return "["s + std::string(Annotation{element}.str()) + "]"s;
+   }
+   return std::string(static_type_str[int(type)]);
+}
+
 // Statements
 
 // Variable declaration statement
@@ -12,7 +33,7 @@ Statement::Statement(StmtType type, int line)
 VarDeclaration::VarDeclaration(bool constant, std::vector<Stmt> identifiers, std::vector<Stmt> values, int line)
    : constant(constant), identifiers(std::move(identifiers)), values(std::move(values)), Statement(StmtType::var_decl, line) {}
 
-Stmt VarDeclaration::copy() const {
+Stmt VarDeclaration::clone() const {
    std::vector<Stmt> copied_identifiers, copied_values;
    for (const auto& identifier : identifiers) {
       copied_identifiers.push_back(std::move(identifier->copy()));
@@ -29,7 +50,7 @@ Stmt VarDeclaration::copy() const {
 FnDeclaration::FnDeclaration(Stmt identifier, std::vector<Stmt> arguments, std::vector<Stmt> argument_def, Stmt returns, Stmt return_def, Stmt body, int def_args, int line)
    : identifier(std::move(identifier)), arguments(std::move(arguments)), argument_def(std::move(argument_def)), returns(std::move(returns)), return_def(std::move(return_def)), body(std::move(body)), def_args(def_args), Statement(StmtType::fn_decl, line) {}
 
-Stmt FnDeclaration::copy() const {
+Stmt FnDeclaration::clone() const {
    std::vector<Stmt> copied_args, copied_arg_def;
    for (const auto& arg : arguments) {
       copied_args.push_back(arg->copy());
@@ -38,7 +59,14 @@ Stmt FnDeclaration::copy() const {
    for (const auto& arg_def : argument_def) {
       copied_arg_def.push_back(arg_def->copy());
    }
-   return FnDeclaration::make(identifier->copy(), std::move(copied_args), std::move(copied_arg_def), returns->copy(), return_def->copy(), body->copy(), def_args, line);
+   auto copied = FnDeclaration::make(identifier->copy(), std::move(copied_args), std::move(copied_arg_def), returns->copy(), return_def->copy(), body->copy(), def_args, line);
+   auto& copied_decl = get_stmt<FnDeclaration>(copied);
+   copied_decl.return_type = return_type;
+   copied_decl.guards = guards;
+   copied_decl.guarded_body = (guarded_body ? guarded_body->copy() : nullptr);
+   copied_decl.captures = captures;
+   copied_decl.recursive = recursive;
+   return copied;
 }
 
 // Exists statement
@@ -46,7 +74,7 @@ Stmt FnDeclaration::copy() const {
 ExistsStmt::ExistsStmt(Stmt identifier, int line)
    : identifier(std::move(identifier)), Statement(StmtType::exists, line) {}
 
-Stmt ExistsStmt::copy() const {
+Stmt ExistsStmt::clone() const {
    return ExistsStmt::make(identifier->copy(), line);
 }
 
@@ -55,7 +83,7 @@ Stmt ExistsStmt::copy() const {
 DeleteStmt::DeleteStmt(std::vector<Stmt> identifiers, int line)
    : identifiers(std::move(identifiers)), Statement(StmtType::del, line) {}
 
-Stmt DeleteStmt::copy() const {
+Stmt DeleteStmt::clone() const {
    std::vector<Stmt> copied_identifiers;
    for (const auto& identifier : identifiers) {
       copied_identifiers.push_back(std::move(identifier->copy()));
@@ -68,7 +96,7 @@ Stmt DeleteStmt::copy() const {
 IfElseStmt::IfElseStmt(Stmt ifclause, std::vector<Stmt> elifclauses, std::optional<Stmt> elseclause, int line)
    : ifclause(std::move(ifclause)), elifclauses(std::move(elifclauses)), elseclause(std::move(elseclause)), Statement(StmtType::ifelse, line) {}
 
-Stmt IfElseStmt::copy() const {
+Stmt IfElseStmt::clone() const {
    std::vector<Stmt> copied_elifclauses;
    for (const auto& elif : elifclauses) {
       copied_elifclauses.push_back(elif->copy());
@@ -86,7 +114,7 @@ Stmt IfElseStmt::copy() const {
 IfClauseStmt::IfClauseStmt(const std::string& keyword, Stmt expr, Stmt stmt, int line)
    : keyword(keyword), expr(std::move(expr)), stmt(std::move(stmt)), Statement(StmtType::if_clause, line) {}
 
-Stmt IfClauseStmt::copy() const {
+Stmt IfClauseStmt::clone() const {
    return IfClauseStmt::make(keyword, expr->copy(), stmt->copy(), line);
 }
 
@@ -95,7 +123,7 @@ Stmt IfClauseStmt::copy() const {
 WhileStmt::WhileStmt(bool infinite, Stmt expr, Stmt stmt, int line)
    : infinite(infinite), expr(std::move(expr)), stmt(std::move(stmt)), Statement(StmtType::while_loop, line) {}
 
-Stmt WhileStmt::copy() const {
+Stmt WhileStmt::clone() const {
    return WhileStmt::make(infinite, expr->copy(), stmt->copy(), line);
 }
 
@@ -104,7 +132,7 @@ Stmt WhileStmt::copy() const {
 ForStmt::ForStmt(std::optional<Stmt> initexpr, std::optional<Stmt> condition, std::optional<Stmt> loopexpr, Stmt stmt, int line)
    : initexpr(std::move(initexpr)), condition(std::move(condition)), loopexpr(std::move(loopexpr)), stmt(std::move(stmt)), Statement(StmtType::for_loop, line) {}
 
-Stmt ForStmt::copy() const {
+Stmt ForStmt::clone() const {
    return ForStmt::make(
       (initexpr.has_value() ? std::optional(initexpr.value()->copy()) : std::nullopt),
       (condition.has_value() ? std::optional(condition.value()->copy()) : std::nullopt),
@@ -118,8 +146,10 @@ Stmt ForStmt::copy() const {
 BreakStmt::BreakStmt(int line)
    : Statement(StmtType::break_stmt, line) {}
 
-Stmt BreakStmt::copy() const {
-   return BreakStmt::make(line);
+Stmt BreakStmt::clone() const {
+   auto stmt = BreakStmt::make(line);
+   get_stmt<BreakStmt>(stmt).in_loop = in_loop;
+   return stmt;
 }
 
 // Continue statement
@@ -127,8 +157,10 @@ Stmt BreakStmt::copy() const {
 ContinueStmt::ContinueStmt(int line)
    : Statement(StmtType::continue_stmt, line) {}
 
-Stmt ContinueStmt::copy() const {
-   return ContinueStmt::make(line);
+Stmt ContinueStmt::clone() const {
+   auto stmt = ContinueStmt::make(line);
+   get_stmt<ContinueStmt>(stmt).in_loop = in_loop;
+   return stmt;
 }
 
 // Return statement
@@ -136,7 +168,7 @@ Stmt ContinueStmt::copy() const {
 ReturnStmt::ReturnStmt(Stmt value, int line)
    : value(std::move(value)), Statement(StmtType::return_stmt, line) {}
 
-Stmt ReturnStmt::copy() const {
+Stmt ReturnStmt::clone() const {
    return ReturnStmt::make(value->copy(), line);
 }
 
@@ -145,10 +177,30 @@ Stmt ReturnStmt::copy() const {
 UnlessStmt::UnlessStmt(Stmt expr, Stmt stmt, int line)
    : expr(std::move(expr)), stmt(std::move(stmt)), Statement(StmtType::unless_stmt, line) {}
 
-Stmt UnlessStmt::copy() const {
+Stmt UnlessStmt::clone() const {
    return UnlessStmt::make(expr->copy(), stmt->copy(), line);
 }
 
+// Import statement
+
+ImportStmt::ImportStmt(const std::string& file, Stmt identifier, int line)
+   : file(file), identifier(std::move(identifier)), Statement(StmtType::import_stmt, line) {}
+
+Stmt ImportStmt::clone() const {
+   auto stmt = ImportStmt::make(file, identifier->copy(), line);
+   get_stmt<ImportStmt>(stmt).path = path;
+   return stmt;
+}
+
+// Try statement
+
+TryStmt::TryStmt(Stmt body, std::optional<Stmt> identifier, Stmt handler, int line)
+   : body(std::move(body)), identifier(std::move(identifier)), handler(std::move(handler)), Statement(StmtType::try_stmt, line) {}
+
+Stmt TryStmt::clone() const {
+   return TryStmt::make(body->copy(), (identifier.has_value() ? std::optional(identifier.value()->copy()) : std::nullopt), handler->copy(), line);
+}
+
 // Expressions
 
 // Assignment expression
@@ -156,7 +208,7 @@ Stmt UnlessStmt::copy() const {
 AssignmentExpr::AssignmentExpr(Type op, Stmt left, Stmt right, int line)
    : op(op), left(std::move(left)), right(std::move(right)), Statement(StmtType::assignment, line) {}
 
-Stmt AssignmentExpr::copy() const {
+Stmt AssignmentExpr::clone() const {
    return AssignmentExpr::make(op, std::move(left->copy()), std::move(right->copy()), line);
 }
 
@@ -165,7 +217,7 @@ Stmt AssignmentExpr::copy() const {
 TernaryExpr::TernaryExpr(Stmt left, Stmt middle, Stmt right, int line)
    : left(std::move(left)), middle(std::move(middle)), right(std::move(right)), Statement(StmtType::ternary, line) {}
 
-Stmt TernaryExpr::copy() const {
+Stmt TernaryExpr::clone() const {
    return TernaryExpr::make(std::move(left->copy()), std::move(middle->copy()), std::move(right->copy()), line);
 }
 
@@ -174,7 +226,7 @@ Stmt TernaryExpr::copy() const {
 BinaryExpr::BinaryExpr(Type op, Stmt left, Stmt right, int line)
    : op(op), left(std::move(left)), right(std::move(right)), Statement(StmtType::binary, line) {}
 
-Stmt BinaryExpr::copy() const {
+Stmt BinaryExpr::clone() const {
    return BinaryExpr::make(op, std::move(left->copy()), std::move(right->copy()), line);
 }
 
@@ -183,7 +235,7 @@ Stmt BinaryExpr::copy() const {
 UnaryExpr::UnaryExpr(Type op, Stmt value, int line)
    : op(op), value(std::move(value)), Statement(StmtType::unary, line) {}
 
-Stmt UnaryExpr::copy() const {
+Stmt UnaryExpr::clone() const {
    return UnaryExpr::make(op, std::move(value->copy()), line);
 }
 
@@ -192,7 +244,7 @@ Stmt UnaryExpr::copy() const {
 MemberAccess::MemberAccess(Stmt left, Stmt key, int line) 
    : left(std::move(left)), key(std::move(key)), Statement(StmtType::member, line) {}
 
-Stmt MemberAccess::copy() const {
+Stmt MemberAccess::clone() const {
    return MemberAccess::make(left->copy(), key->copy(), line);
 }
 
@@ -201,7 +253,7 @@ Stmt MemberAccess::copy() const {
 PropertyAccess::PropertyAccess(Stmt left, std::vector<Stmt> right, int line)
    : left(std::move(left)), right(std::move(right)), Statement(StmtType::property, line) {}
 
-Stmt PropertyAccess::copy() const {
+Stmt PropertyAccess::clone() const {
    std::vector<Stmt> copied_right;
    for (const auto& r : right) {
       copied_right.push_back(r->copy());
@@ -214,7 +266,7 @@ Stmt PropertyAccess::copy() const {
 CallExpr::CallExpr(Stmt args, Stmt identifier, int line)
    : args(std::move(args)), identifier(std::move(identifier)), Statement(StmtType::call, line) {}
 
-Stmt CallExpr::copy() const {
+Stmt CallExpr::clone() const {
    return CallExpr::make(std::move(args->copy()), std::move(identifier->copy()), line);
 }
 
@@ -223,7 +275,7 @@ Stmt CallExpr::copy() const {
 ArgsListExpr::ArgsListExpr(std::vector<Stmt> args, int line)
    : args(std::move(args)), Statement(StmtType::args, line) {}
 
-Stmt ArgsListExpr::copy() const {
+Stmt ArgsListExpr::clone() const {
    std::vector<Stmt> copied_args;
    for (const auto& arg : args) {
       copied_args.push_back(std::move(arg->copy()));
@@ -238,8 +290,10 @@ Stmt ArgsListExpr::copy() const {
 IdentLiteral::IdentLiteral(const std::string& identifier, int line)
    : identifier(identifier), Statement(StmtType::identifier, line) {}
 
-Stmt IdentLiteral::copy() const {
-   return IdentLiteral::make(identifier, line);
+Stmt IdentLiteral::clone() const {
+   auto copied = IdentLiteral::make(identifier, line);
+   get_stmt<IdentLiteral>(copied).annotation = annotation;
+   return copied;
 }
 
 // Number literal
@@ -247,7 +301,7 @@ Stmt IdentLiteral::copy() const {
 NumberLiteral::NumberLiteral(long double number, int line)
    : number(number), Statement(StmtType::number, line) {}
 
-Stmt NumberLiteral::copy() const {
+Stmt NumberLiteral::clone() const {
    return NumberLiteral::make(number, line);
 }
 
@@ -256,7 +310,7 @@ Stmt NumberLiteral::copy() const {
 CharLiteral::CharLiteral(char ch, int line)
    : ch(ch), Statement(StmtType::character, line) {}
 
-Stmt CharLiteral::copy() const {
+Stmt CharLiteral::clone() const {
    return CharLiteral::make(ch, line);
 }
 
@@ -265,7 +319,7 @@ Stmt CharLiteral::copy() const {
 StringLiteral::StringLiteral(const std::string& string, int line)
    : string(string), Statement(StmtType::string, line) {}
 
-Stmt StringLiteral::copy() const {
+Stmt StringLiteral::clone() const {
    return StringLiteral::make(string, line);
 }
 
@@ -274,7 +328,7 @@ Stmt StringLiteral::copy() const {
 ArrayLiteral::ArrayLiteral(std::vector<Stmt> array, int line)
    : array(std::move(array)), Statement(StmtType::array, line) {}
 
-Stmt ArrayLiteral::copy() const {
+Stmt ArrayLiteral::clone() const {
    std::vector<Stmt> copied_array;
    for (const auto& element : array) {
       copied_array.push_back(element->copy());
@@ -287,7 +341,7 @@ Stmt ArrayLiteral::copy() const {
 NullLiteral::NullLiteral(int line)
    : Statement(StmtType::null, line) {}
 
-Stmt NullLiteral::copy() const {
+Stmt NullLiteral::clone() const {
    return NullLiteral::make(line);
 }
 
@@ -296,10 +350,19 @@ Stmt NullLiteral::copy() const {
 Program::Program(int line)
    : Statement(StmtType::program, line) {}
 
-Stmt Program::copy() const {
+Stmt Program::clone() const {
    auto copied = std::make_unique<Program>(line);
    for (const auto& statement : statements) {
       copied->statements.push_back(statement->copy());
    }
    return std::move(copied);
 }
+
+// Lazy body
+
+LazyBody::LazyBody(std::vector<Token>* tokens, size_t begin, size_t end, int line)
+   : tokens(tokens), begin(begin), end(end), Statement(StmtType::lazy, line) {}
+
+Stmt LazyBody::clone() const {
+   return LazyBody::make(tokens, begin, end, line);
+}
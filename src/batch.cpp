@@ -0,0 +1,147 @@
+#include "batch.hpp"
+
+// Includes
+
+#include "error.hpp"
+#include "fmt.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Jobs
+
+namespace {
+   struct Job {
+      std::string script;
+      std::FILE* output = nullptr;
+      pid_t pid = 0;
+      std::chrono::steady_clock::time_point start;
+      std::uint64_t wall = 0, cpu = 0;
+      int code = 0, signal = 0;
+      bool done = false;
+   };
+}
+
+// Utility functions
+
+static double milliseconds(std::uint64_t nanoseconds) {
+   return std::round(nanoseconds / 1e4) / 100;
+}
+
+static std::uint64_t nanoseconds(const timeval& time) {
+   return std::uint64_t(time.tv_sec) * 1000000000 + std::uint64_t(time.tv_usec) * 1000;
+}
+
+// Output is captured in an unnamed temporary file rather than a pipe, so scripts never wait for it to be read
+static void start(Job& job, const batch::Runner& runner) {
+   job.output = std::tmpfile();
+   fmt::raise_if(err::nline, !job.output, "Cannot capture the output of '{}': {}.", job.script, std::strerror(errno));
+   std::cout.flush();
+   job.start = std::chrono::steady_clock::now();
+
+   job.pid = fork();
+   fmt::raise_if(err::nline, job.pid < 0, "Cannot fork a worker for '{}': {}.", job.script, std::strerror(errno));
+   if (job.pid != 0) {
+      return;
+   }
+
+   // Scripts running at once cannot share input, so they read none
+   int input = open("/dev/null", O_RDONLY);
+   dup2(input, STDIN_FILENO);
+   dup2(fileno(job.output), STDOUT_FILENO);
+
+   int code = 0;
+   try {
+      code = runner(job.script);
+   } catch (const err::Error& error) {
+      err::report(error);
+   } catch (const err::Exit& exit) {
+      err::report(exit);
+   }
+   std::cout.flush();
+   std::exit(code);
+}
+
+static void finish(Job& job, int status, const rusage& usage) {
+   job.wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - job.start).count();
+   job.cpu = nanoseconds(usage.ru_utime) + nanoseconds(usage.ru_stime);
+   if (WIFSIGNALED(status)) {
+      job.signal = WTERMSIG(status);
+      job.code = 128 + job.signal;
+   } else {
+      job.code = WEXITSTATUS(status);
+   }
+   job.done = true;
+}
+
+static void print_output(Job& job) {
+   std::rewind(job.output);
+   char buffer[1 << 16];
+   for (size_t size; (size = std::fread(buffer, 1, sizeof(buffer), job.output)) > 0;) {
+      std::cout.write(buffer, size);
+   }
+   std::cout.flush();
+   std::fclose(job.output);
+   job.output = nullptr;
+}
+
+// Batch functions
+
+namespace batch {
+   int run(const std::vector<std::string>& scripts, unsigned jobs, const Runner& runner) {
+      std::vector<Job> pool (scripts.size());
+      for (size_t i = 0; i < scripts.size(); ++i) {
+         pool[i].script = scripts[i];
+      }
+
+      auto begin = std::chrono::steady_clock::now();
+      size_t started = 0, printed = 0;
+      unsigned running = 0;
+
+      while (printed < pool.size()) {
+         for (; running < jobs && started < pool.size(); ++started, ++running) {
+            start(pool[started], runner);
+         }
+
+         int status = 0;
+         rusage usage {};
+         pid_t pid = wait4(-1, &status, 0, &usage);
+         if (pid < 0) {
+            fmt::raise_if(err::nline, errno != EINTR, "Cannot wait for a worker: {}.", std::strerror(errno));
+            continue;
+         }
+
+         for (size_t i = printed; i < started; ++i) {
+            if (pool[i].pid == pid && !pool[i].done) {
+               finish(pool[i], status, usage);
+               --running;
+               break;
+            }
+         }
+         for (; printed < pool.size() && pool[printed].done; ++printed) {
+            print_output(pool[printed]);
+         }
+      }
+      auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+
+      std::uint64_t cpu = 0;
+      size_t failed = 0;
+      int code = 0;
+      for (const auto& job : pool) {
+         auto result = (job.signal ? fmt::format("killed by signal {}", job.signal) : fmt::format("exit code {}", job.code));
+         std::cerr << fmt::format("{}: {} in {} ms, {} ms of CPU time.", job.script, result, milliseconds(job.wall), milliseconds(job.cpu)) << '\n';
+
+         cpu += job.cpu;
+         failed += (job.code != 0);
+         code = (code ? code : job.code);
+      }
+      std::cerr << fmt::format("Ran {} scripts with {} jobs in {} ms, {} ms of CPU time, {} failed.", pool.size(), jobs, milliseconds(wall), milliseconds(cpu), failed) << '\n';
+      return code;
+   }
+}
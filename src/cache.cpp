@@ -0,0 +1,572 @@
+#include "cache.hpp"
+
+// Includes
+
+#include "file.hpp"
+#include "fmt.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unistd.h>
+
+#ifndef CLL_VERSION
+#define CLL_VERSION "unknown"
+#endif
+
+// Static variables
+
+// Changes to the layout of the syntax tree or of the file need a new format number
+static constexpr auto cache_magic = "cll-ast\n";
+static constexpr auto cache_version = CLL_VERSION " format 4";
+
+// Cache
+
+namespace cache {
+   namespace {
+      // Thrown when a cache file ends early or holds something that is not a statement, and when a statement
+      // cannot be stored
+      struct Corrupt {};
+
+      // Numbers are written as little-endian base-128 varints, most counts and lines take a single byte
+
+      class Writer {
+         std::string& data;
+
+      public:
+         Writer(std::string& data)
+            : data(data) {}
+
+         void number(std::uint64_t value) {
+            for (; value >= 0x80; value >>= 7) {
+               data += char(value | 0x80);
+            }
+            data += char(value);
+         }
+
+         void raw(const void* value, std::size_t size) {
+            data.append(static_cast<const char*>(value), size);
+         }
+
+         void string(std::string_view string) {
+            number(string.size());
+            data += string;
+         }
+
+         // x87 long doubles leave their padding unset, it is written as zeros so equal trees write equal files
+         void literal(long double value) {
+            char bytes[sizeof(long double)] {};
+            std::memcpy(bytes, &value, (std::numeric_limits<long double>::digits == 64 ? 10 : sizeof(long double)));
+            raw(bytes, sizeof(bytes));
+         }
+
+         void annotation(const Annotation& annotation) {
+            data += char(annotation.type);
+            data += char(annotation.element);
+         }
+
+         void stmts(const std::vector<Stmt>& stmts) {
+            number(stmts.size());
+            for (const auto& stmt : stmts) {
+               this->stmt(stmt);
+            }
+         }
+
+         void optional(const std::optional<Stmt>& stmt) {
+            data += char(stmt.has_value());
+            if (stmt.has_value()) {
+               this->stmt(stmt.value());
+            }
+         }
+
+         void stmt(const Stmt& stmt);
+      };
+
+      class Reader {
+         const char* at;
+         const char* end;
+
+      public:
+         Reader(std::string_view data)
+            : at(data.data()), end(data.data() + data.size()) {}
+
+         std::uint64_t number() {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+               if (at >= end) {
+                  throw Corrupt {};
+               }
+               auto byte = std::uint8_t(*at++);
+               value |= std::uint64_t(byte & 0x7F) << shift;
+               if (!(byte & 0x80)) {
+                  return value;
+               }
+            }
+            throw Corrupt {};
+         }
+
+         std::uint8_t byte() {
+            if (at >= end) {
+               throw Corrupt {};
+            }
+            return std::uint8_t(*at++);
+         }
+
+         void raw(void* value, std::size_t size) {
+            if (std::size_t(end - at) < size) {
+               throw Corrupt {};
+            }
+            std::memcpy(value, at, size);
+            at += size;
+         }
+
+         std::string_view string() {
+            auto size = number();
+            if (std::uint64_t(end - at) < size) {
+               throw Corrupt {};
+            }
+            std::string_view string (at, size);
+            at += size;
+            return string;
+         }
+
+         Annotation annotation() {
+            Annotation annotation;
+            annotation.type = StaticType(byte());
+            annotation.element = StaticType(byte());
+            return annotation;
+         }
+
+         // Every statement takes at least two bytes, larger counts can only come from a damaged file
+         std::vector<Stmt> stmts() {
+            auto count = number();
+            if (count > std::uint64_t(end - at) / 2) {
+               throw Corrupt {};
+            }
+
+            std::vector<Stmt> stmts (count);
+            for (auto& stmt : stmts) {
+               stmt = this->stmt();
+            }
+            return stmts;
+         }
+
+         std::optional<Stmt> optional() {
+            if (byte()) {
+               return stmt();
+            }
+            return std::nullopt;
+         }
+
+         Stmt stmt();
+
+         std::size_t remaining() const {
+            return end - at;
+         }
+      };
+
+      // Every statement starts with its type and line, the fields follow in the order of their declaration
+
+      void Writer::stmt(const Stmt& stmt) {
+         data += char(stmt->type);
+         number(std::uint32_t(stmt->line));
+
+         switch (stmt->type) {
+         case StmtType::var_decl: {
+            auto& decl = get_stmt<VarDeclaration>(stmt);
+            data += char(decl.constant);
+            stmts(decl.identifiers);
+            stmts(decl.values);
+            break;
+         }
+         case StmtType::fn_decl: {
+            auto& decl = get_stmt<FnDeclaration>(stmt);
+            this->stmt(decl.identifier);
+            stmts(decl.arguments);
+            stmts(decl.argument_def);
+            this->stmt(decl.returns);
+            this->stmt(decl.return_def);
+            this->stmt(decl.body);
+            number(decl.def_args);
+            annotation(decl.return_type);
+            number(decl.captures.size());
+            for (const auto& capture : decl.captures) {
+               string(capture.identifier);
+               number(capture.depth + 1);
+            }
+            data += char(decl.recursive);
+            break;
+         }
+         case StmtType::exists:
+            this->stmt(get_stmt<ExistsStmt>(stmt).identifier);
+            break;
+         case StmtType::del:
+            stmts(get_stmt<DeleteStmt>(stmt).identifiers);
+            break;
+         case StmtType::ifelse: {
+            auto& ifelse = get_stmt<IfElseStmt>(stmt);
+            this->stmt(ifelse.ifclause);
+            stmts(ifelse.elifclauses);
+            optional(ifelse.elseclause);
+            break;
+         }
+         case StmtType::if_clause: {
+            auto& clause = get_stmt<IfClauseStmt>(stmt);
+            string(clause.keyword);
+            this->stmt(clause.expr);
+            this->stmt(clause.stmt);
+            break;
+         }
+         case StmtType::while_loop: {
+            auto& loop = get_stmt<WhileStmt>(stmt);
+            data += char(loop.infinite);
+            this->stmt(loop.expr);
+            this->stmt(loop.stmt);
+            break;
+         }
+         case StmtType::for_loop: {
+            auto& loop = get_stmt<ForStmt>(stmt);
+            optional(loop.initexpr);
+            optional(loop.condition);
+            optional(loop.loopexpr);
+            this->stmt(loop.stmt);
+            break;
+         }
+         case StmtType::break_stmt:
+         case StmtType::continue_stmt:
+         case StmtType::null:
+            break;
+         case StmtType::return_stmt:
+            this->stmt(get_stmt<ReturnStmt>(stmt).value);
+            break;
+         case StmtType::unless_stmt: {
+            auto& unless = get_stmt<UnlessStmt>(stmt);
+            this->stmt(unless.expr);
+            this->stmt(unless.stmt);
+            break;
+         }
+         case StmtType::import_stmt:
+            string(get_stmt<ImportStmt>(stmt).file);
+            this->stmt(get_stmt<ImportStmt>(stmt).identifier);
+            break;
+         case StmtType::try_stmt: {
+            auto& try_stmt = get_stmt<TryStmt>(stmt);
+            this->stmt(try_stmt.body);
+            optional(try_stmt.identifier);
+            this->stmt(try_stmt.handler);
+            break;
+         }
+         case StmtType::assignment: {
+            auto& assignment = get_stmt<AssignmentExpr>(stmt);
+            data += char(assignment.op);
+            this->stmt(assignment.left);
+            this->stmt(assignment.right);
+            break;
+         }
+         case StmtType::ternary: {
+            auto& ternary = get_stmt<TernaryExpr>(stmt);
+            this->stmt(ternary.left);
+            this->stmt(ternary.middle);
+            this->stmt(ternary.right);
+            break;
+         }
+         case StmtType::binary: {
+            auto& binary = get_stmt<BinaryExpr>(stmt);
+            data += char(binary.op);
+            this->stmt(binary.left);
+            this->stmt(binary.right);
+            break;
+         }
+         case StmtType::unary: {
+            auto& unary = get_stmt<UnaryExpr>(stmt);
+            data += char(unary.op);
+            this->stmt(unary.value);
+            break;
+         }
+         case StmtType::member: {
+            auto& member = get_stmt<MemberAccess>(stmt);
+            this->stmt(member.left);
+            this->stmt(member.key);
+            break;
+         }
+         case StmtType::property: {
+            auto& prop = get_stmt<PropertyAccess>(stmt);
+            this->stmt(prop.left);
+            stmts(prop.right);
+            break;
+         }
+         case StmtType::call: {
+            auto& call = get_stmt<CallExpr>(stmt);
+            this->stmt(call.args);
+            this->stmt(call.identifier);
+            break;
+         }
+         case StmtType::args:
+            stmts(get_stmt<ArgsListExpr>(stmt).args);
+            break;
+         case StmtType::identifier: {
+            auto& identifier = get_stmt<IdentLiteral>(stmt);
+            string(identifier.identifier);
+            annotation(identifier.annotation);
+            break;
+         }
+         case StmtType::number:
+            literal(get_stmt<NumberLiteral>(stmt).number);
+            break;
+         case StmtType::character:
+            data += get_stmt<CharLiteral>(stmt).ch;
+            break;
+         case StmtType::string:
+            string(get_stmt<StringLiteral>(stmt).string);
+            break;
+         case StmtType::array:
+            stmts(get_stmt<ArrayLiteral>(stmt).array);
+            break;
+         case StmtType::program:
+            stmts(get_stmt<Program>(stmt).statements);
+            break;
+         default:
+            // Lazily parsed bodies view tokens of the process that parsed them
+            throw Corrupt {};
+         }
+      }
+
+      Stmt Reader::stmt() {
+         auto type = StmtType(byte());
+         int line = int(std::uint32_t(number()));
+
+         switch (type) {
+         case StmtType::var_decl: {
+            bool constant = byte();
+            auto identifiers = stmts();
+            return VarDeclaration::make(constant, std::move(identifiers), stmts(), line);
+         }
+         case StmtType::fn_decl: {
+            auto identifier = stmt();
+            auto arguments = stmts();
+            auto argument_def = stmts();
+            auto returns = stmt();
+            auto return_def = stmt();
+            auto body = stmt();
+            int def_args = number();
+            auto decl = FnDeclaration::make(std::move(identifier), std::move(arguments), std::move(argument_def), std::move(returns), std::move(return_def), std::move(body), def_args, line);
+            auto& fn_decl = get_stmt<FnDeclaration>(decl);
+            fn_decl.return_type = annotation();
+            // Every capture takes at least two bytes as well
+            auto captures = number();
+            if (captures > remaining() / 2) {
+               throw Corrupt {};
+            }
+            fn_decl.captures.resize(captures);
+            for (auto& capture : fn_decl.captures) {
+               capture.identifier = std::string(string());
+               capture.depth = int(number()) - 1;
+            }
+            fn_decl.recursive = byte();
+            return decl;
+         }
+         case StmtType::exists:
+            return ExistsStmt::make(stmt(), line);
+         case StmtType::del:
+            return DeleteStmt::make(stmts(), line);
+         case StmtType::ifelse: {
+            auto ifclause = stmt();
+            auto elifclauses = stmts();
+            return std::make_unique<IfElseStmt>(std::move(ifclause), std::move(elifclauses), optional(), line);
+         }
+         case StmtType::if_clause: {
+            std::string keyword (string());
+            auto expr = stmt();
+            return IfClauseStmt::make(keyword, std::move(expr), stmt(), line);
+         }
+         case StmtType::while_loop: {
+            bool infinite = byte();
+            auto expr = stmt();
+            return WhileStmt::make(infinite, std::move(expr), stmt(), line);
+         }
+         case StmtType::for_loop: {
+            auto initexpr = optional();
+            auto condition = optional();
+            auto loopexpr = optional();
+            return ForStmt::make(std::move(initexpr), std::move(condition), std::move(loopexpr), stmt(), line);
+         }
+         case StmtType::break_stmt:
+            return BreakStmt::make(line);
+         case StmtType::continue_stmt:
+            return ContinueStmt::make(line);
+         case StmtType::return_stmt:
+            return ReturnStmt::make(stmt(), line);
+         case StmtType::unless_stmt: {
+            auto expr = stmt();
+            return UnlessStmt::make(std::move(expr), stmt(), line);
+         }
+         case StmtType::import_stmt: {
+            std::string file (string());
+            return ImportStmt::make(file, stmt(), line);
+         }
+         case StmtType::try_stmt: {
+            auto body = stmt();
+            auto identifier = optional();
+            return TryStmt::make(std::move(body), std::move(identifier), stmt(), line);
+         }
+         case StmtType::assignment: {
+            auto op = Type(byte());
+            auto left = stmt();
+            return AssignmentExpr::make(op, std::move(left), stmt(), line);
+         }
+         case StmtType::ternary: {
+            auto left = stmt();
+            auto middle = stmt();
+            return TernaryExpr::make(std::move(left), std::move(middle), stmt(), line);
+         }
+         case StmtType::binary: {
+            auto op = Type(byte());
+            auto left = stmt();
+            return BinaryExpr::make(op, std::move(left), stmt(), line);
+         }
+         case StmtType::unary: {
+            auto op = Type(byte());
+            return UnaryExpr::make(op, stmt(), line);
+         }
+         case StmtType::member: {
+            auto left = stmt();
+            return MemberAccess::make(std::move(left), stmt(), line);
+         }
+         case StmtType::property: {
+            auto left = stmt();
+            return PropertyAccess::make(std::move(left), stmts(), line);
+         }
+         case StmtType::call: {
+            auto args = stmt();
+            return CallExpr::make(std::move(args), stmt(), line);
+         }
+         case StmtType::args:
+            return ArgsListExpr::make(stmts(), line);
+         case StmtType::identifier: {
+            auto identifier = IdentLiteral::make(std::string(string()), line);
+            get_stmt<IdentLiteral>(identifier).annotation = annotation();
+            return identifier;
+         }
+         case StmtType::number: {
+            long double value;
+            raw(&value, sizeof(long double));
+            return NumberLiteral::make(value, line);
+         }
+         case StmtType::character:
+            return CharLiteral::make(char(byte()), line);
+         case StmtType::string:
+            return StringLiteral::make(std::string(string()), line);
+         case StmtType::array:
+            return ArrayLiteral::make(stmts(), line);
+         case StmtType::null:
+            return NullLiteral::make(line);
+         case StmtType::program: {
+            auto program = std::make_unique<Program>(line);
+            program->statements = stmts();
+            return std::move(program);
+         }
+         default:
+            throw Corrupt {};
+         }
+      }
+
+      std::string path(const std::string& directory, std::uint64_t hash) {
+         std::stringstream ss;
+         ss << std::hex << hash << ".ast";
+         return (std::filesystem::path(directory) / ss.str()).string();
+      }
+   }
+
+   std::string default_directory() {
+      if (auto cache = std::getenv("XDG_CACHE_HOME"); cache && *cache) {
+         return (std::filesystem::path(cache) / "cll").string();
+      } else if (auto home = std::getenv("HOME"); home && *home) {
+         return (std::filesystem::path(home) / ".cache" / "cll").string();
+      }
+      return {};
+   }
+
+   // The header holds the magic, the version, the hash and size of the source and the parse time in nanoseconds.
+   // Comparing the size as well keeps hash collisions between scripts of different lengths from being loaded.
+
+   bool load(const std::string& directory, std::string_view code, std::uint64_t hash, Program& program, std::uint64_t& parse_time) {
+      auto file = path(directory, hash);
+      if (directory.empty() || !file::exists(file)) {
+         return false;
+      }
+
+      file::Mapping mapping (file);
+      Reader reader (mapping.view());
+      try {
+         char magic[8];
+         reader.raw(magic, sizeof(magic));
+         if (std::memcmp(magic, cache_magic, sizeof(magic)) != 0 || reader.string() != cache_version || reader.number() != hash || reader.number() != code.size()) {
+            return false;
+         }
+
+         parse_time = reader.number();
+         program.statements = reader.stmts();
+         return true;
+      } catch (const Corrupt&) {
+         program.statements.clear();
+         return false;
+      }
+   }
+
+   // Written to a temporary file first, so that runs in parallel never load half a file
+   void store(const std::string& directory, std::string_view code, std::uint64_t hash, const Program& program, std::uint64_t parse_time) {
+      if (directory.empty()) {
+         return;
+      }
+
+      std::string data;
+      Writer writer (data);
+      try {
+         writer.raw(cache_magic, 8);
+         writer.string(cache_version);
+         writer.number(hash);
+         writer.number(code.size());
+         writer.number(parse_time);
+         writer.stmts(program.statements);
+      } catch (const Corrupt&) {
+         return;
+      }
+
+      std::error_code error;
+      std::filesystem::create_directories(directory, error);
+      auto file = path(directory, hash);
+      auto temporary = fmt::format("{}.{}", file, getpid());
+      {
+         std::ofstream fbuf (temporary, std::ios::binary);
+         if (!fbuf.write(data.data(), data.size())) {
+            std::filesystem::remove(temporary, error);
+            return;
+         }
+      }
+      std::filesystem::rename(temporary, file, error);
+   }
+
+   bool write_stmt(std::string& data, const Stmt& stmt) {
+      auto size = data.size();
+      try {
+         Writer(data).stmt(stmt);
+         return true;
+      } catch (const Corrupt&) {
+         data.resize(size);
+         return false;
+      }
+   }
+
+   Stmt read_stmt(std::string_view data, std::size_t& position) {
+      Reader reader (data.substr(std::min(position, data.size())));
+      try {
+         auto stmt = reader.stmt();
+         position = data.size() - reader.remaining();
+         return stmt;
+      } catch (const Corrupt&) {
+         return nullptr;
+      }
+   }
+}
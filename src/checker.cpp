@@ -0,0 +1,429 @@
+#include "checker.hpp"
+
+// Includes
+
+#include "fmt.hpp"
+#include "functions.hpp"
+#include <algorithm>
+
+// Utility functions
+
+// Calls 'visit' for every child evaluated in the environment of the statement itself. Scopes and for loops evaluate
+// their children in an environment of their own, function declarations only their default values.
+template<typename F>
+static void for_each_child(Stmt& stmt, const F& visit) {
+   auto visit_all = [&](std::vector<Stmt>& stmts) {
+      for (auto& child : stmts) {
+         visit(child);
+      }
+   };
+
+   switch (stmt->type) {
+   case StmtType::var_decl:
+      visit_all(get_stmt<VarDeclaration>(stmt).values);
+      break;
+   case StmtType::fn_decl: {
+      auto& decl = get_stmt<FnDeclaration>(stmt);
+      visit_all(decl.argument_def);
+      visit(decl.return_def);
+      break;
+   }
+   case StmtType::ifelse: {
+      auto& ifelse = get_stmt<IfElseStmt>(stmt);
+      visit(ifelse.ifclause);
+      visit_all(ifelse.elifclauses);
+      if (ifelse.elseclause.has_value()) {
+         visit(ifelse.elseclause.value());
+      }
+      break;
+   }
+   case StmtType::if_clause:
+      visit(get_stmt<IfClauseStmt>(stmt).expr);
+      visit(get_stmt<IfClauseStmt>(stmt).stmt);
+      break;
+   case StmtType::while_loop:
+      visit(get_stmt<WhileStmt>(stmt).expr);
+      visit(get_stmt<WhileStmt>(stmt).stmt);
+      break;
+   case StmtType::return_stmt:
+      visit(get_stmt<ReturnStmt>(stmt).value);
+      break;
+   case StmtType::unless_stmt:
+      visit(get_stmt<UnlessStmt>(stmt).expr);
+      visit(get_stmt<UnlessStmt>(stmt).stmt);
+      break;
+   case StmtType::assignment:
+      visit(get_stmt<AssignmentExpr>(stmt).left);
+      visit(get_stmt<AssignmentExpr>(stmt).right);
+      break;
+   case StmtType::ternary:
+      visit(get_stmt<TernaryExpr>(stmt).left);
+      visit(get_stmt<TernaryExpr>(stmt).middle);
+      visit(get_stmt<TernaryExpr>(stmt).right);
+      break;
+   case StmtType::binary:
+      visit(get_stmt<BinaryExpr>(stmt).left);
+      visit(get_stmt<BinaryExpr>(stmt).right);
+      break;
+   case StmtType::unary:
+      visit(get_stmt<UnaryExpr>(stmt).value);
+      break;
+   case StmtType::member:
+      visit(get_stmt<MemberAccess>(stmt).left);
+      visit(get_stmt<MemberAccess>(stmt).key);
+      break;
+   case StmtType::property:
+      // Property names are not variables, only their arguments are evaluated
+      visit(get_stmt<PropertyAccess>(stmt).left);
+      for (auto& property : get_stmt<PropertyAccess>(stmt).right) {
+         visit(get_stmt<CallExpr>(property).args);
+      }
+      break;
+   case StmtType::call:
+      visit(get_stmt<CallExpr>(stmt).args);
+      visit(get_stmt<CallExpr>(stmt).identifier);
+      break;
+   case StmtType::args:
+      visit_all(get_stmt<ArgsListExpr>(stmt).args);
+      break;
+   case StmtType::array:
+      visit_all(get_stmt<ArrayLiteral>(stmt).array);
+      break;
+   default:
+      break;
+   }
+}
+
+// Check functions
+
+Checker::Checker() {
+   auto& global = scopes.emplace_back();
+   for (auto& builtin : fun::builtins) {
+      global.declared.emplace(builtin.name);
+      global.constants[std::string(builtin.name)] = {};
+   }
+}
+
+void Checker::check(Program& program) {
+   check_block(program.statements);
+}
+
+// Top-level statements of a streamed program are checked one at a time, later ones are not declared yet
+
+void Checker::check(Stmt& stmt) {
+   declare(scopes.back(), stmt);
+   check_statement(stmt);
+}
+
+// Lazily parsed bodies are checked on their own, the scopes around their declaration are not known anymore
+
+void Checker::check(FnDeclaration& decl) {
+   scopes.resize(1);
+   detached = true;
+   check_fn_body(decl);
+}
+
+// Statement checking functions
+
+// Check statement
+
+void Checker::check_stmt(Stmt& stmt) {
+   switch (stmt->type) {
+   case StmtType::var_decl:
+      check_var_decl(stmt);
+      break;
+   case StmtType::fn_decl:
+      check_fn_decl(stmt);
+      break;
+   case StmtType::for_loop:
+      check_for_loop(stmt);
+      break;
+   case StmtType::try_stmt:
+      check_try_stmt(stmt);
+      break;
+   case StmtType::while_loop:
+      ++loops;
+      for_each_child(stmt, [&](Stmt& child) { check_stmt(child); });
+      --loops;
+      break;
+   case StmtType::break_stmt:
+      fmt::raise_if(stmt->line, !loops && !functions, "'BreakStatement' outside of a loop.");
+      get_stmt<BreakStmt>(stmt).in_loop = loops;
+      break;
+   case StmtType::continue_stmt:
+      fmt::raise_if(stmt->line, !loops && !functions, "'ContinueStatement' outside of a loop.");
+      get_stmt<ContinueStmt>(stmt).in_loop = loops;
+      break;
+   case StmtType::return_stmt:
+      fmt::raise_if(stmt->line, !functions, "'ReturnStatement' outside of a function.");
+      check_stmt(get_stmt<ReturnStmt>(stmt).value);
+      break;
+   case StmtType::del:
+      for (const auto& identifier : get_stmt<DeleteStmt>(stmt).identifiers) {
+         auto& name = get_stmt<IdentLiteral>(identifier).identifier;
+         fmt::raise_if(identifier->line, resolve(name), "Cannot delete constant '{}'.", name);
+         use(name);
+      }
+      break;
+   case StmtType::exists:
+      use(get_stmt<IdentLiteral>(get_stmt<ExistsStmt>(stmt).identifier).identifier);
+      break;
+   case StmtType::identifier:
+      use(get_stmt<IdentLiteral>(stmt).identifier);
+      break;
+   case StmtType::assignment:
+      check_assignment(stmt);
+      break;
+   case StmtType::unary:
+      check_unary_expr(stmt);
+      break;
+   case StmtType::call:
+      check_call_expr(stmt);
+      break;
+   case StmtType::program:
+      scopes.emplace_back();
+      check_block(get_stmt<Program>(stmt).statements);
+      scopes.pop_back();
+      break;
+   default:
+      for_each_child(stmt, [&](Stmt& child) { check_stmt(child); });
+      break;
+   }
+}
+
+// Check block, the current scope is the one the statements are evaluated in
+
+void Checker::check_block(std::vector<Stmt>& statements) {
+   for (const auto& stmt : statements) {
+      declare(scopes.back(), stmt);
+   }
+
+   for (auto& stmt : statements) {
+      check_statement(stmt);
+   }
+}
+
+// Check statement of a block
+// Constants declared by the statement exist for every statement after it. Functions can call themselves, so
+// they are known before their body is checked.
+
+void Checker::check_statement(Stmt& stmt) {
+   if (stmt->type == StmtType::fn_decl && get_stmt<FnDeclaration>(stmt).identifier->type == StmtType::identifier) {
+      auto& decl = get_stmt<FnDeclaration>(stmt);
+      scopes.back().constants[get_stmt<IdentLiteral>(decl.identifier).identifier] = {true, decl.arguments.size(), decl.def_args};
+   }
+   check_stmt(stmt);
+
+   if (stmt->type == StmtType::var_decl && get_stmt<VarDeclaration>(stmt).constant) {
+      for (const auto& identifier : get_stmt<VarDeclaration>(stmt).identifiers) {
+         scopes.back().constants[get_stmt<IdentLiteral>(identifier).identifier] = {};
+      }
+   } else if (stmt->type == StmtType::import_stmt) {
+      scopes.back().constants[get_stmt<IdentLiteral>(get_stmt<ImportStmt>(stmt).identifier).identifier] = {};
+   }
+}
+
+// Check variable declaration statement
+
+void Checker::check_var_decl(Stmt& stmt) {
+   for (auto& value : get_stmt<VarDeclaration>(stmt).values) {
+      check_stmt(value);
+   }
+}
+
+// Check function declaration statement
+
+void Checker::check_fn_decl(Stmt& stmt) {
+   auto& decl = get_stmt<FnDeclaration>(stmt);
+   for (const auto& arg : decl.arguments) {
+      fmt::raise_if(arg->line, arg->type != StmtType::identifier, "Expected 'IdentifierLiteral', got '{}' instead.", stmt_type_str[int(arg->type)]);
+   }
+   for_each_child(stmt, [&](Stmt& child) { check_stmt(child); });
+
+   // Lazily parsed bodies are checked when they are parsed, every identifier in their tokens may be a variable used
+   if (decl.body->type == StmtType::program) {
+      check_fn_body(decl);
+   } else if (decl.body->type == StmtType::lazy) {
+      auto& lazy = get_stmt<LazyBody>(decl.body);
+      decl.captures.clear();
+      decl.recursive = false;
+      frames.push_back({&decl, scopes.size()});
+      for (size_t i = lazy.begin; i < lazy.end; ++i) {
+         if (lazy.tokens->at(i).type == Type::identifier) {
+            use(std::string(lazy.tokens->at(i).lexeme));
+         }
+      }
+      frames.pop_back();
+   }
+}
+
+// Check function body, it runs in an environment of its own that also holds the parameters. Loops of the caller
+// are not known, so jumps outside of the function's own loops are checked when they run.
+
+void Checker::check_fn_body(FnDeclaration& decl) {
+   auto outer_loops = loops;
+   loops = 0;
+   ++functions;
+   decl.captures.clear();
+   decl.recursive = false;
+   frames.push_back({&decl, scopes.size()});
+
+   auto& scope = scopes.emplace_back();
+   for (const auto& arg : decl.arguments) {
+      scope.declared.insert(get_stmt<IdentLiteral>(arg).identifier);
+   }
+
+   if (decl.returns->type == StmtType::identifier) {
+      scope.declared.insert(get_stmt<IdentLiteral>(decl.returns).identifier);
+   }
+   check_block(get_stmt<Program>(decl.body).statements);
+
+   scopes.pop_back();
+   frames.pop_back();
+   --functions;
+   loops = outer_loops;
+}
+
+// Check for loop statement, the initial expression and the body share an environment for every iteration
+
+void Checker::check_for_loop(Stmt& stmt) {
+   auto& loop = get_stmt<ForStmt>(stmt);
+   auto& scope = scopes.emplace_back();
+   if (loop.initexpr.has_value()) {
+      declare(scope, loop.initexpr.value());
+   }
+
+   ++loops;
+   for (auto* expr : {&loop.initexpr, &loop.condition, &loop.loopexpr}) {
+      if (expr->has_value()) {
+         check_stmt(expr->value());
+      }
+   }
+   check_block(get_stmt<Program>(loop.stmt).statements);
+   --loops;
+   scopes.pop_back();
+}
+
+// Check try statement, the handler runs in an environment of its own that also holds the error
+
+void Checker::check_try_stmt(Stmt& stmt) {
+   auto& try_stmt = get_stmt<TryStmt>(stmt);
+   check_stmt(try_stmt.body);
+
+   auto& scope = scopes.emplace_back();
+   if (try_stmt.identifier.has_value()) {
+      scope.declared.insert(get_stmt<IdentLiteral>(try_stmt.identifier.value()).identifier);
+   }
+   check_block(get_stmt<Program>(try_stmt.handler).statements);
+   scopes.pop_back();
+}
+
+// Expression checking functions
+
+// Check assignment expression
+
+void Checker::check_assignment(Stmt& expr) {
+   auto& assignment = get_stmt<AssignmentExpr>(expr);
+   fmt::raise_if(assignment.left->line, assignment.left->type != StmtType::identifier, "Expected an 'IdentifierLiteral' at the left side of the '{}' operator, got '{}'.", type_str[int(assignment.op)], stmt_type_str[int(assignment.left->type)]);
+
+   auto& identifier = get_stmt<IdentLiteral>(assignment.left).identifier;
+   fmt::raise_if(assignment.line, resolve(identifier), "Cannot assign to constant '{}'.", identifier);
+   use(identifier);
+   check_stmt(assignment.right);
+}
+
+// Check unary expression
+
+void Checker::check_unary_expr(Stmt& expr) {
+   auto& unary = get_stmt<UnaryExpr>(expr);
+   if ((unary.op == Type::increment || unary.op == Type::decrement) && unary.value->type == StmtType::identifier) {
+      auto& identifier = get_stmt<IdentLiteral>(unary.value).identifier;
+      fmt::raise_if(unary.line, resolve(identifier), "Cannot assign to constant '{}'.", identifier);
+   }
+   check_stmt(unary.value);
+}
+
+// Check call expression
+
+void Checker::check_call_expr(Stmt& expr) {
+   auto& call = get_stmt<CallExpr>(expr);
+   for_each_child(expr, [&](Stmt& child) { check_stmt(child); });
+
+   if (call.identifier->type != StmtType::identifier) {
+      return;
+   }
+
+   auto constant = resolve(get_stmt<IdentLiteral>(call.identifier).identifier);
+   if (constant && constant->function) {
+      size_t args = get_stmt<ArgsListExpr>(call.args).args.size();
+      fmt::raise_if(call.line, args > constant->parameters || args < constant->parameters - constant->def_args, "Expected 'CallExpression' argument count to match function declaration parameter count. {} != {}.", args, constant->parameters);
+   }
+}
+
+// Utility functions
+
+// Declares every identifier a statement declares in the environment it is evaluated in
+void Checker::declare(Scope& scope, const Stmt& stmt) {
+   if (stmt->type == StmtType::var_decl) {
+      for (const auto& identifier : get_stmt<VarDeclaration>(stmt).identifiers) {
+         scope.declared.insert(get_stmt<IdentLiteral>(identifier).identifier);
+      }
+   } else if (stmt->type == StmtType::fn_decl && get_stmt<FnDeclaration>(stmt).identifier->type == StmtType::identifier) {
+      scope.declared.insert(get_stmt<IdentLiteral>(get_stmt<FnDeclaration>(stmt).identifier).identifier);
+   } else if (stmt->type == StmtType::import_stmt) {
+      scope.declared.insert(get_stmt<IdentLiteral>(get_stmt<ImportStmt>(stmt).identifier).identifier);
+   }
+   for_each_child(const_cast<Stmt&>(stmt), [&](Stmt& child) { declare(scope, child); });
+}
+
+// The constant an identifier refers to whenever it is evaluated, the innermost scope declaring it decides
+const Checker::Constant* Checker::resolve(const std::string& identifier) const {
+   for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+      if (scope->declared.find(identifier) != scope->declared.end()) {
+         auto it = scope->constants.find(identifier);
+         return (it == scope->constants.end() ? nullptr : &it->second);
+      }
+   }
+   return nullptr;
+}
+
+// Index of the innermost scope declaring an identifier, -1 if none does
+int Checker::scope_of(const std::string& identifier) const {
+   for (size_t i = scopes.size(); i-- > 0;) {
+      if (scopes[i].declared.find(identifier) != scopes[i].declared.end()) {
+         return i;
+      }
+   }
+   return -1;
+}
+
+// Variables declared in an enclosing function's scopes are captured by every function between it and the use. The
+// depth counts the environments from the one a function is declared in to the one holding the variable, which is
+// the captured environment of the function around it for variables declared outside of that one. Global variables
+// are never captured, and a function using its own name calls itself rather than capturing the variable.
+void Checker::use(const std::string& identifier) {
+   int scope = scope_of(identifier);
+   if (scope == 0 || (scope == -1 && !detached)) {
+      return;
+   }
+
+   for (size_t i = frames.size(); i-- > 0;) {
+      auto& frame = frames[i];
+      if (scope != -1 && frame.scope <= size_t(scope)) {
+         break;
+      }
+
+      auto& decl = *frame.decl;
+      if (scope != -1 && size_t(scope) + 1 == frame.scope && decl.identifier->type == StmtType::identifier && get_stmt<IdentLiteral>(decl.identifier).identifier == identifier) {
+         decl.recursive = true;
+         continue;
+      }
+
+      size_t outer = (i > 0 ? frames[i - 1].scope : 0);
+      int depth = (scope == -1 ? -1 : int(frame.scope - (size_t(scope) >= outer ? scope + 1 : outer)));
+      auto captured = std::find_if(decl.captures.begin(), decl.captures.end(), [&](const auto& capture) { return capture.identifier == identifier; });
+      if (captured == decl.captures.end()) {
+         decl.captures.push_back({identifier, depth});
+      }
+   }
+}
@@ -0,0 +1,302 @@
+#include "cll.hpp"
+
+// Includes
+
+#include "checker.hpp"
+#include "file.hpp"
+#include "fmt.hpp"
+#include "inference.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "module.hpp"
+#include "parser.hpp"
+#include <deque>
+#include <filesystem>
+
+// Utility functions
+
+static Value to_value(const cll::Value& value, int line) {
+   if (value.is_bool()) {
+      return BoolValue::make(value.as_bool(), line);
+   } else if (value.is_number()) {
+      return NumberValue::make(value.as_number(), line);
+   } else if (value.is_char()) {
+      return CharValue::make(value.as_char(), line);
+   } else if (value.is_string()) {
+      return StringValue::make(value.as_string(), line);
+   } else if (value.is_array()) {
+      std::vector<Value> array;
+      for (const auto& element : value.as_array()) {
+         array.push_back(to_value(element, line));
+      }
+      return Array::make(std::move(array), line);
+   }
+   return NullValue::make(line);
+}
+
+static cll::Value from_value(const Value& value, int line) {
+   switch (value->type) {
+   case ValueType::null:
+      return nullptr;
+   case ValueType::boolean:
+      return get_value<BoolValue>(value).value;
+   case ValueType::number:
+      return double(get_value<NumberValue>(value).number);
+   case ValueType::character:
+      return get_value<CharValue>(value).ch;
+   case ValueType::string:
+      return get_value<StringValue>(value).string;
+   case ValueType::array: {
+      cll::Value::Array array;
+      for (const auto& element : get_value<Array>(value).array) {
+         array.push_back(from_value(element, line));
+      }
+      return array;
+   }
+   default:
+      fmt::raise(line, "Cannot pass a value of type '{}' to the host.", value_type_str[int(value->type)]);
+   }
+}
+
+// Value functions
+
+namespace cll {
+   Value::Value(std::nullptr_t)
+      : value(nullptr) {}
+
+   Value::Value(bool boolean)
+      : value(boolean) {}
+
+   Value::Value(int number)
+      : value(double(number)) {}
+
+   Value::Value(double number)
+      : value(number) {}
+
+   Value::Value(char ch)
+      : value(ch) {}
+
+   Value::Value(const char* string)
+      : value(std::string(string)) {}
+
+   Value::Value(std::string string)
+      : value(std::move(string)) {}
+
+   Value::Value(Array array)
+      : value(std::move(array)) {}
+
+   bool Value::is_null() const {
+      return std::holds_alternative<std::nullptr_t>(value);
+   }
+
+   bool Value::is_bool() const {
+      return std::holds_alternative<bool>(value);
+   }
+
+   bool Value::is_number() const {
+      return std::holds_alternative<double>(value);
+   }
+
+   bool Value::is_char() const {
+      return std::holds_alternative<char>(value);
+   }
+
+   bool Value::is_string() const {
+      return std::holds_alternative<std::string>(value);
+   }
+
+   bool Value::is_array() const {
+      return std::holds_alternative<Array>(value);
+   }
+
+   bool Value::as_bool() const {
+      return std::get<bool>(value);
+   }
+
+   double Value::as_number() const {
+      return std::get<double>(value);
+   }
+
+   char Value::as_char() const {
+      return std::get<char>(value);
+   }
+
+   const std::string& Value::as_string() const {
+      return std::get<std::string>(value);
+   }
+
+   const Value::Array& Value::as_array() const {
+      return std::get<Array>(value);
+   }
+
+   std::string Value::str() const {
+      return to_value(*this, err::nline)->as_string();
+   }
+}
+
+// Interpreter state
+
+namespace cll {
+   // Everything declared by loaded programs, dropped on reset. Programs are checked, analyzed and run a top-level
+   // statement at a time like streamed ones, so every load continues where the last one ended.
+   struct Session {
+      struct Source {
+         std::string code, file;
+      };
+
+      // Functions and errors view the code of the program they were loaded from
+      std::deque<Source> sources;
+      mod::Registry modules;
+      Environment global;
+      Checker checker;
+      TypeInference inference;
+      ::Interpreter interpreter;
+
+      Session(Environment* host)
+         : modules(std::filesystem::current_path().string()), global(host, true), interpreter(modules) {
+         inference.begin();
+         interpreter.begin();
+      }
+   };
+
+   struct Interpreter::State {
+      // Builtins and host functions, the parent of the global environment of every session
+      Environment host;
+      std::unique_ptr<Session> session;
+      ::Interpreter::Budget budget;
+
+      State()
+         : session(std::make_unique<Session>(&host)) {}
+
+      void load(std::string code, std::string file) {
+         auto& source = session->sources.emplace_back(Session::Source{std::move(code), std::move(file)});
+         err::set_program_code(source.code, source.file);
+         session->modules.set_directory(source.file.empty() ? std::filesystem::current_path().string() : std::filesystem::absolute(source.file).parent_path().string());
+
+         Lexer lexer (source.code);
+         Parser parser (lexer.lex());
+         auto& program = parser.parse();
+
+         // Programs failing their checks leave the checks of later programs as they were
+         auto checker = session->checker;
+         auto inference = session->inference;
+         try {
+            for (auto& stmt : program.statements) {
+               session->checker.check(stmt);
+            }
+            session->modules.load(program, source.code);
+            for (auto& stmt : program.statements) {
+               session->inference.analyze(stmt);
+            }
+         } catch (...) {
+            session->checker = std::move(checker);
+            session->inference = std::move(inference);
+            throw;
+         }
+
+         for (auto& stmt : program.statements) {
+            if (!session->interpreter.evaluate(std::move(stmt), session->global)) {
+               break;
+            }
+         }
+      }
+
+      // Runs a function of the embedding API, errors leave what was being evaluated and are thrown to the host
+      template<typename F>
+      auto run(const F& function) {
+         session->interpreter.restart_budget();
+         try {
+            return function();
+         } catch (const err::Error& error) {
+            session->interpreter.unwind({});
+            throw cll::Error(error.message, error.line, error.code, error.file);
+         } catch (const err::Exit& exit) {
+            session->interpreter.unwind({});
+            throw cll::Exit {exit.code};
+         }
+      }
+   };
+}
+
+// Interpreter functions
+
+namespace cll {
+   Error::Error(const std::string& message, int line, int code, std::string file)
+      : std::runtime_error(message), line(line), code(code), file(std::move(file)) {}
+
+   Interpreter::Interpreter()
+      : state(std::make_unique<State>()) {}
+
+   Interpreter::Interpreter(Interpreter&& other) noexcept = default;
+   Interpreter& Interpreter::operator=(Interpreter&& other) noexcept = default;
+   Interpreter::~Interpreter() = default;
+
+   void Interpreter::define(const std::string& name, HostFunction function) {
+      auto call = [function = std::move(function)](std::vector<::Value>& args, Environment*, int line) {
+         std::vector<Value> host_args;
+         for (const auto& arg : args) {
+            host_args.push_back(from_value(arg, line));
+         }
+
+         try {
+            return to_value(function(host_args), line);
+         } catch (const Exit& exit) {
+            err::exit(exit.code);
+         } catch (const std::exception& exception) {
+            err::raise(exception.what(), line);
+         }
+      };
+      state->run([&] {
+         state->host.declare_variable(name, NativeFn::make(call, name, err::nline), true, err::nline);
+      });
+   }
+
+   void Interpreter::load(const std::string& code) {
+      state->run([&] {
+         state->load(code, {});
+      });
+   }
+
+   void Interpreter::load_file(const std::string& path) {
+      state->run([&] {
+         fmt::raise_if(err::nline, !file::exists(path), "Cannot load '{}' as the file does not exist.", path);
+         state->load(std::string(file::Mapping(path).view()), path);
+      });
+   }
+
+   bool Interpreter::exists(const std::string& name) const {
+      return state->session->global.variable_exists(name);
+   }
+
+   Value Interpreter::get(const std::string& name) const {
+      return state->run([&] {
+         return from_value(state->session->global.get_variable(name, err::nline), err::nline);
+      });
+   }
+
+   Value Interpreter::call(const std::string& name, const std::vector<Value>& args) {
+      return state->run([&] {
+         auto& session = *state->session;
+         auto function = session.global.get_variable(name, err::nline);
+         fmt::raise_if(err::nline, function->type != ValueType::fn && function->type != ValueType::native_fn, "Expected '{}' to be a function, got '{}' instead.", name, value_type_str[int(function->type)]);
+
+         std::vector<::Value> values;
+         for (const auto& arg : args) {
+            values.push_back(to_value(arg, err::nline));
+         }
+         // Functions ending without a return statement return no value
+         auto result = session.interpreter.call_function(session.global, std::move(function), values, err::nline);
+         return (result ? from_value(result, err::nline) : Value(nullptr));
+      });
+   }
+
+   void Interpreter::reset() {
+      state->session = std::make_unique<Session>(&state->host);
+      state->session->interpreter.set_budget(state->budget);
+   }
+
+   void Interpreter::set_budget(const Budget& budget) {
+      state->budget = {budget.steps, budget.memory, budget.milliseconds};
+      state->session->interpreter.set_budget(state->budget);
+   }
+}
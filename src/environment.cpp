@@ -7,77 +7,189 @@
 
 // Constructors
 
-Environment::Environment(Environment* parent)
-   : parent(parent) {}
+Environment::Environment(Environment* parent, bool global)
+   : parent(parent), outermost(global) {}
 
 Environment::Environment()
-   : parent(nullptr)
-{
-   declare_variable("null"s, NullValue::make(err::nline), true, err::nline);
-   declare_variable("true"s, BoolValue::make(true, err::nline), true, err::nline);
-   declare_variable("false"s, BoolValue::make(false, err::nline), true, err::nline);
-
-   declare_variable("print"s, NativeFn::make(fun::print, "print"s, err::nline), true, err::nline);
-   declare_variable("println"s, NativeFn::make(fun::println, "println"s, err::nline), true, err::nline);
-   declare_variable("printf"s, NativeFn::make(fun::printf, "printf"s, err::nline), true, err::nline);
-   declare_variable("printfln"s, NativeFn::make(fun::printfln, "printfln"s, err::nline), true, err::nline);
-   declare_variable("format"s, NativeFn::make(fun::format, "format"s, err::nline), true, err::nline);
-
-   declare_variable("raise"s, NativeFn::make(fun::raise, "raise"s, err::nline), true, err::nline);
-   declare_variable("assert"s, NativeFn::make(fun::assert, "assert"s, err::nline), true, err::nline);
-   declare_variable("throw"s, NativeFn::make(fun::throw_, "throw"s, err::nline), true, err::nline);
-   declare_variable("exit"s, NativeFn::make(fun::exit, "exit"s, err::nline), true, err::nline);
-
-   declare_variable("input"s, NativeFn::make(fun::input, "input"s, err::nline), true, err::nline);
-   declare_variable("inputnum"s, NativeFn::make(fun::inputnum, "inputnum"s, err::nline), true, err::nline);
-   declare_variable("inputch"s, NativeFn::make(fun::inputch, "inputch"s, err::nline), true, err::nline);
-
-   declare_variable("string"s, NativeFn::make(fun::string, "string"s, err::nline), true, err::nline);
-   declare_variable("number"s, NativeFn::make(fun::number, "number"s, err::nline), true, err::nline);
-   declare_variable("char"s, NativeFn::make(fun::char_, "char"s, err::nline), true, err::nline);
-   declare_variable("bool"s, NativeFn::make(fun::bool_, "bool"s, err::nline), true, err::nline);
-}
+   : parent(nullptr), builtins(true), outermost(true) {}
 
 // Edit functions
 
-void Environment::declare_variable(const std::string& identifier, Value value, bool constant, int line) {
-   fmt::raise_if(line, constants.find(identifier) != constants.end(), "Cannot shadow constant variable '{}'.", identifier);
+void Environment::declare_variable(const std::string& identifier, Value value, bool constant, int line, const Annotation& annotation) {
+   fmt::raise_if(line, is_constant(identifier), "Cannot shadow constant variable '{}'.", identifier);
+
+   // Closures made before the declaration see it through their cell
+   if (!cells.empty()) {
+      if (auto it = cells.find(identifier); it != cells.end()) {
+         auto& cell = *it->second;
+         fmt::raise_if(line, !annotation.accepts_any() && !value->matches(annotation), "Expected '{}' to be '{}', got '{}' instead.", identifier, annotation.str(), value_type_str[int(value->type)]);
+         cell.value = std::move(value);
+         cell.annotation = annotation;
+         cell.constant = constant;
+         return;
+      }
+   }
+
    if (constant)
       constants.insert(identifier);
-   
+
+   if (!annotation.accepts_any()) {
+      annotations[identifier] = annotation;
+      check_annotation(identifier, value, line);
+   } else if (!annotations.empty()) {
+      annotations.erase(identifier);
+   }
+
    variables[identifier] = std::move(value);
 }
 
 void Environment::assign_variable(const std::string& identifier, Value value, int line) {
    auto& env = resolve_variable(identifier, line);
-   fmt::raise_if(line, env.constants.find(identifier) != env.constants.end(), "Cannot assign to constant '{}'.", identifier);
-   env.variables[identifier] = std::move(value);
+   fmt::raise_if(line, env.is_constant(identifier), "Cannot assign to constant '{}'.", identifier);
+   env.check_annotation(identifier, value, line);
+   env.slot(identifier) = std::move(value);
 }
 
 void Environment::delete_variable(const std::string& identifier, int line) {
    auto& env = resolve_variable(identifier, line);
-   fmt::raise_if(line, env.constants.find(identifier) != env.constants.end(), "Cannot delete constant '{}'.", identifier);
+   fmt::raise_if(line, env.is_constant(identifier), "Cannot delete constant '{}'.", identifier);
+   if (env.find_cell(identifier)) {
+      env.cells.erase(identifier);
+      return;
+   }
    fmt::raise_if(line, env.variables.find(identifier) == env.variables.end(), "Cannot delete variable '{}' as it does not exist in the given scope.", identifier);
    env.variables.erase(identifier);
+   env.annotations.erase(identifier);
+}
+
+// Assign a statically typed number without allocating a new value
+void Environment::assign_number(const std::string& identifier, long double number, int line) {
+   auto& env = resolve_variable(identifier, line);
+   fmt::raise_if(line, env.is_constant(identifier), "Cannot assign to constant '{}'.", identifier);
+
+   auto& value = env.slot(identifier);
+   if (value->type == ValueType::number) {
+      get_value<NumberValue>(value).number = number;
+   } else {
+      env.check_annotation(identifier, NumberValue::make(number, line), line);
+      value = NumberValue::make(number, line);
+   }
 }
 
 // Access functions
 
 bool Environment::variable_exists(const std::string& identifier) {
-   if (variables.find(identifier) != variables.end())
+   if (variables.find(identifier) != variables.end() || find_cell(identifier) || (builtins && fun::find_builtin(identifier)))
       return true;
    return parent && parent->variable_exists(identifier);
 }
 
 Value Environment::get_variable(const std::string& identifier, int line) {
-   auto& env = resolve_variable(identifier, line);
-   return env.variables.at(identifier)->copy();
+   for (auto env = this; env; env = env->parent) {
+      if (auto it = env->variables.find(identifier); it != env->variables.end()) {
+         return it->second->copy();
+      } else if (auto cell = env->find_cell(identifier)) {
+         return cell->value->copy();
+      } else if (auto builtin = (env->builtins ? fun::find_builtin(identifier) : nullptr)) {
+         return fun::make_builtin(*builtin);
+      }
+   }
+   fmt::raise(line, "Variable '{}' does not exist in the given scope.", identifier);
+}
+
+// Read a statically typed number without copying the value
+long double Environment::get_number(const std::string& identifier, int line) {
+   for (auto env = this; env; env = env->parent) {
+      if (auto it = env->variables.find(identifier); it != env->variables.end()) {
+         return it->second->as_number();
+      } else if (auto cell = env->find_cell(identifier)) {
+         return cell->value->as_number();
+      } else if (auto builtin = (env->builtins ? fun::find_builtin(identifier) : nullptr)) {
+         return fun::make_builtin(*builtin)->as_number();
+      }
+   }
+   fmt::raise(line, "Variable '{}' does not exist in the given scope.", identifier);
+}
+
+// Annotated variables keep their declared type, every value stored in them is checked
+void Environment::check_annotation(const std::string& identifier, const Value& value, int line) const {
+   if (annotations.empty() && cells.empty()) {
+      return;
+   }
+
+   const Annotation* annotation = nullptr;
+   if (auto cell = find_cell(identifier)) {
+      annotation = &cell->annotation;
+   } else if (auto it = annotations.find(identifier); it != annotations.end()) {
+      annotation = &it->second;
+   }
+
+   if (annotation && !annotation->accepts_any()) {
+      fmt::raise_if(line, !value->matches(*annotation), "Expected '{}' to be '{}', got '{}' instead.", identifier, annotation->str(), value_type_str[int(value->type)]);
+   }
+}
+
+bool Environment::is_constant(const std::string& identifier) const {
+   if (auto cell = find_cell(identifier)) {
+      return cell->constant;
+   }
+   return constants.find(identifier) != constants.end() || (builtins && fun::find_builtin(identifier));
+}
+
+// Value of a variable declared in this environment
+Value& Environment::slot(const std::string& identifier) {
+   if (auto cell = find_cell(identifier)) {
+      return cell->value;
+   }
+   return variables[identifier];
 }
 
 Environment& Environment::resolve_variable(const std::string& identifier, int line) {
-   if (variables.find(identifier) != variables.end())
+   if (variables.find(identifier) != variables.end() || find_cell(identifier) || (builtins && fun::find_builtin(identifier)))
       return *this;
-   
+
    fmt::raise_if(line, !parent, "Variable '{}' does not exist in the given scope.", identifier);
    return parent->resolve_variable(identifier, line);
 }
+
+Environment* Environment::global() {
+   auto env = this;
+   for (; !env->outermost && env->parent; env = env->parent);
+   return env;
+}
+
+// Closure functions
+
+// Cell of the variable in the environment 'depth' levels up, made from the variable or, if it is not declared yet,
+// left empty until it is. Variables found by name are searched for up to the global environment, whose variables
+// are never captured.
+std::shared_ptr<Cell> Environment::capture(const std::string& identifier, int depth) {
+   auto env = this;
+   if (depth < 0) {
+      for (; !env->outermost && env->parent && !env->variables.count(identifier) && !env->cells.count(identifier); env = env->parent);
+   } else {
+      for (; depth > 0 && !env->outermost && env->parent; --depth, env = env->parent);
+   }
+   if (env->outermost || !env->parent) {
+      return nullptr;
+   } else if (auto it = env->cells.find(identifier); it != env->cells.end()) {
+      return it->second;
+   }
+
+   auto cell = std::make_shared<Cell>();
+   if (auto it = env->variables.find(identifier); it != env->variables.end()) {
+      cell->value = std::move(it->second);
+      cell->constant = env->constants.erase(identifier);
+      if (auto annotation = env->annotations.find(identifier); annotation != env->annotations.end()) {
+         cell->annotation = annotation->second;
+         env->annotations.erase(annotation);
+      }
+      env->variables.erase(it);
+   }
+   env->cells[identifier] = cell;
+   return cell;
+}
+
+void Environment::bind(const std::string& identifier, std::shared_ptr<Cell> cell) {
+   cells[identifier] = std::move(cell);
+}
@@ -2,69 +2,88 @@
 
 // Includes
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-#include <sstream>
 
 // Static variables
 
-static std::string temp = "";
-static std::string& program_code = temp;
+static thread_local err::Source source;
 
 // Errors
 
 namespace err {
-   void set_program_code(std::string& code) {
-      program_code = code;
+   void set_program_code(std::string_view code, std::string_view file) {
+      source = {code, file};
    }
 
-   void raise(const std::string& msg, int line, int code) {
-      std::cout << "Program exited due to the following error:\n";
-      std::cout << " \e[91m" << msg << "\e[0m\n";
+   Source program_code() {
+      return source;
+   }
 
+   void raise(const std::string& msg, int line, int code) {
+      Error error {msg, line, code, {}, {}, {}, {}};
       if (line == err::nline) {
-         err::exit(code);
+         throw error;
       }
+      error.file = source.file;
+
+      // The last non-empty line before the line of the error and the first line after it
+      std::size_t begin = 0;
+      for (int i = 1; begin < source.code.size() && error.next.number == 0; ++i) {
+         std::size_t end = std::min(source.code.find('\n', begin), source.code.size());
+         auto text = source.code.substr(begin, end - begin);
+         begin = end + 1;
 
-      std::stringstream ss (program_code);
-      std::string previous, current, next, temp;
-      int previous_line = 0, next_line = 0;
-      int i = 1;
-      
-      while (std::getline(ss, temp)) {
-         if (i < line && !temp.empty()) {
-            previous = temp;
-            previous_line = i;
+         if (i < line && !text.empty()) {
+            error.previous = {i, std::string(text)};
          } else if (i == line) {
-            current = temp;
-         } else if (i > line && next.empty()) {
-            next = temp;
-            next_line = i;
+            error.current = {i, std::string(text)};
+         } else if (i > line && !text.empty()) {
+            error.next = {i, std::string(text)};
          }
-         ++i;
       }
+      throw error;
+   }
+
+   void exit(int code) {
+      throw Exit {code};
+   }
 
-      if (!previous.empty()) {
-         printf("  %-5d %s\n", previous_line, previous.c_str());
-         for (int i = previous_line; i < line - 1; ++i) {
+   void report(const Error& error) {
+      std::cout << "Program exited due to the following error:\n";
+      std::cout << " \e[91m" << error.message << "\e[0m\n";
+
+      if (error.line == err::nline) {
+         report(Exit {error.code});
+      }
+
+      if (!error.file.empty()) {
+         std::cout << "  In '" << error.file << "':\n";
+      }
+
+      if (!error.previous.code.empty()) {
+         printf("  %-5d %s\n", error.previous.number, error.previous.code.c_str());
+         for (int i = error.previous.number; i < error.line - 1; ++i) {
             printf("  %-5d\n", i + 1);
          }
       }
-      if (!current.empty()) {
-         printf("  %-5d %s\n", line, current.c_str());
-         printf("  %-5s \e[91m%s\e[0m\n", std::string(std::to_string(line).size(), ' ').c_str(), std::string(current.size(), '^').c_str());
+      if (!error.current.code.empty()) {
+         printf("  %-5d %s\n", error.line, error.current.code.c_str());
+         printf("  %-5s \e[91m%s\e[0m\n", std::string(std::to_string(error.line).size(), ' ').c_str(), std::string(error.current.code.size(), '^').c_str());
       }
-      if (!next.empty()) {
-         for (int i = line; i < next_line - 1; ++i) {
+      if (!error.next.code.empty()) {
+         for (int i = error.line; i < error.next.number - 1; ++i) {
             printf("  %-5d\n", i + 1);
          }
-         printf("  %-5d %s\n", next_line, next.c_str());
+         printf("  %-5d %s\n", error.next.number, error.next.code.c_str());
       }
-
-      err::exit(code);
+      report(Exit {error.code});
    }
 
-   void exit(int code) {
-      std::cout << (code == 0 ? "\n" : "\n\e[91m") << "Program exited with exit code " << code << ".\e[0m\n";
-      std::exit(code);
+   void report(const Exit& exit) {
+      std::cout << (exit.code == 0 ? "\n" : "\n\e[91m") << "Program exited with exit code " << exit.code << ".\e[0m\n";
+      std::exit(exit.code);
    }
 }
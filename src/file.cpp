@@ -3,25 +3,83 @@
 // Includes
 
 #include "fmt.hpp"
+#include <algorithm>
+#include <fcntl.h>
 #include <filesystem>
-#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // File
 
 namespace file {
+   // Mapping
+
+   Mapping::Mapping(const std::string& file) {
+      int descriptor = open(file.c_str(), O_RDONLY);
+      fmt::raise_if(err::nline, descriptor < 0, "Could not read file '{}'.", file);
+
+      struct stat info {};
+      bool valid = (fstat(descriptor, &info) == 0);
+
+      // Empty files cannot be mapped and have nothing to lex
+      if (valid && info.st_size > 0) {
+         void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+         valid = (address != MAP_FAILED);
+
+         if (valid) {
+            madvise(address, info.st_size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(address);
+            size = info.st_size;
+         }
+      }
+      close(descriptor);
+      fmt::raise_if(err::nline, !valid, "Could not read file '{}'.", file);
+   }
+
+   Mapping::Mapping(Mapping&& other) noexcept {
+      *this = std::move(other);
+   }
+
+   Mapping& Mapping::operator=(Mapping&& other) noexcept {
+      std::swap(data, other.data);
+      std::swap(size, other.size);
+      std::swap(released, other.released);
+      return *this;
+   }
+
+   Mapping::~Mapping() {
+      if (data) {
+         munmap(const_cast<char*>(data), size);
+      }
+   }
+
+   std::string_view Mapping::view() const {
+      return {data, size};
+   }
+
+   // Pages are dropped a megabyte at a time. They stay readable, since they are read from the file again.
+   void Mapping::release(std::size_t offset) {
+      std::size_t page = sysconf(_SC_PAGESIZE);
+      offset = std::min(offset, size) / page * page;
+
+      if (data && offset >= released + (1 << 20)) {
+         madvise(const_cast<char*>(data) + released, offset - released, MADV_DONTNEED);
+         released = offset;
+      }
+   }
+
    bool exists(const std::string& file) {
       try { return std::filesystem::is_regular_file(file); }
       catch (...) { return false; }
    }
 
-   std::string read(const std::string& file) {
-      std::ifstream fbuf (file);
-      fmt::raise_if(err::nline, !fbuf, "Could not read file '{}'.", file);
-
-      std::string output, temp;
-      while (std::getline(fbuf, temp)) {
-         output += temp + '\n';
+   // 64-bit FNV-1a
+   std::uint64_t hash(std::string_view code) {
+      std::uint64_t hash = 14695981039346656037ull;
+      for (unsigned char ch : code) {
+         hash = (hash ^ ch) * 1099511628211ull;
       }
-      return output;
+      return hash;
    }
 }
@@ -3,6 +3,7 @@
 // Includes
 
 #include "fmt.hpp"
+#include "tokens.hpp"
 #include <iostream>
 #include <limits>
 
@@ -149,4 +150,46 @@ namespace fun {
       fmt::raise_if(line, args.size() > 1, "'bool': Expected no arguments or a single argument.");
       return BoolValue::make((args.empty() ? false : args.at(0)->as_bool()), line);
    }
+
+   // Snapshot functions
+
+   thread_local std::function<void(const std::string& file, int line)> checkpoint_handler;
+
+   Value checkpoint(std::vector<Value>& args, Environment* env, int line) {
+      fmt::raise_if(line, args.size() != 1 || args.at(0)->type != ValueType::string, "'checkpoint': Expected a single string argument.");
+      fmt::raise_if(line, !checkpoint_handler, "'checkpoint': Only scripts run from a file by the interpreter can be checkpointed.");
+      checkpoint_handler(get_value<StringValue>(args.at(0)).string, line);
+      return NullValue::make(line);
+   }
+
+   // Builtin table functions
+
+   static constexpr auto builtin_index = [] {
+      std::array<PerfectHash<64, int>::Entry, std::size(builtins)> entries {};
+      for (std::size_t i = 0; i < entries.size(); ++i) {
+         entries[i] = {builtins[i].name, int(i)};
+      }
+      return PerfectHash<64, int>(entries);
+   }();
+
+   const Builtin* find_builtin(std::string_view name) {
+      int index = builtin_index.find(name, -1);
+      return (index == -1 ? nullptr : &builtins[index]);
+   }
+
+   Value make_builtin(const Builtin& builtin) {
+      if (builtin.call) {
+         return NativeFn::make(builtin.call, std::string(builtin.name), err::nline);
+      } else if (builtin.name == "null") {
+         return NullValue::make(err::nline);
+      }
+      return BoolValue::make(builtin.name == "true", err::nline);
+   }
+
+   StaticType builtin_type(const Builtin& builtin) {
+      if (builtin.call) {
+         return StaticType::function;
+      }
+      return (builtin.name == "null" ? StaticType::null : StaticType::boolean);
+   }
 }
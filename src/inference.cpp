@@ -0,0 +1,986 @@
+#include "inference.hpp"
+
+// Includes
+
+#include "fmt.hpp"
+#include "functions.hpp"
+#include <iostream>
+
+// Utility functions
+
+static StaticType join(StaticType t1, StaticType t2) {
+   if (t1 == t2 || t2 == StaticType::unknown) {
+      return t1;
+   } else if (t1 == StaticType::unknown) {
+      return t2;
+   }
+   return StaticType::dynamic;
+}
+
+// Result of a binary operator, mirrors ValueLiteral's operator functions
+static StaticType binary_result(Type op, StaticType t1, StaticType t2) {
+   if (is_comparison(op)) {
+      return StaticType::boolean;
+   } else if (!is_arithmetic(op)) {
+      return StaticType::dynamic;
+   } else if (t1 == StaticType::number && t2 == StaticType::number) {
+      return StaticType::number;
+   }
+
+   auto scalar = [](StaticType t) {
+      return t == StaticType::number || t == StaticType::character || t == StaticType::boolean || t == StaticType::string;
+   };
+   if (op == Type::plus && (t1 == StaticType::string || t2 == StaticType::string) && scalar(t1) && scalar(t2)) {
+      return StaticType::string;
+   }
+   return StaticType::dynamic;
+}
+
+// Result of an unary operator
+static StaticType unary_result(StaticType type) {
+   return (type == StaticType::number || type == StaticType::character || type == StaticType::null ? type : StaticType::dynamic);
+}
+
+// Types of the values of fun::builtins
+static StaticType builtin_type(const std::string& identifier) {
+   auto builtin = fun::find_builtin(identifier);
+   return (builtin ? fun::builtin_type(*builtin) : StaticType::dynamic);
+}
+
+static StaticType builtin_return_type(const std::string& identifier) {
+   auto builtin = fun::find_builtin(identifier);
+   return (builtin ? builtin->returns : StaticType::dynamic);
+}
+
+static StaticType property_type(const std::string& identifier) {
+   static const std::unordered_map<std::string, StaticType> properties {
+      {"push", StaticType::array}, {"size", StaticType::number}, {"empty", StaticType::boolean}, {"contains", StaticType::boolean},
+      {"in_bounds", StaticType::boolean}, {"clear", StaticType::array}, {"fill", StaticType::array}, {"join", StaticType::string}
+   };
+
+   auto it = properties.find(identifier);
+   return (it == properties.end() ? StaticType::dynamic : it->second);
+}
+
+// Whether the interpreter takes an unboxed fast path for the expression
+static bool is_specialized(const Stmt& stmt) {
+   switch (stmt->type) {
+   case StmtType::binary: {
+      auto& binary = get_stmt<BinaryExpr>(stmt);
+      return (binary.static_type == StaticType::number && is_arithmetic(binary.op))
+          || (is_comparison(binary.op) && binary.left->static_type == StaticType::number && binary.right->static_type == StaticType::number);
+   }
+   case StmtType::unary:
+      return stmt->static_type == StaticType::number && get_stmt<UnaryExpr>(stmt).op != Type::log_not;
+   case StmtType::assignment:
+      return stmt->static_type == StaticType::number && get_stmt<AssignmentExpr>(stmt).left->type == StmtType::identifier;
+   default:
+      return false;
+   }
+}
+
+// Analysis functions
+
+TypeInference::TypeInference(const Profile* profile)
+   : profile(profile) {}
+
+void TypeInference::analyze(Program& program) {
+   if (flow.scopes.empty()) {
+      flow.scopes.emplace_back();
+   }
+   program.static_type = analyze_block(program, false);
+}
+
+// Top-level statements of a streamed program are analyzed one at a time, in the same way analyze_block does.
+// The variables and specialized operations listed by dump() are not recorded, so memory does not grow with the
+// length of the program.
+
+void TypeInference::begin() {
+   streaming = true;
+   flow.scopes.emplace_back();
+   blocks.push_back({flow.scopes.size(), {}});
+   variables.push_back({context, {}, StaticType::unknown, 0});
+}
+
+void TypeInference::analyze(Stmt& stmt) {
+   if (flow.reachable) {
+      analyze_statement(stmt);
+   }
+}
+
+void TypeInference::dump() const {
+   for (size_t i = 0; i < contexts.size(); ++i) {
+      std::cout << contexts.at(i) << '\n';
+
+      for (const auto& variable : variables) {
+         if (variable.context == i) {
+            fmt::printfln("   {}: {} (line {})", variable.identifier, static_type_str[int(variable.type)], variable.line);
+         }
+      }
+
+      int count = 0;
+      for (const auto& [stmt, ctx] : specialized) {
+         count += (ctx == i);
+      }
+      fmt::printfln("   {} specialized operation(s)", count);
+   }
+}
+
+// Statement analysis functions
+
+// Analyze statement
+
+StaticType TypeInference::analyze_stmt(Stmt& stmt) {
+   StaticType type;
+
+   switch (stmt->type) {
+   case StmtType::var_decl:
+      type = analyze_var_decl(stmt);
+      break;
+   case StmtType::fn_decl:
+      type = analyze_fn_decl(stmt);
+      break;
+   case StmtType::del:
+      type = analyze_del_stmt(stmt);
+      break;
+   case StmtType::exists:
+      type = StaticType::boolean;
+      break;
+   case StmtType::import_stmt:
+      declare(get_stmt<ImportStmt>(stmt).identifier, StaticType::dynamic);
+      type = StaticType::null;
+      break;
+   case StmtType::ifelse:
+      type = analyze_if_else_stmt(stmt);
+      break;
+   case StmtType::while_loop:
+      type = analyze_while_loop(stmt);
+      break;
+   case StmtType::for_loop:
+      type = analyze_for_loop(stmt);
+      break;
+   case StmtType::break_stmt:
+   case StmtType::continue_stmt:
+   case StmtType::return_stmt:
+      type = analyze_jump(stmt);
+      break;
+   case StmtType::unless_stmt:
+      type = analyze_unless_stmt(stmt);
+      break;
+   case StmtType::try_stmt:
+      type = analyze_try_stmt(stmt);
+      break;
+   case StmtType::assignment:
+      type = analyze_assignment(stmt);
+      break;
+   case StmtType::ternary:
+      type = analyze_ternary_expr(stmt);
+      break;
+   case StmtType::binary:
+      type = analyze_binary_expr(stmt);
+      break;
+   case StmtType::unary:
+      type = analyze_unary_expr(stmt);
+      break;
+   case StmtType::member: {
+      auto& member = get_stmt<MemberAccess>(stmt);
+      auto left = analyze_stmt(member.left);
+      analyze_stmt(member.key);
+      type = (left == StaticType::string ? StaticType::character : element_type(member.left));
+      break;
+   }
+   case StmtType::property:
+      type = analyze_property_access(stmt);
+      break;
+   case StmtType::call:
+      type = analyze_call_expr(stmt);
+      break;
+   case StmtType::identifier:
+      type = type_of(get_stmt<IdentLiteral>(stmt).identifier);
+      break;
+   case StmtType::number:
+      type = StaticType::number;
+      break;
+   case StmtType::character:
+      type = StaticType::character;
+      break;
+   case StmtType::string:
+      type = StaticType::string;
+      break;
+   case StmtType::array:
+      for (auto& element : get_stmt<ArrayLiteral>(stmt).array) {
+         analyze_stmt(element);
+      }
+      type = StaticType::array;
+      break;
+   case StmtType::null:
+      type = StaticType::null;
+      break;
+   case StmtType::program:
+      type = analyze_block(get_stmt<Program>(stmt), true);
+      break;
+   default:
+      type = StaticType::dynamic;
+      break;
+   }
+
+   stmt->static_type = type;
+   if (!streaming && is_specialized(stmt)) {
+      specialized[stmt.get()] = context;
+   } else if (!streaming) {
+      specialized.erase(stmt.get());
+   }
+   return type;
+}
+
+// Analyze block (scope)
+// A return statement only leaves the innermost block that is being evaluated
+
+StaticType TypeInference::analyze_block(Program& program, bool scoped) {
+   if (scoped) {
+      flow.scopes.emplace_back();
+   }
+   blocks.push_back({flow.scopes.size(), {}});
+
+   StaticType last = StaticType::dynamic;
+   for (auto& stmt : program.statements) {
+      if (!flow.reachable) {
+         break;
+      }
+      last = analyze_statement(stmt);
+   }
+
+   auto block = std::move(blocks.back());
+   blocks.pop_back();
+   for (const auto& returned : block.returns) {
+      merge(flow, returned);
+      last = StaticType::dynamic;
+   }
+
+   if (scoped) {
+      flow.scopes.pop_back();
+   }
+   return last;
+}
+
+// Analyze statement of a block
+
+StaticType TypeInference::analyze_statement(Stmt& stmt) {
+   auto type = analyze_stmt(stmt);
+   if (!pending.empty()) {
+      settle(stmt->type == StmtType::break_stmt || stmt->type == StmtType::continue_stmt || stmt->type == StmtType::return_stmt);
+   }
+   return type;
+}
+
+// Analyze variable declaration statement
+
+StaticType TypeInference::analyze_var_decl(Stmt& stmt) {
+   auto& decl = get_stmt<VarDeclaration>(stmt);
+   size_t isize = decl.identifiers.size(), vsize = decl.values.size();
+
+   bool single_decl = (vsize == 1 && isize != 1);
+   StaticType first = (single_decl ? analyze_stmt(decl.values.at(0)) : StaticType::null);
+
+   for (int i = 0; i < isize; ++i) {
+      StaticType type = (single_decl || (vsize != isize && i >= vsize) ? first : analyze_stmt(decl.values.at(i)));
+      declare(decl.identifiers.at(i), type);
+   }
+   return StaticType::null;
+}
+
+// Analyze function declaration statement
+// The body is analyzed on its own, since it runs in the environment of every caller. Variables it assigns
+// without declaring them taint every scope the function can see.
+
+StaticType TypeInference::analyze_fn_decl(Stmt& stmt) {
+   auto& decl = get_stmt<FnDeclaration>(stmt);
+   for (auto& def : decl.argument_def) {
+      analyze_stmt(def);
+   }
+
+   if (decl.return_def->type != StmtType::null) {
+      analyze_stmt(decl.return_def);
+   }
+
+   // Anonymous functions are values, they are not profiled as they have no name to be found by
+   if (decl.identifier->type != StmtType::identifier) {
+      if (decl.body->type == StmtType::lazy) {
+         taint(lazy_assigned(get_stmt<LazyBody>(decl.body)));
+      } else {
+         taint(analyze_fn_body(decl, decl.body, {}));
+      }
+      return StaticType::function;
+   }
+   auto& name = get_stmt<IdentLiteral>(decl.identifier).identifier;
+   declare(decl.identifier, StaticType::function);
+   if (!decl.return_type.accepts_any()) {
+      flow.scopes.back().bindings.at(name).returns = decl.return_type.type;
+   }
+
+   // Lazily parsed bodies are analyzed by their first call (see analyze(FnDeclaration&))
+   if (decl.body->type == StmtType::lazy) {
+      taint(lazy_assigned(get_stmt<LazyBody>(decl.body)));
+      return StaticType::null;
+   }
+   auto assigned = analyze_fn_body(decl, decl.body, {});
+
+   // Parameter types that never changed in the profiled runs get their own copy of the body
+   if (profile) {
+      decl.guards = profile->guards(decl.line, name, decl.arguments.size());
+      if (!decl.guards.empty()) {
+         decl.guarded_body = decl.body->clone();
+         analyze_fn_body(decl, decl.guarded_body, decl.guards);
+      }
+   }
+
+   taint(assigned);
+   return StaticType::null;
+}
+
+// Taints the variables of outer scopes a function assigns
+
+void TypeInference::taint(const std::unordered_set<std::string>& assigned) {
+   for (auto& scope : flow.scopes) {
+      for (const auto& identifier : assigned) {
+         scope.tainted.insert(identifier);
+         if (auto it = scope.bindings.find(identifier); it != scope.bindings.end()) {
+            record(it->second, StaticType::dynamic);
+         }
+      }
+   }
+
+   // The function itself may assign variables of its caller's enclosing function
+   if (fn_base != 0) {
+      free_assigned.insert(assigned.begin(), assigned.end());
+   }
+   catchable();
+}
+
+// Variables a lazily parsed body might assign, found from its tokens. Every identifier next to an assignment
+// operator, '++' or '--' (through parentheses) or after 'delete' counts, which includes the ones it declares itself.
+
+std::unordered_set<std::string> TypeInference::lazy_assigned(const LazyBody& body) {
+   std::unordered_set<std::string> assigned;
+   auto& tokens = *body.tokens;
+
+   for (size_t i = body.begin; i < body.end; ++i) {
+      auto type = tokens.at(i).type;
+      if (type == Type::kw_break || type == Type::kw_continue) {
+         stray_jumps = true;
+      } else if (type == Type::kw_delete) {
+         for (size_t j = i + 1; j < body.end && tokens.at(j).type == Type::identifier; j += 2) {
+            assigned.emplace(tokens.at(j).lexeme);
+            if (j + 1 >= body.end || tokens.at(j + 1).type != Type::comma) {
+               break;
+            }
+         }
+      } else if (type >= Type::increment && type <= Type::exponentiate_eq) {
+         size_t before = i;
+         for (; before > body.begin && tokens.at(before - 1).type == Type::r_paren; --before);
+         if (before > body.begin && tokens.at(before - 1).type == Type::identifier) {
+            assigned.emplace(tokens.at(before - 1).lexeme);
+         }
+
+         size_t after = i + 1;
+         for (; after < body.end && tokens.at(after).type == Type::l_paren; ++after);
+         if (type <= Type::decrement && after < body.end && tokens.at(after).type == Type::identifier) {
+            assigned.emplace(tokens.at(after).lexeme);
+         }
+      }
+   }
+   return assigned;
+}
+
+// Analyze a lazily parsed function body on its own, as analyze_fn_decl would have. Other functions are not known
+// anymore, so every call is assumed to possibly leave the loop it was made from.
+
+void TypeInference::analyze(FnDeclaration& decl) {
+   flow.scopes.emplace_back();
+   stray_jumps = true;
+   analyze_fn_body(decl, decl.body, {});
+}
+
+// Analyze function body in a context of its own, returns the variables of outer scopes it assigns
+
+std::unordered_set<std::string> TypeInference::analyze_fn_body(FnDeclaration& decl, Stmt& body, const std::vector<StaticType>& guards) {
+   auto name = (decl.identifier->type == StmtType::identifier ? get_stmt<IdentLiteral>(decl.identifier).identifier : "<anonymous>"s);
+   auto outer_flow = flow;
+   auto outer_loops = std::move(loops);
+   auto outer_blocks = std::move(blocks);
+   auto outer_assigned = std::move(free_assigned);
+   auto outer_pending = std::move(pending);
+   auto outer_base = fn_base, outer_context = context;
+   auto outer_name = std::move(fn_name);
+   auto outer_returns = fn_returns;
+   auto outer_tries = std::move(tries);
+
+   tries.clear();
+   loops.clear();
+   blocks.clear();
+   free_assigned.clear();
+   pending.clear();
+   fn_base = flow.scopes.size();
+   context = contexts.size();
+   fn_name = name;
+   fn_returns = (decl.return_type.accepts_any() ? StaticType::unknown : decl.return_type.type);
+
+   if (guards.empty()) {
+      contexts.push_back(fmt::format("fn {} (line {})", name, decl.line));
+   } else {
+      std::string types;
+      for (auto guard : guards) {
+         types += (types.empty() ? ""s : ", "s) + std::string(static_type_str[int(guard == StaticType::unknown ? StaticType::dynamic : guard)]);
+      }
+      contexts.push_back(fmt::format("fn {} (line {}, guarded on {})", name, decl.line, types));
+   }
+
+   flow.reachable = true;
+   flow.scopes.emplace_back();
+   for (size_t i = 0; i < decl.arguments.size(); ++i) {
+      auto& argument = decl.arguments.at(i);
+      if (argument->type == StmtType::identifier) {
+         declare(argument, (guards.empty() || guards.at(i) == StaticType::unknown ? StaticType::dynamic : guards.at(i)));
+      }
+   }
+
+   if (decl.returns->type == StmtType::identifier) {
+      declare(decl.returns, StaticType::dynamic);
+   }
+   body->static_type = analyze_block(get_stmt<Program>(body), false);
+
+   auto assigned = std::move(free_assigned);
+   flow = std::move(outer_flow);
+   loops = std::move(outer_loops);
+   blocks = std::move(outer_blocks);
+   free_assigned = std::move(outer_assigned);
+   pending = std::move(outer_pending);
+   fn_base = outer_base;
+   context = outer_context;
+   fn_name = std::move(outer_name);
+   fn_returns = outer_returns;
+   tries = std::move(outer_tries);
+   return assigned;
+}
+
+// Analyze delete statement
+
+StaticType TypeInference::analyze_del_stmt(Stmt& stmt) {
+   for (const auto& identifier : get_stmt<DeleteStmt>(stmt).identifiers) {
+      remove(get_stmt<IdentLiteral>(identifier).identifier);
+   }
+   return StaticType::null;
+}
+
+// Analyze if-else statement
+
+StaticType TypeInference::analyze_if_else_stmt(Stmt& stmt) {
+   auto& ifelse = get_stmt<IfElseStmt>(stmt);
+   auto& ifclause = get_stmt<IfClauseStmt>(ifelse.ifclause);
+   Flow result {{}, false};
+   StaticType type = StaticType::unknown;
+
+   analyze_stmt(ifclause.expr);
+   Flow condition = flow;
+   type = join(type, analyze_stmt(ifclause.stmt));
+   merge(result, flow);
+
+   for (auto& elif : ifelse.elifclauses) {
+      auto& elifclause = get_stmt<IfClauseStmt>(elif);
+      flow = condition;
+      analyze_stmt(elifclause.expr);
+      condition = flow;
+      type = join(type, analyze_stmt(elifclause.stmt));
+      merge(result, flow);
+   }
+
+   flow = condition;
+   if (ifelse.elseclause.has_value()) {
+      auto& elseclause = get_stmt<IfClauseStmt>(ifelse.elseclause.value());
+      type = join(type, analyze_stmt(elseclause.stmt));
+   } else {
+      type = join(type, StaticType::null);
+   }
+   merge(result, flow);
+
+   flow = std::move(result);
+   return type;
+}
+
+// Analyze while loop statement
+
+StaticType TypeInference::analyze_while_loop(Stmt& stmt) {
+   auto& while_stmt = get_stmt<WhileStmt>(stmt);
+   loops.push_back({flow.scopes.size(), {}, {}});
+   Flow exit;
+
+   while (true) {
+      Flow head = flow;
+      if (!while_stmt.infinite) {
+         analyze_stmt(while_stmt.expr);
+      }
+      exit = flow;
+      exit.reachable = exit.reachable && !while_stmt.infinite;
+
+      loops.back().breaks.clear();
+      loops.back().continues.clear();
+      analyze_stmt(while_stmt.stmt);
+
+      for (const auto& continued : loops.back().continues) {
+         merge(flow, continued);
+      }
+
+      Flow next = head;
+      merge(next, flow);
+      if (same(next, head)) {
+         break;
+      }
+      flow = std::move(next);
+   }
+
+   for (const auto& broken : loops.back().breaks) {
+      merge(exit, broken);
+   }
+   loops.pop_back();
+   flow = std::move(exit);
+   return StaticType::dynamic;
+}
+
+// Analyze for loop statement
+
+StaticType TypeInference::analyze_for_loop(Stmt& stmt) {
+   auto& for_stmt = get_stmt<ForStmt>(stmt);
+   flow.scopes.emplace_back();
+
+   if (for_stmt.initexpr.has_value()) {
+      analyze_stmt(for_stmt.initexpr.value());
+   }
+   loops.push_back({flow.scopes.size(), {}, {}});
+   Flow exit;
+
+   while (true) {
+      Flow head = flow;
+      if (for_stmt.condition.has_value()) {
+         analyze_stmt(for_stmt.condition.value());
+      }
+      exit = flow;
+      exit.reachable = exit.reachable && for_stmt.condition.has_value();
+
+      loops.back().breaks.clear();
+      loops.back().continues.clear();
+      for_stmt.stmt->static_type = analyze_block(get_stmt<Program>(for_stmt.stmt), false);
+
+      for (const auto& continued : loops.back().continues) {
+         merge(flow, continued);
+      }
+
+      if (for_stmt.loopexpr.has_value() && flow.reachable) {
+         analyze_stmt(for_stmt.loopexpr.value());
+      }
+
+      Flow next = head;
+      merge(next, flow);
+      if (same(next, head)) {
+         break;
+      }
+      flow = std::move(next);
+   }
+
+   for (const auto& broken : loops.back().breaks) {
+      merge(exit, broken);
+   }
+   loops.pop_back();
+   flow = std::move(exit);
+   flow.scopes.pop_back();
+   return StaticType::dynamic;
+}
+
+// Analyze unless statement
+
+StaticType TypeInference::analyze_unless_stmt(Stmt& stmt) {
+   auto& unless = get_stmt<UnlessStmt>(stmt);
+   analyze_stmt(unless.expr);
+
+   Flow skipped = flow;
+   analyze_stmt(unless.stmt);
+   merge(flow, skipped);
+   return StaticType::dynamic;
+}
+
+// Analyze try statement
+// Errors can be raised anywhere in the body, so the handler starts with every type a variable of the enclosing scopes
+// had in it (see TypeInference::catchable()). The handler runs in a scope of its own that holds the error.
+
+StaticType TypeInference::analyze_try_stmt(Stmt& stmt) {
+   auto& try_stmt = get_stmt<TryStmt>(stmt);
+   tries.push_back(flow);
+   analyze_stmt(try_stmt.body);
+
+   Flow done = std::move(flow);
+   flow = std::move(tries.back());
+   tries.pop_back();
+
+   flow.scopes.emplace_back();
+   if (try_stmt.identifier.has_value()) {
+      declare(try_stmt.identifier.value(), StaticType::dynamic);
+   }
+   try_stmt.handler->static_type = analyze_block(get_stmt<Program>(try_stmt.handler), false);
+   flow.scopes.pop_back();
+
+   merge(flow, done);
+   return StaticType::dynamic;
+}
+
+// Analyze break, continue and return statements
+// Jumps take effect once the statement containing them is done, see TypeInference::settle()
+
+StaticType TypeInference::analyze_jump(Stmt& stmt) {
+   if (stmt->type == StmtType::return_stmt) {
+      analyze_stmt(get_stmt<ReturnStmt>(stmt).value);
+   }
+
+   if (flow.reachable) {
+      pending.push_back(stmt->type);
+   }
+   return StaticType::dynamic;
+}
+
+// Expression analysis functions
+
+// Analyze assignment expression
+
+StaticType TypeInference::analyze_assignment(Stmt& expr) {
+   auto& assignment = get_stmt<AssignmentExpr>(expr);
+   auto right = analyze_stmt(assignment.right);
+
+   if (assignment.left->type != StmtType::identifier) {
+      return StaticType::dynamic;
+   }
+
+   auto& identifier = get_stmt<IdentLiteral>(assignment.left).identifier;
+   auto type = right;
+
+   if (assignment.op != Type::assign) {
+      assignment.left->static_type = type_of(identifier);
+      type = binary_result(compound_op(assignment.op), assignment.left->static_type, right);
+   }
+   assign(identifier, type, assignment.line);
+   return type;
+}
+
+// Analyze ternary expression
+
+StaticType TypeInference::analyze_ternary_expr(Stmt& expr) {
+   auto& ternary = get_stmt<TernaryExpr>(expr);
+   analyze_stmt(ternary.left);
+
+   Flow condition = flow;
+   auto middle = analyze_stmt(ternary.middle);
+   std::swap(condition, flow);
+   auto right = analyze_stmt(ternary.right);
+
+   merge(flow, condition);
+   return join(middle, right);
+}
+
+// Analyze binary expression
+
+StaticType TypeInference::analyze_binary_expr(Stmt& expr) {
+   auto& binary = get_stmt<BinaryExpr>(expr);
+   auto left = analyze_stmt(binary.left);
+
+   // Right side is only evaluated conditionally
+   if (binary.op == Type::binary_cond || binary.op == Type::log_and || binary.op == Type::log_or) {
+      Flow skipped = flow;
+      auto right = analyze_stmt(binary.right);
+      merge(flow, skipped);
+
+      if (binary.op != Type::binary_cond) {
+         return StaticType::boolean;
+      } else if (left == StaticType::null) {
+         return right;
+      }
+      return (left == StaticType::dynamic || left == StaticType::unknown ? StaticType::dynamic : left);
+   }
+
+   auto right = analyze_stmt(binary.right);
+   return binary_result(binary.op, left, right);
+}
+
+// Analyze unary expression
+
+StaticType TypeInference::analyze_unary_expr(Stmt& expr) {
+   auto& unary = get_stmt<UnaryExpr>(expr);
+
+   if ((unary.op == Type::increment || unary.op == Type::decrement) && unary.value->type == StmtType::identifier) {
+      auto& identifier = get_stmt<IdentLiteral>(unary.value).identifier;
+      unary.value->static_type = type_of(identifier);
+
+      auto type = unary_result(unary.value->static_type);
+      assign(identifier, type, unary.line);
+      return type;
+   }
+
+   auto type = analyze_stmt(unary.value);
+   switch (unary.op) {
+   case Type::plus:
+      return type;
+   case Type::log_not:
+      return StaticType::boolean;
+   default:
+      return unary_result(type);
+   }
+}
+
+// Analyze property access expression
+
+StaticType TypeInference::analyze_property_access(Stmt& expr) {
+   auto& prop = get_stmt<PropertyAccess>(expr);
+   auto type = analyze_stmt(prop.left);
+
+   for (auto& property : prop.right) {
+      auto& call = get_stmt<CallExpr>(property);
+      for (auto& arg : get_stmt<ArgsListExpr>(call.args).args) {
+         analyze_stmt(arg);
+      }
+
+      // Properties only exist for arrays
+      type = (type == StaticType::array ? property_type(get_stmt<IdentLiteral>(call.identifier).identifier) : StaticType::dynamic);
+      property->static_type = type;
+   }
+   return type;
+}
+
+// Analyze call expression
+
+StaticType TypeInference::analyze_call_expr(Stmt& expr) {
+   auto& call = get_stmt<CallExpr>(expr);
+   for (auto& arg : get_stmt<ArgsListExpr>(call.args).args) {
+      analyze_stmt(arg);
+   }
+
+   if (call.identifier->type != StmtType::identifier) {
+      analyze_stmt(call.identifier);
+      call_boundary();
+      return StaticType::dynamic;
+   }
+
+   auto& identifier = get_stmt<IdentLiteral>(call.identifier).identifier;
+   bool tainted = false;
+   auto binding = resolve(identifier, tainted);
+   call_boundary();
+
+   // Functions are constant, so an annotated return type holds for every call
+   if (binding) {
+      return (!tainted && binding->returns != StaticType::unknown ? binding->returns : StaticType::dynamic);
+   } else if (fn_base == 0) {
+      return builtin_return_type(identifier);
+   } else if (identifier == fn_name && fn_returns != StaticType::unknown) {
+      return fn_returns;
+   }
+   return StaticType::dynamic;
+}
+
+// Utility functions
+
+TypeInference::Binding* TypeInference::resolve(const std::string& identifier, bool& tainted) {
+   for (size_t i = flow.scopes.size(); i-- > fn_base;) {
+      auto& scope = flow.scopes.at(i);
+      if (auto it = scope.bindings.find(identifier); it != scope.bindings.end()) {
+         tainted = scope.tainted.find(identifier) != scope.tainted.end();
+         return &it->second;
+      }
+   }
+   return nullptr;
+}
+
+// Elements of annotated arrays are checked whenever the array is stored
+StaticType TypeInference::element_type(const Stmt& array) {
+   if (array->type != StmtType::identifier) {
+      return StaticType::dynamic;
+   }
+
+   bool tainted = false;
+   auto binding = resolve(get_stmt<IdentLiteral>(array).identifier, tainted);
+   if (!binding || binding->declared.type != StaticType::array || binding->declared.element == StaticType::unknown) {
+      return StaticType::dynamic;
+   }
+   return binding->declared.element;
+}
+
+StaticType TypeInference::type_of(const std::string& identifier) {
+   bool tainted = false;
+   if (auto binding = resolve(identifier, tainted)) {
+      return (tainted && binding->declared.accepts_any() ? StaticType::dynamic : binding->type);
+   }
+
+   // Variables of the enclosing scopes can change between calls
+   return (fn_base == 0 ? builtin_type(identifier) : StaticType::dynamic);
+}
+
+void TypeInference::declare(const Stmt& identifier, StaticType type) {
+   auto& name = get_stmt<IdentLiteral>(identifier).identifier;
+   auto& annotation = get_stmt<IdentLiteral>(identifier).annotation;
+   auto& scope = flow.scopes.back();
+   if (!annotation.accepts_any() && type != StaticType::unknown && type != StaticType::dynamic) {
+      fmt::raise_if(identifier->line, type != annotation.type, "Expected '{}' to be '{}', got '{}' instead.", name, annotation.str(), static_type_str[int(type)]);
+   }
+
+   if (scope.tainted.find(name) != scope.tainted.end()) {
+      type = StaticType::dynamic;
+   }
+
+   // Streamed programs share a single variable record
+   size_t variable = 0;
+   if (!streaming) {
+      auto [it, inserted] = variable_index.insert({identifier.get(), variables.size()});
+      if (inserted) {
+         variables.push_back({context, name, StaticType::unknown, identifier->line});
+      }
+      variable = it->second;
+   }
+
+   scope.bindings[name] = {StaticType::unknown, variable, (annotation.accepts_any() ? Annotation{} : annotation)};
+   record(scope.bindings[name], type);
+   identifier->static_type = type;
+   catchable();
+}
+
+void TypeInference::assign(const std::string& identifier, StaticType type, int line) {
+   bool tainted = false;
+   if (auto binding = resolve(identifier, tainted)) {
+      auto& declared = binding->declared;
+      if (!declared.accepts_any() && type != StaticType::unknown && type != StaticType::dynamic) {
+         fmt::raise_if(line, type != declared.type, "Expected '{}' to be '{}', got '{}' instead.", identifier, declared.str(), static_type_str[int(type)]);
+      }
+      record(*binding, (tainted ? StaticType::dynamic : type));
+      catchable();
+   } else if (fn_base != 0) {
+      free_assigned.insert(identifier);
+   }
+}
+
+void TypeInference::remove(const std::string& identifier) {
+   for (size_t i = flow.scopes.size(); i-- > fn_base;) {
+      if (flow.scopes.at(i).bindings.erase(identifier)) {
+         catchable();
+         return;
+      }
+   }
+
+   if (fn_base != 0) {
+      free_assigned.insert(identifier);
+   }
+}
+
+void TypeInference::record(Binding& binding, StaticType type) {
+   binding.type = (binding.declared.accepts_any() || (type != StaticType::dynamic && type != StaticType::unknown) ? type : binding.declared.type);
+   auto& variable = variables.at(binding.variable);
+   variable.type = join(variable.type, binding.type);
+}
+
+void TypeInference::merge(Flow& into, const Flow& other) {
+   if (!other.reachable) {
+      return;
+   } else if (!into.reachable) {
+      into = other;
+      return;
+   }
+
+   for (size_t i = 0; i < into.scopes.size() && i < other.scopes.size(); ++i) {
+      auto& scope = into.scopes.at(i);
+      auto& other_scope = other.scopes.at(i);
+
+      // A binding missing on one of the paths might refer to a variable of an outer scope
+      for (auto& [identifier, binding] : scope.bindings) {
+         auto it = other_scope.bindings.find(identifier);
+         if (it == other_scope.bindings.end()) {
+            binding = {binding.type, binding.variable};
+            record(binding, StaticType::dynamic);
+            continue;
+         }
+
+         if (binding.declared.type != it->second.declared.type || binding.declared.element != it->second.declared.element) {
+            binding.declared = {};
+         }
+
+         if (binding.returns != it->second.returns) {
+            binding.returns = StaticType::unknown;
+         }
+         record(binding, join(binding.type, it->second.type));
+      }
+
+      for (const auto& [identifier, binding] : other_scope.bindings) {
+         if (scope.bindings.find(identifier) == scope.bindings.end()) {
+            scope.bindings[identifier] = {binding.type, binding.variable};
+            record(scope.bindings[identifier], StaticType::dynamic);
+         }
+      }
+      scope.tainted.insert(other_scope.tainted.begin(), other_scope.tainted.end());
+   }
+}
+
+// Jumps leave the innermost block (return) or loop (break, continue) being evaluated
+void TypeInference::settle(bool unconditional) {
+   for (auto type : pending) {
+      if (type == StmtType::return_stmt) {
+         blocks.back().returns.push_back(truncate(blocks.back().depth));
+      } else if (loops.empty()) {
+         // Leaves the loop of whoever called the function
+         stray_jumps = true;
+      } else {
+         auto& loop = loops.back();
+         (type == StmtType::break_stmt ? loop.breaks : loop.continues).push_back(truncate(loop.depth));
+      }
+   }
+
+   pending.clear();
+   if (unconditional) {
+      flow.reachable = false;
+   }
+}
+
+// A called function may break out of or continue the loop it was called from
+void TypeInference::call_boundary() {
+   if (stray_jumps && !loops.empty() && flow.reachable) {
+      auto& loop = loops.back();
+      loop.breaks.push_back(truncate(loop.depth));
+      loop.continues.push_back(truncate(loop.depth));
+   }
+}
+
+// Errors raised after a variable changed are caught with its new type by every enclosing try statement
+void TypeInference::catchable() {
+   for (auto& caught : tries) {
+      merge(caught, truncate(caught.scopes.size()));
+   }
+}
+
+TypeInference::Flow TypeInference::truncate(size_t depth) const {
+   Flow truncated;
+   truncated.scopes.assign(flow.scopes.begin(), flow.scopes.begin() + std::min(depth, flow.scopes.size()));
+   truncated.reachable = flow.reachable;
+   return truncated;
+}
+
+bool TypeInference::same(const Flow& f1, const Flow& f2) const {
+   if (f1.reachable != f2.reachable || f1.scopes.size() != f2.scopes.size()) {
+      return false;
+   }
+
+   for (size_t i = 0; i < f1.scopes.size(); ++i) {
+      auto& s1 = f1.scopes.at(i);
+      auto& s2 = f2.scopes.at(i);
+      if (s1.bindings.size() != s2.bindings.size() || s1.tainted != s2.tainted) {
+         return false;
+      }
+
+      for (const auto& [identifier, binding] : s1.bindings) {
+         auto it = s2.bindings.find(identifier);
+         if (it == s2.bindings.end() || it->second.type != binding.type) {
+            return false;
+         }
+      }
+   }
+   return true;
+}
@@ -2,71 +2,242 @@
 
 // Includes
 
+#include "checker.hpp"
 #include "fmt.hpp"
+#include "inference.hpp"
+#include "module.hpp"
+#include "parser.hpp"
 #include "properties.hpp"
+#include <algorithm>
+#include <cmath>
+#include <optional>
 
 // Evaluation functions
 
+Interpreter::Interpreter(mod::Registry& modules, Profile* profile, bool jit)
+   : modules(modules), profile(profile), jit(jit) {}
+
+// Values made while running are charged to the memory budget of the interpreter running them, if it has one
+
 Value Interpreter::evaluate(Program& program, Environment& env) {
+   mem::Scope scope (budget.memory ? &memory : nullptr);
    Value last;
    int id = ++fn_counter;
 
    for (auto& ast : program.statements) {
-      last = evaluate_stmt(env, std::move(ast));
-
-      if (!return_stack.empty() && return_stack.top() >= id) {
-         while (!return_stack.empty()) {
-            return_stack.pop();
-         }
-         return std::move(last);
-      }
-
-      if (should_break || should_continue) {
-         return std::move(last);
+      if (!evaluate_step(env, std::move(ast), id, last)) {
+         break;
       }
    }
    return std::move(last);
 }
 
+// Top-level statements of a streamed program are evaluated one at a time as they are parsed
+
+void Interpreter::begin() {
+   stream_id = ++fn_counter;
+}
+
+bool Interpreter::evaluate(Stmt stmt, Environment& env) {
+   mem::Scope scope (budget.memory ? &memory : nullptr);
+   Value last;
+   return evaluate_step(env, std::move(stmt), stream_id, last);
+}
+
+// Errors leave the loops, calls and imports they were raised in without finishing them
+
+Interpreter::Frame Interpreter::frame() const {
+   return {loop_stack.size(), return_stack.size(), importing.size()};
+}
+
+void Interpreter::unwind(const Frame& frame) {
+   while (loop_stack.size() > frame.loops) {
+      loop_stack.pop();
+   }
+   while (return_stack.size() > frame.returns) {
+      return_stack.pop();
+   }
+   importing.resize(std::min(importing.size(), frame.importing));
+   should_break = should_continue = false;
+}
+
+// Budgets are charged a step at every loop iteration and call. Time costs more to measure than a step, so it is
+// measured every few steps only. Memory is counted by the values themselves (see mem::Account), and builtins about
+// to allocate much refuse to once it would be exceeded.
+
+void Interpreter::set_budget(const Budget& budget) {
+   this->budget = budget;
+   budgeted = budget.steps || budget.memory || budget.milliseconds;
+   restart_budget();
+}
+
+void Interpreter::restart_budget() {
+   steps = grace = 0;
+   expired = false;
+   memory = {0, budget.memory};
+   time_start = std::chrono::steady_clock::now();
+}
+
+void Interpreter::spend(int line) {
+   ++steps;
+   if (grace) {
+      expired = expired || steps > grace;
+      fmt::raise_if(line, expired, "Exceeded the budget and the steps given to handle it.");
+      return;
+   }
+
+   std::string exceeded;
+   if (budget.steps && steps > budget.steps) {
+      exceeded = fmt::format("{} steps", budget.steps);
+   } else if (steps % 256 == 0 && budget.milliseconds && std::uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - time_start).count()) > budget.milliseconds) {
+      exceeded = fmt::format("{} ms", budget.milliseconds);
+   } else if (memory.overdrawn) {
+      // The builtin refusing to allocate raised the error already
+      grace = steps + 1024;
+      return;
+   } else if (budget.memory && memory.used > budget.memory) {
+      exceeded = fmt::format("{} bytes of memory", budget.memory);
+   }
+
+   if (!exceeded.empty()) {
+      grace = steps + 1024;
+      fmt::raise(line, "Exceeded the budget of {}.", exceeded);
+   }
+}
+
 Value Interpreter::call_function(Environment& env, Value func, std::vector<Value>& args, int line) {
+   mem::Scope scope (budget.memory ? &memory : nullptr);
+   charge(line);
    if (func->type == ValueType::native_fn) {
       auto& native = get_value<NativeFn>(func);
       return native.call(args, &env, line);
    } else if (func->type == ValueType::fn) {
       auto& fn = get_value<Function>(func);
       fmt::raise_if(line, args.size() > fn.parameters.size() || args.size() < fn.parameters.size() - fn.def_args, "Expected 'CallExpression' argument count to match function declaration parameter count. {} != {}.", args.size(), fn.parameters.size());
-      fn_stack.push(1);
+      if (profile) {
+         profile->record(fn, args);
+      }
 
-      Environment new_env (fn.env);
+      if (fn.parsed && !fn.parsed->body) {
+         parse_lazy(fn);
+      }
+
+      // Take the specialized body if the arguments match the types it was specialized for
+      const Statement* body = (fn.parsed ? fn.parsed->body.get() : fn.body.get());
+      const jit::Code* code = (fn.parsed ? fn.parsed->compiled.get() : fn.compiled.get());
+      if (fn.guarded_body) {
+         bool matches = true;
+         for (size_t i = 0; i < fn.guards.size() && matches; ++i) {
+            const auto& value = (i < args.size() ? args.at(i) : fn.parameter_def.at(i - (fn.parameters.size() - fn.def_args)));
+            matches = value->matches({fn.guards.at(i)});
+         }
+         body = (matches ? fn.guarded_body.get() : body);
+         code = (matches ? fn.compiled_guarded.get() : code);
+      }
+
+      if (code && !budgeted) {
+         return call_compiled(fn, *code, args, line);
+      }
+      // Calls keep the variables the function captured alive, even through the copy holding them weakly
+      auto captured = (fn.captured ? fn.captured : fn.weak_captured.lock());
+      Environment new_env (captured ? captured.get() : fn.env);
       int def_i = 0;
       for (int i = 0; i < fn.parameters.size(); ++i) {
          if (i < args.size()) {
-            new_env.declare_variable(fn.parameters.at(i), std::move(args.at(i)), false, args.at(i)->line);
+            new_env.declare_variable(fn.parameters.at(i), std::move(args.at(i)), false, line, fn.parameter_types.at(i));
             if (i >= fn.parameters.size() - fn.def_args) {
                ++def_i;
             }
          } else {
-            new_env.declare_variable(fn.parameters.at(i), fn.parameter_def.at(def_i)->copy(), false, fn.parameter_def.at(def_i)->line);
+            new_env.declare_variable(fn.parameters.at(i), fn.parameter_def.at(def_i)->copy(), false, fn.parameter_def.at(def_i)->line, fn.parameter_types.at(i));
             ++def_i;
          }
       }
 
       if (!fn.returns.empty()) {
-         new_env.declare_variable(fn.returns, fn.return_def->copy(), false, fn.line);
+         new_env.declare_variable(fn.returns, fn.return_def->copy(), false, fn.line, fn.returns_type);
       }
 
-      auto body_ptr = fn.body->copy();
+      auto source = err::program_code();
+      err::set_program_code(fn.source.code, fn.source.file);
+      auto body_ptr = body->copy();
       auto value = evaluate(get_stmt<Program>(body_ptr), new_env);
+      err::set_program_code(source.code, source.file);
+      if (!fn.return_type.accepts_any()) {
+         fmt::raise_if(line, !value || !value->matches(fn.return_type), "Expected '{}' to return '{}', got '{}' instead.", fn.identifier, fn.return_type.str(), (value ? value_type_str[int(value->type)] : value_type_str[int(ValueType::null)]));
+      }
 
-      fn_stack.pop();
       return std::move(value);
    } else {
       fmt::raise(line, "Attempted to call '{}', but only 'NativeFunction' and 'Function' are callable.", value_type_str[int(func->type)]);
    }
 }
 
+// Parses and checks the declaration of a lazily parsed function, whose nested functions stay lazy if 'lazy_nested' is set
+
+Stmt Interpreter::parse_decl(const Function& fn, bool lazy_nested) {
+   auto& lazy = get_stmt<LazyBody>(fn.body);
+   Parser parser (*lazy.tokens, lazy_nested);
+
+   std::vector<Stmt> arguments;
+   for (size_t i = 0; i < fn.parameters.size(); ++i) {
+      arguments.push_back(IdentLiteral::make(fn.parameters.at(i), fn.line));
+      get_stmt<IdentLiteral>(arguments.back()).annotation = fn.parameter_types.at(i);
+   }
+
+   auto returns = (fn.returns.empty() ? NullLiteral::make(fn.line) : IdentLiteral::make(fn.returns, fn.line));
+   if (!fn.returns.empty()) {
+      get_stmt<IdentLiteral>(returns).annotation = fn.returns_type;
+   }
+
+   auto stmt = FnDeclaration::make(IdentLiteral::make(fn.identifier, fn.line), std::move(arguments), {}, std::move(returns), NullLiteral::make(fn.line), parser.parse_body(lazy.begin), fn.def_args, fn.line);
+   auto& decl = get_stmt<FnDeclaration>(stmt);
+   decl.return_type = fn.return_type;
+   Checker().check(decl);
+   return stmt;
+}
+
+Stmt Interpreter::parse_body(const Function& fn) {
+   auto stmt = parse_decl(fn, false);
+   return std::move(get_stmt<FnDeclaration>(stmt).body);
+}
+
+// Parses, checks and analyzes the body of a lazily parsed function, then compiles it like evaluate_fn_decl would have
+
+void Interpreter::parse_lazy(Function& fn) {
+   auto stmt = parse_decl(fn, true);
+   auto& decl = get_stmt<FnDeclaration>(stmt);
+   modules.load(decl.body);
+
+   TypeInference inference;
+   inference.analyze(decl);
+
+   if (jit && !budgeted) {
+      std::vector<StaticType> types;
+      for (const auto& type : fn.parameter_types) {
+         types.push_back(type.type);
+      }
+      fn.parsed->compiled = jit::compile(decl, get_stmt<Program>(decl.body), types);
+   }
+   fn.parsed->body = std::move(decl.body);
+}
+
 // Statement evaluation functions
 
+// Evaluate statement of a program, returns false if the rest of the program is skipped
+
+bool Interpreter::evaluate_step(Environment& env, Stmt stmt, int id, Value& last) {
+   last = evaluate_stmt(env, std::move(stmt));
+
+   if (!return_stack.empty() && return_stack.top() >= id) {
+      while (!return_stack.empty()) {
+         return_stack.pop();
+      }
+      return false;
+   }
+   return !should_break && !should_continue;
+}
+
 // Evaluate statement
 
 Value Interpreter::evaluate_stmt(Environment& env, Stmt stmt) {
@@ -87,18 +258,21 @@ Value Interpreter::evaluate_stmt(Environment& env, Stmt stmt) {
       return evaluate_for_loop(env, std::move(stmt));
    case StmtType::break_stmt:
       should_break = true;
-      fmt::raise_if(stmt->line, loop_stack.empty(), "'BreakStatement' outside of a loop.");
+      fmt::raise_if(stmt->line, !get_stmt<BreakStmt>(stmt).in_loop && loop_stack.empty(), "'BreakStatement' outside of a loop.");
       return NullValue::make(stmt->line);
    case StmtType::continue_stmt:
       should_continue = true;
-      fmt::raise_if(stmt->line, loop_stack.empty(), "'ContinueStatement' outside of a loop.");
+      fmt::raise_if(stmt->line, !get_stmt<ContinueStmt>(stmt).in_loop && loop_stack.empty(), "'ContinueStatement' outside of a loop.");
       return NullValue::make(stmt->line);
    case StmtType::return_stmt:
       return_stack.push(fn_counter);
-      fmt::raise_if(stmt->line, fn_stack.empty(), "'ReturnStatement' outside of a function.");
       return evaluate_stmt(env, std::move(get_stmt<ReturnStmt>(stmt).value));
    case StmtType::unless_stmt:
       return evaluate_unless_stmt(env, std::move(stmt));
+   case StmtType::import_stmt:
+      return evaluate_import_stmt(env, std::move(stmt));
+   case StmtType::try_stmt:
+      return evaluate_try_stmt(env, std::move(stmt));
    default:
       return evaluate_expr(env, std::move(stmt));
    }
@@ -115,21 +289,26 @@ Value Interpreter::evaluate_var_decl(Environment& env, Stmt stmt) {
 
    for (int i = 0; i < isize; ++i) {
       Value value = (single_decl || (vsize != isize && i >= vsize) ? first->copy() : evaluate_stmt(env, std::move(decl.values.at(i))));
-      env.declare_variable(get_stmt<IdentLiteral>(decl.identifiers.at(i)).identifier, std::move(value), decl.constant, decl.line);
+      auto& identifier = get_stmt<IdentLiteral>(decl.identifiers.at(i));
+      env.declare_variable(identifier.identifier, std::move(value), decl.constant, decl.line, identifier.annotation);
    }
    return NullValue::make(decl.line);
 }
 
 // Evaluate function declaration statement
+// Functions are closures over the global environment and the cells of the variables of enclosing scopes they use,
+// so they can be called after those scopes ended. Anonymous functions are returned instead of declared.
 
 Value Interpreter::evaluate_fn_decl(Environment& env, Stmt stmt) {
    auto& decl = get_stmt<FnDeclaration>(stmt);
-   auto identifier = get_stmt<IdentLiteral>(decl.identifier);
+   bool anonymous = decl.identifier->type != StmtType::identifier;
+   auto identifier = (anonymous ? std::string("<anonymous>") : get_stmt<IdentLiteral>(decl.identifier).identifier);
 
    std::vector<std::string> parameters;
+   std::vector<Annotation> parameter_types;
    for (const auto& arg : decl.arguments) {
-      fmt::raise_if(arg->line, arg->type != StmtType::identifier, "Expected 'IdentifierLiteral', got '{}' instead.", stmt_type_str[int(arg->type)]);
       parameters.push_back(get_stmt<IdentLiteral>(arg).identifier);
+      parameter_types.push_back(get_stmt<IdentLiteral>(arg).annotation);
    }
 
    std::vector<Value> parameter_def;
@@ -138,8 +317,10 @@ Value Interpreter::evaluate_fn_decl(Environment& env, Stmt stmt) {
    }
 
    std::string returns;
+   Annotation returns_type;
    if (decl.returns->type == StmtType::identifier) {
       returns = get_stmt<IdentLiteral>(decl.returns).identifier;
+      returns_type = get_stmt<IdentLiteral>(decl.returns).annotation;
    }
 
    Value return_def = NullValue::make(decl.line);
@@ -147,9 +328,56 @@ Value Interpreter::evaluate_fn_decl(Environment& env, Stmt stmt) {
       return_def = evaluate_stmt(env, std::move(decl.return_def));
    }
 
-   auto func = Function::make(identifier.identifier, std::move(parameters), std::move(parameter_def), returns, std::move(return_def), &env, std::move(decl.body), decl.def_args, decl.line);
+   // Compile bodies whose parameters are known to be numbers, calls check the parameters before entering
+   std::shared_ptr<const jit::Code> compiled, compiled_guarded;
+   if (jit && !budgeted && decl.body->type != StmtType::lazy) {
+      std::vector<StaticType> types;
+      for (const auto& type : parameter_types) {
+         types.push_back(type.type);
+      }
+      compiled = jit::compile(decl, get_stmt<Program>(decl.body), types);
+
+      if (decl.guarded_body) {
+         for (size_t i = 0; i < types.size() && i < decl.guards.size(); ++i) {
+            types.at(i) = (types.at(i) == StaticType::unknown || types.at(i) == StaticType::dynamic ? decl.guards.at(i) : types.at(i));
+         }
+         compiled_guarded = jit::compile(decl, get_stmt<Program>(decl.guarded_body), types);
+      }
+   }
 
-   env.declare_variable(identifier.identifier, std::move(func), true, decl.line);
+   auto func = Function::make(identifier, std::move(parameters), std::move(parameter_def), std::move(parameter_types), returns, std::move(return_def), returns_type, decl.return_type, env.global(), std::move(decl.body), decl.def_args, decl.line);
+   get_value<Function>(func).compiled = std::move(compiled);
+   get_value<Function>(func).compiled_guarded = std::move(compiled_guarded);
+   get_value<Function>(func).source = err::program_code();
+   if (get_value<Function>(func).body->type == StmtType::lazy) {
+      get_value<Function>(func).parsed = std::make_shared<Function::Parsed>();
+   }
+   if (decl.guarded_body) {
+      get_value<Function>(func).guards = std::move(decl.guards);
+      get_value<Function>(func).guarded_body = std::move(decl.guarded_body);
+   }
+
+   if (!decl.captures.empty() || decl.recursive) {
+      auto& fn = get_value<Function>(func);
+      fn.captured = std::make_shared<Environment>(fn.env);
+      for (const auto& capture : decl.captures) {
+         if (auto cell = env.capture(capture.identifier, capture.depth)) {
+            fn.captured->bind(capture.identifier, std::move(cell));
+         }
+      }
+
+      if (decl.recursive) {
+         auto self = func->copy();
+         get_value<Function>(self).captured = nullptr;
+         get_value<Function>(self).weak_captured = fn.captured;
+         fn.captured->declare_variable(identifier, std::move(self), true, decl.line);
+      }
+   }
+
+   if (anonymous) {
+      return func;
+   }
+   env.declare_variable(identifier, std::move(func), true, decl.line);
    return NullValue::make(decl.line);
 }
 
@@ -208,6 +436,7 @@ Value Interpreter::evaluate_while_loop(Environment& env, Stmt stmt) {
          return std::move(result);
       }
       result = evaluate_stmt(env, while_stmt.stmt->copy());
+      charge(while_stmt.line);
 
       if (should_break) {
          should_break = false;
@@ -239,6 +468,7 @@ Value Interpreter::evaluate_for_loop(Environment& env, Stmt stmt) {
          return std::move(result);
       }
       result = evaluate(static_cast<Program&>(*for_stmt.stmt->copy().get()), new_env);
+      charge(for_stmt.line);
 
       if (should_break) {
          should_break = false;
@@ -266,6 +496,79 @@ Value Interpreter::evaluate_unless_stmt(Environment& env, Stmt stmt) {
    return NullValue::make(unless.line);
 }
 
+// Evaluate import statement, the module runs unless an earlier import ran it
+
+Value Interpreter::evaluate_import_stmt(Environment& env, Stmt stmt) {
+   auto& import = get_stmt<ImportStmt>(stmt);
+   auto& module = modules.get(import);
+
+   if (module.error) {
+      throw *module.error;
+   }
+
+   if (!module.initialized) {
+      if (module.env) {
+         std::string cycle;
+         auto it = std::find_if(importing.begin(), importing.end(), [&](const auto& entry) { return entry.first == &module; });
+         for (; it != importing.end(); ++it) {
+            cycle += "'" + it->second + "' -> ";
+         }
+         fmt::raise(import.line, "Import cycle: {}'{}'.", cycle, import.file);
+      }
+
+      auto source = err::program_code();
+      err::set_program_code(module.source.view(), module.path);
+      importing.emplace_back(&module, import.file);
+      module.env = std::make_unique<Environment>();
+
+      try {
+         evaluate(*module.program, *module.env);
+      } catch (const err::Error& error) {
+         module.error = error;
+         importing.pop_back();
+         err::set_program_code(source.code, source.file);
+         throw;
+      }
+      module.initialized = true;
+      importing.pop_back();
+      err::set_program_code(source.code, source.file);
+   }
+
+   auto& identifier = get_stmt<IdentLiteral>(import.identifier).identifier;
+   auto value = ModuleValue::make(identifier, module.env.get(), import.line);
+   get_value<ModuleValue>(value).path = module.path;
+   env.declare_variable(identifier, std::move(value), true, import.line);
+   return NullValue::make(import.line);
+}
+
+// Evaluate try statement, the handler runs in a scope of its own with the error declared in it
+
+Value Interpreter::evaluate_try_stmt(Environment& env, Stmt stmt) {
+   auto& try_stmt = get_stmt<TryStmt>(stmt);
+   auto saved = frame();
+   auto source = err::program_code();
+
+   std::optional<err::Error> caught;
+   try {
+      return evaluate_stmt(env, std::move(try_stmt.body));
+   } catch (const err::Error& error) {
+      if (expired) {
+         throw;
+      }
+      caught = error;
+   }
+
+   unwind(saved);
+   err::set_program_code(source.code, source.file);
+
+   Environment new_env (&env);
+   if (try_stmt.identifier.has_value()) {
+      auto& identifier = get_stmt<IdentLiteral>(try_stmt.identifier.value());
+      new_env.declare_variable(identifier.identifier, ErrorValue::make(caught->message, caught->line, caught->code, try_stmt.line), false, try_stmt.line, identifier.annotation);
+   }
+   return evaluate(get_stmt<Program>(try_stmt.handler), new_env);
+}
+
 // Expression evaluation functions
 
 // Evaluate expression
@@ -305,6 +608,12 @@ Value Interpreter::evaluate_ternary_expr(Environment& env, Stmt expr) {
 
 Value Interpreter::evaluate_binary_expr(Environment& env, Stmt expr) {
    auto& binary = get_stmt<BinaryExpr>(expr);
+   if (binary.static_type == StaticType::number && is_arithmetic(binary.op)) {
+      return NumberValue::make(evaluate_number(env, expr), binary.line);
+   } else if (is_comparison(binary.op) && binary.left->static_type == StaticType::number && binary.right->static_type == StaticType::number) {
+      return evaluate_number_comparison(env, binary);
+   }
+
    auto left = evaluate_stmt(env, std::move(binary.left));
 
    // Binary expressions dependant on right side value not being parsed
@@ -361,6 +670,9 @@ Value Interpreter::evaluate_binary_expr(Environment& env, Stmt expr) {
 
 Value Interpreter::evaluate_unary_expr(Environment& env, Stmt expr) {
    auto& unary = get_stmt<UnaryExpr>(expr);
+   if (unary.static_type == StaticType::number && unary.op != Type::log_not) {
+      return NumberValue::make(evaluate_number(env, expr), unary.line);
+   }
 
    switch (unary.op) {
    case Type::plus: {
@@ -430,6 +742,21 @@ Value Interpreter::evaluate_property_access(Environment& env, Stmt expr) {
    for (auto& property : prop.right) {
       auto& call = get_stmt<CallExpr>(property);
       auto identifier = get_stmt<IdentLiteral>(call.identifier).identifier;
+
+      // Functions of a module are called in the module's environment
+      if (left->type == ValueType::module) {
+         auto& module = get_value<ModuleValue>(left);
+         fmt::raise_if(prop.line, !module.env->variable_exists(identifier), "Module '{}' has no member '{}'.", module.identifier, identifier);
+
+         std::vector<Value> arg_list;
+         for (auto& arg : get_stmt<ArgsListExpr>(call.args).args) {
+            arg_list.push_back(evaluate_stmt(env, std::move(arg)));
+         }
+         auto* module_env = module.env;
+         left = call_function(*module_env, module_env->get_variable(identifier, prop.line), arg_list, prop.line);
+         original_left = NullLiteral::make();
+         continue;
+      }
       fmt::raise_if(prop.line, !prop::exists(identifier, left->type), "Property '{}' for type '{}' does not exist.", identifier, value_type_str[int(left->type)]);
 
       auto value = prop::get(identifier, left->type);
@@ -459,8 +786,10 @@ Value Interpreter::evaluate_property_access(Environment& env, Stmt expr) {
 
 Value Interpreter::evaluate_assignment(Environment& env, Stmt expr) {
    auto& assignment = get_stmt<AssignmentExpr>(expr);
-   fmt::raise_if(assignment.left->line, assignment.left->type != StmtType::identifier, "Expected an 'IdentifierLiteral' at the left side of the '{}' operator, got '{}'.", type_str[int(assignment.op)], stmt_type_str[int(assignment.left->type)]);
-   
+   if (assignment.static_type == StaticType::number) {
+      return NumberValue::make(evaluate_number(env, expr), assignment.line);
+   }
+
    auto identifier = get_stmt<IdentLiteral>(assignment.left).identifier;
    auto value = evaluate_stmt(env, std::move(assignment.right));
 
@@ -542,3 +871,132 @@ Value Interpreter::evaluate_primary_expr(Environment& env, Stmt expr) {
       fmt::raise(expr->line, "Unexpected expression while evaluating: '{}'.", stmt_type_str[int(expr->type)]);
    }
 }
+
+// Statically typed evaluation functions
+
+// Evaluate expression proven to be a number by TypeInference, without boxing intermediate values
+
+long double Interpreter::evaluate_number(Environment& env, Stmt& expr) {
+   switch (expr->type) {
+   case StmtType::number:
+      return get_stmt<NumberLiteral>(expr).number;
+   case StmtType::identifier:
+      return env.get_number(get_stmt<IdentLiteral>(expr).identifier, expr->line);
+   case StmtType::binary: {
+      auto& binary = get_stmt<BinaryExpr>(expr);
+      if (!is_arithmetic(binary.op)) {
+         break;
+      }
+
+      auto left = evaluate_number(env, binary.left);
+      auto right = evaluate_number(env, binary.right);
+      return evaluate_arithmetic(binary.op, left, right, binary.line);
+   }
+   case StmtType::unary: {
+      auto& unary = get_stmt<UnaryExpr>(expr);
+      if ((unary.op == Type::increment || unary.op == Type::decrement) && unary.value->type == StmtType::identifier) {
+         auto& identifier = get_stmt<IdentLiteral>(unary.value).identifier;
+         auto number = env.get_number(identifier, unary.line) + (unary.op == Type::increment ? 1 : -1);
+         env.assign_number(identifier, number, unary.line);
+         return number;
+      }
+
+      auto number = evaluate_number(env, unary.value);
+      switch (unary.op) {
+      case Type::minus:
+         return -number;
+      case Type::increment:
+         return number + 1;
+      case Type::decrement:
+         return number - 1;
+      default:
+         return number;
+      }
+   }
+   case StmtType::assignment: {
+      auto& assignment = get_stmt<AssignmentExpr>(expr);
+      auto& identifier = get_stmt<IdentLiteral>(assignment.left).identifier;
+      auto number = evaluate_number(env, assignment.right);
+
+      if (assignment.op != Type::assign) {
+         number = evaluate_arithmetic(compound_op(assignment.op), env.get_number(identifier, assignment.line), number, assignment.line);
+      }
+
+      env.assign_number(identifier, number, assignment.line);
+      return number;
+   }
+   default:
+      break;
+   }
+   return evaluate_stmt(env, std::move(expr))->as_number();
+}
+
+// Evaluate arithmetic operator on two numbers
+
+long double Interpreter::evaluate_arithmetic(Type op, long double left, long double right, int line) {
+   switch (op) {
+   case Type::plus:
+      return left + right;
+   case Type::minus:
+      return left - right;
+   case Type::multiply:
+      return left * right;
+   case Type::divide:
+      fmt::raise_if(line, right == 0, "Division by zero error: {} / 0.", left);
+      return left / right;
+   case Type::remainder:
+      fmt::raise_if(line, right == 0, "Division by zero error: {} %/%% 0.", left);
+      return std::remainder(left, right);
+   case Type::exponentiate:
+      return std::pow(left, right);
+   default:
+      fmt::raise(line, "Unsupported binary command '{}'.", type_str[int(op)]);
+   }
+}
+
+// Evaluate comparison of two numbers
+
+Value Interpreter::evaluate_number_comparison(Environment& env, BinaryExpr& binary) {
+   auto left = evaluate_number(env, binary.left);
+   auto right = evaluate_number(env, binary.right);
+
+   switch (binary.op) {
+   case Type::divisible:
+      return BoolValue::make(evaluate_arithmetic(Type::remainder, left, right, binary.line) == 0, binary.line);
+   case Type::equals:
+   case Type::really_equals:
+      return BoolValue::make(left == right, binary.line);
+   case Type::not_equals:
+   case Type::really_not_equals:
+      return BoolValue::make(left != right, binary.line);
+   case Type::greater:
+      return BoolValue::make(left > right, binary.line);
+   case Type::greater_equal:
+      return BoolValue::make(!(right > left), binary.line);
+   case Type::smaller:
+      return BoolValue::make(right > left, binary.line);
+   case Type::smaller_equal:
+      return BoolValue::make(!(left > right), binary.line);
+   default:
+      fmt::raise(binary.line, "Unsupported binary command '{}'.", type_str[int(binary.op)]);
+   }
+}
+
+// Compiled code functions
+
+// Call compiled function, arithmetic errors are raised with the interpreter's messages
+
+Value Interpreter::call_compiled(const Function& fn, const jit::Code& code, std::vector<Value>& args, int line) {
+   std::vector<long double> numbers;
+   for (size_t i = 0; i < args.size(); ++i) {
+      fmt::raise_if(line, !args.at(i)->matches(fn.parameter_types.at(i)), "Expected '{}' to be '{}', got '{}' instead.", fn.parameters.at(i), fn.parameter_types.at(i).str(), value_type_str[int(args.at(i)->type)]);
+      numbers.push_back(args.at(i)->as_number());
+   }
+
+   jit::Status status;
+   auto result = code.entry(numbers.data(), &status);
+   if (status.op != 0) {
+      evaluate_arithmetic(Type(status.op), status.value, 0, status.line);
+   }
+   return NumberValue::make(result, line);
+}
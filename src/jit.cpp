@@ -0,0 +1,730 @@
+#include "jit.hpp"
+
+// Includes
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#if defined(__x86_64__) && defined(__unix__)
+#define CLL_JIT 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static_assert(offsetof(jit::Status, op) == 0 && offsetof(jit::Status, line) == 4 && offsetof(jit::Status, value) == 16, "Compiled code expects this jit::Status layout.");
+
+// Compiler
+
+namespace {
+   struct Unsupported {};
+
+   struct Label {
+      size_t position = std::numeric_limits<size_t>::max();
+      std::vector<size_t> fixups;
+   };
+
+   struct Loop {
+      Label& breaks;
+      Label& continues;
+   };
+
+   // Single pass compiler. Every expression is compiled with an empty x87 stack and leaves its value in st(0),
+   // intermediate values are spilled to stack slots. Register rbx holds the jit::Status pointer.
+
+   class Compiler {
+      const FnDeclaration& decl;
+      const std::string& name;
+      std::vector<std::uint8_t> code;
+      std::vector<long double> constants;
+      std::vector<std::pair<size_t, size_t>> constant_fixups;
+      std::vector<std::unordered_map<std::string, int>> scopes;
+      std::vector<Loop> loops;
+      Label exit;
+      int slot_top = 0, slot_max = 0;
+
+      // Statement compile functions
+
+      void compile_body(const Program& body);
+      void compile_stmt(const Stmt& stmt);
+      void compile_block(const Program& program);
+      void compile_var_decl(const VarDeclaration& decl);
+      void compile_if_else(const IfElseStmt& ifelse);
+      void compile_while_loop(const WhileStmt& while_stmt);
+      void compile_for_loop(const ForStmt& for_stmt);
+
+      // Expression compile functions
+
+      void compile_expr(const Stmt& expr);
+      void compile_call(const CallExpr& call);
+      void compile_arithmetic(Type op, int line, int left);
+      void compile_condition(const Stmt& expr, bool jump_if, Label& target);
+
+      // Emit functions
+
+      void emit(std::initializer_list<std::uint8_t> bytes);
+      void emit32(std::int32_t value);
+      void patch32(size_t position, std::int32_t value);
+      void jump(std::initializer_list<std::uint8_t> opcode, Label& label);
+      void jump_equal(bool equal, Label& target);
+      void bind(Label& label);
+      void load(int slot);
+      void store(int slot);
+      void load_constant(long double number);
+
+      // Utility functions
+
+      int allocate();
+      int find(const std::string& identifier) const;
+      int lookup(const std::string& identifier) const;
+
+   public:
+      Compiler(const FnDeclaration& decl);
+      std::vector<std::uint8_t> compile(const Program& body, const std::vector<StaticType>& parameters);
+   };
+
+   // x86-64 encodings
+
+   constexpr std::initializer_list<std::uint8_t> jmp {0xE9}, ja {0x0F, 0x87}, jbe {0x0F, 0x86}, je {0x0F, 0x84}, jne {0x0F, 0x85}, jp {0x0F, 0x8A};
+
+   Compiler::Compiler(const FnDeclaration& decl)
+      : decl(decl), name(get_stmt<IdentLiteral>(decl.identifier).identifier) {}
+
+   std::vector<std::uint8_t> Compiler::compile(const Program& body, const std::vector<StaticType>& parameters) {
+      if (decl.def_args != 0 || decl.returns->type != StmtType::null || (!decl.return_type.accepts_any() && decl.return_type.type != StaticType::number)) {
+         throw Unsupported {};
+      }
+
+      // push rbp; mov rbp, rsp; push rbx; sub rsp, frame; mov rbx, rsi
+      emit({0x55, 0x48, 0x89, 0xE5, 0x53, 0x48, 0x81, 0xEC});
+      size_t frame = code.size();
+      emit32(0);
+      emit({0x48, 0x89, 0xF3});
+
+      scopes.emplace_back();
+      for (size_t i = 0; i < decl.arguments.size(); ++i) {
+         if (parameters.at(i) != StaticType::number) {
+            throw Unsupported {};
+         }
+
+         // fld tword [rdi + 16 * i]
+         int slot = allocate();
+         emit({0xDB, 0xAF});
+         emit32(16 * i);
+         store(slot);
+         scopes.back()[get_stmt<IdentLiteral>(decl.arguments.at(i)).identifier] = slot;
+      }
+
+      compile_body(body);
+
+      // mov rbx, [rbp - 8]; leave; ret
+      bind(exit);
+      emit({0x48, 0x8B, 0x5D, 0xF8, 0xC9, 0xC3});
+      patch32(frame, 16 * slot_max + 8);
+
+      while (code.size() % 16) {
+         code.push_back(0xCC);
+      }
+
+      for (const auto& [position, index] : constant_fixups) {
+         patch32(position, code.size() + 16 * index - (position + 4));
+      }
+
+      for (auto number : constants) {
+         std::uint8_t bytes[16] {};
+         std::memcpy(bytes, &number, 10);
+         code.insert(code.end(), bytes, bytes + 16);
+      }
+      return code;
+   }
+
+   // Statement compile functions
+
+   // Function result is the value of the returned expression or of the last statement
+   void Compiler::compile_body(const Program& body) {
+      if (body.statements.empty()) {
+         throw Unsupported {};
+      }
+
+      for (size_t i = 0; i < body.statements.size(); ++i) {
+         auto& stmt = body.statements.at(i);
+         bool last = (i + 1 == body.statements.size());
+
+         if (stmt->type == StmtType::return_stmt) {
+            compile_expr(get_stmt<ReturnStmt>(stmt).value);
+            return;
+         } else if (stmt->type == StmtType::unless_stmt && get_stmt<UnlessStmt>(stmt).stmt->type == StmtType::return_stmt && !last) {
+            auto& unless = get_stmt<UnlessStmt>(stmt);
+            Label skip;
+            compile_condition(unless.expr, true, skip);
+            compile_expr(get_stmt<ReturnStmt>(unless.stmt).value);
+            jump(jmp, exit);
+            bind(skip);
+         } else if (last) {
+            compile_expr(stmt);
+         } else {
+            compile_stmt(stmt);
+         }
+      }
+   }
+
+   void Compiler::compile_stmt(const Stmt& stmt) {
+      switch (stmt->type) {
+      case StmtType::var_decl:
+         compile_var_decl(get_stmt<VarDeclaration>(stmt));
+         break;
+      case StmtType::ifelse:
+         compile_if_else(get_stmt<IfElseStmt>(stmt));
+         break;
+      case StmtType::while_loop:
+         compile_while_loop(get_stmt<WhileStmt>(stmt));
+         break;
+      case StmtType::for_loop:
+         compile_for_loop(get_stmt<ForStmt>(stmt));
+         break;
+      case StmtType::break_stmt:
+      case StmtType::continue_stmt:
+         if (loops.empty()) {
+            throw Unsupported {};
+         }
+         jump(jmp, (stmt->type == StmtType::break_stmt ? loops.back().breaks : loops.back().continues));
+         break;
+      case StmtType::unless_stmt: {
+         auto& unless = get_stmt<UnlessStmt>(stmt);
+         if (unless.stmt->type == StmtType::var_decl) {
+            throw Unsupported {};
+         }
+
+         Label skip;
+         compile_condition(unless.expr, true, skip);
+         compile_stmt(unless.stmt);
+         bind(skip);
+         break;
+      }
+      case StmtType::program:
+         compile_block(get_stmt<Program>(stmt));
+         break;
+      case StmtType::try_stmt:
+         // Errors of compiled code are raised once it returned, too late for a handler inside it
+         throw Unsupported {};
+      default:
+         // fstp st(0)
+         compile_expr(stmt);
+         emit({0xDD, 0xD8});
+         break;
+      }
+   }
+
+   void Compiler::compile_block(const Program& program) {
+      scopes.emplace_back();
+      for (const auto& stmt : program.statements) {
+         compile_stmt(stmt);
+      }
+      scopes.pop_back();
+   }
+
+   void Compiler::compile_var_decl(const VarDeclaration& decl) {
+      size_t isize = decl.identifiers.size(), vsize = decl.values.size();
+      bool single_decl = (vsize == 1 && isize != 1);
+      if (decl.constant || (!single_decl && vsize != isize)) {
+         throw Unsupported {};
+      }
+
+      int first = -1;
+      for (size_t i = 0; i < isize; ++i) {
+         int slot = allocate();
+         if (single_decl && i != 0) {
+            load(first);
+         } else {
+            compile_expr(decl.values.at(i));
+         }
+         store(slot);
+
+         first = (i == 0 ? slot : first);
+         scopes.back()[get_stmt<IdentLiteral>(decl.identifiers.at(i)).identifier] = slot;
+      }
+   }
+
+   void Compiler::compile_if_else(const IfElseStmt& ifelse) {
+      Label end;
+      auto clause = [&](const Stmt& stmt) {
+         auto& ifclause = get_stmt<IfClauseStmt>(stmt);
+         Label next;
+         compile_condition(ifclause.expr, false, next);
+         compile_stmt(ifclause.stmt);
+         jump(jmp, end);
+         bind(next);
+      };
+
+      clause(ifelse.ifclause);
+      for (const auto& elif : ifelse.elifclauses) {
+         clause(elif);
+      }
+
+      if (ifelse.elseclause.has_value()) {
+         compile_stmt(get_stmt<IfClauseStmt>(ifelse.elseclause.value()).stmt);
+      }
+      bind(end);
+   }
+
+   void Compiler::compile_while_loop(const WhileStmt& while_stmt) {
+      Label head, end;
+      bind(head);
+      if (!while_stmt.infinite) {
+         compile_condition(while_stmt.expr, false, end);
+      }
+
+      loops.push_back({end, head});
+      compile_stmt(while_stmt.stmt);
+      loops.pop_back();
+
+      jump(jmp, head);
+      bind(end);
+   }
+
+   // The body shares the scope of the loop, so its variables outlive an iteration
+   void Compiler::compile_for_loop(const ForStmt& for_stmt) {
+      scopes.emplace_back();
+      if (for_stmt.initexpr.has_value()) {
+         compile_stmt(for_stmt.initexpr.value());
+      }
+
+      auto& body = get_stmt<Program>(for_stmt.stmt);
+      for (const auto& stmt : body.statements) {
+         if (stmt->type != StmtType::var_decl) {
+            continue;
+         }
+
+         // The first iteration would read the outer variable, later ones the one of the previous iteration
+         for (const auto& identifier : get_stmt<VarDeclaration>(stmt).identifiers) {
+            if (find(get_stmt<IdentLiteral>(identifier).identifier) != -1) {
+               throw Unsupported {};
+            }
+         }
+      }
+
+      Label head, next, end;
+      bind(head);
+      if (for_stmt.condition.has_value()) {
+         compile_condition(for_stmt.condition.value(), false, end);
+      }
+
+      loops.push_back({end, next});
+      for (const auto& stmt : body.statements) {
+         compile_stmt(stmt);
+      }
+      loops.pop_back();
+
+      bind(next);
+      if (for_stmt.loopexpr.has_value()) {
+         compile_stmt(for_stmt.loopexpr.value());
+      }
+      jump(jmp, head);
+      bind(end);
+      scopes.pop_back();
+   }
+
+   // Expression compile functions
+
+   void Compiler::compile_expr(const Stmt& expr) {
+      if (expr->static_type != StaticType::number) {
+         throw Unsupported {};
+      }
+
+      switch (expr->type) {
+      case StmtType::number:
+         load_constant(get_stmt<NumberLiteral>(expr).number);
+         break;
+      case StmtType::identifier:
+         load(lookup(get_stmt<IdentLiteral>(expr).identifier));
+         break;
+      case StmtType::binary: {
+         auto& binary = get_stmt<BinaryExpr>(expr);
+         if (!is_arithmetic(binary.op)) {
+            throw Unsupported {};
+         }
+
+         compile_expr(binary.left);
+         int left = allocate();
+         store(left);
+         compile_expr(binary.right);
+         compile_arithmetic(binary.op, binary.line, left);
+         --slot_top;
+         break;
+      }
+      case StmtType::unary: {
+         auto& unary = get_stmt<UnaryExpr>(expr);
+         bool step = (unary.op == Type::increment || unary.op == Type::decrement);
+         int slot = (step && unary.value->type == StmtType::identifier ? lookup(get_stmt<IdentLiteral>(unary.value).identifier) : -1);
+
+         if (slot != -1) {
+            load(slot);
+         } else {
+            compile_expr(unary.value);
+         }
+
+         // fchs, fld1; faddp, fld1; fsubp
+         if (unary.op == Type::minus) {
+            emit({0xD9, 0xE0});
+         } else if (step) {
+            emit({0xD9, 0xE8, 0xDE, std::uint8_t(unary.op == Type::increment ? 0xC1 : 0xE9)});
+         } else if (unary.op != Type::plus) {
+            throw Unsupported {};
+         }
+
+         if (slot != -1) {
+            store(slot);
+            load(slot);
+         }
+         break;
+      }
+      case StmtType::assignment: {
+         auto& assignment = get_stmt<AssignmentExpr>(expr);
+         if (assignment.left->type != StmtType::identifier) {
+            throw Unsupported {};
+         }
+
+         int slot = lookup(get_stmt<IdentLiteral>(assignment.left).identifier);
+         compile_expr(assignment.right);
+         if (assignment.op != Type::assign) {
+            compile_arithmetic(compound_op(assignment.op), assignment.line, slot);
+         }
+         store(slot);
+         load(slot);
+         break;
+      }
+      case StmtType::ternary: {
+         auto& ternary = get_stmt<TernaryExpr>(expr);
+         Label other, end;
+         compile_condition(ternary.left, false, other);
+         compile_expr(ternary.middle);
+         jump(jmp, end);
+         bind(other);
+         compile_expr(ternary.right);
+         bind(end);
+         break;
+      }
+      case StmtType::call:
+         compile_call(get_stmt<CallExpr>(expr));
+         break;
+      default:
+         throw Unsupported {};
+      }
+   }
+
+   // Only calls of the function itself are compiled, functions are constants so the name always refers to it
+   void Compiler::compile_call(const CallExpr& call) {
+      auto& args = get_stmt<ArgsListExpr>(call.args).args;
+      if (call.identifier->type != StmtType::identifier || get_stmt<IdentLiteral>(call.identifier).identifier != name || find(name) != -1 || args.size() != decl.arguments.size()) {
+         throw Unsupported {};
+      }
+
+      // Arguments are stored at increasing addresses, slots grow downwards
+      int base = slot_top;
+      for (size_t i = 0; i < args.size(); ++i) {
+         allocate();
+      }
+
+      for (size_t i = 0; i < args.size(); ++i) {
+         compile_expr(args.at(i));
+         store(base + args.size() - 1 - i);
+      }
+
+      // lea rdi, [rbp + args]; mov rsi, rbx; call entry
+      emit({0x48, 0x8D, 0xBD});
+      emit32(-16 * (base + int(args.size()) - 1 + 2));
+      emit({0x48, 0x89, 0xDE, 0xE8});
+      emit32(-std::int32_t(code.size() + 4));
+      slot_top = base;
+
+      // cmp dword [rbx], 0; jne exit
+      emit({0x83, 0x3B, 0x00});
+      jump(jne, exit);
+   }
+
+   // Apply operator on the left value in the slot and the right value in st(0)
+   void Compiler::compile_arithmetic(Type op, int line, int left) {
+      if (op == Type::divide || op == Type::remainder) {
+         // fldz; fucomip st(0), st(1)
+         Label valid;
+         emit({0xD9, 0xEE, 0xDF, 0xE9});
+         jump(jp, valid);
+         jump(jne, valid);
+
+         // fstp tword [rbx + 16]; fstp st(0); mov dword [rbx], op; mov dword [rbx + 4], line; fldz
+         load(left);
+         emit({0xDB, 0x7B, 0x10, 0xDD, 0xD8, 0xC7, 0x03});
+         emit32(int(op));
+         emit({0xC7, 0x43, 0x04});
+         emit32(line);
+         emit({0xD9, 0xEE});
+         jump(jmp, exit);
+         bind(valid);
+      }
+      load(left);
+
+      switch (op) {
+      case Type::plus:
+         // faddp
+         emit({0xDE, 0xC1});
+         break;
+      case Type::minus:
+         // fsubrp, st(1) = st(0) - st(1)
+         emit({0xDE, 0xE1});
+         break;
+      case Type::multiply:
+         // fmulp
+         emit({0xDE, 0xC9});
+         break;
+      case Type::divide:
+         // fdivrp, st(1) = st(0) / st(1)
+         emit({0xDE, 0xF1});
+         break;
+      case Type::remainder: {
+         // fprem1 rounds to nearest like std::remainder, it has to be repeated until C2 is clear
+         // fprem1; fnstsw ax; test ah, 4; jne again; fstp st(1)
+         Label again;
+         bind(again);
+         emit({0xD9, 0xF5, 0xDF, 0xE0, 0xF6, 0xC4, 0x04});
+         jump(jne, again);
+         emit({0xDD, 0xD9});
+         break;
+      }
+      default:
+         throw Unsupported {};
+      }
+   }
+
+   // Jump to target if the truthiness of the expression equals jump_if
+   void Compiler::compile_condition(const Stmt& expr, bool jump_if, Label& target) {
+      if (expr->type == StmtType::unary && get_stmt<UnaryExpr>(expr).op == Type::log_not) {
+         compile_condition(get_stmt<UnaryExpr>(expr).value, !jump_if, target);
+         return;
+      }
+
+      if (expr->type != StmtType::binary || get_stmt<BinaryExpr>(expr).op == Type::binary_cond || is_arithmetic(get_stmt<BinaryExpr>(expr).op)) {
+         // fldz; fucomip st(0), st(1); fstp st(0)
+         compile_expr(expr);
+         emit({0xD9, 0xEE, 0xDF, 0xE9, 0xDD, 0xD8});
+         jump_equal(!jump_if, target);
+         return;
+      }
+
+      auto& binary = get_stmt<BinaryExpr>(expr);
+      if (binary.op == Type::log_and || binary.op == Type::log_or) {
+         if (jump_if == (binary.op == Type::log_or)) {
+            compile_condition(binary.left, jump_if, target);
+            compile_condition(binary.right, jump_if, target);
+         } else {
+            Label skip;
+            compile_condition(binary.left, !jump_if, skip);
+            compile_condition(binary.right, jump_if, target);
+            bind(skip);
+         }
+         return;
+      }
+
+      if (binary.left->static_type != StaticType::number || binary.right->static_type != StaticType::number) {
+         throw Unsupported {};
+      }
+
+      compile_expr(binary.left);
+      int left = allocate();
+      store(left);
+      compile_expr(binary.right);
+
+      if (binary.op == Type::divisible) {
+         // fldz; fucomip st(0), st(1); fstp st(0)
+         compile_arithmetic(Type::remainder, binary.line, left);
+         emit({0xD9, 0xEE, 0xDF, 0xE9, 0xDD, 0xD8});
+         jump_equal(jump_if, target);
+         --slot_top;
+         return;
+      }
+      load(left);
+      --slot_top;
+
+      // fucomip st(0), st(1); fstp st(0), left is in st(0) unless exchanged
+      // a >= b is !(b > a) and a <= b is !(a > b), like ValueLiteral::greater()
+      bool swap = (binary.op == Type::smaller || binary.op == Type::greater_equal);
+      if (swap) {
+         emit({0xD9, 0xC9});
+      }
+      emit({0xDF, 0xE9, 0xDD, 0xD8});
+
+      switch (binary.op) {
+      case Type::equals:
+      case Type::really_equals:
+         jump_equal(jump_if, target);
+         break;
+      case Type::not_equals:
+      case Type::really_not_equals:
+         jump_equal(!jump_if, target);
+         break;
+      case Type::greater:
+      case Type::smaller:
+         jump((jump_if ? ja : jbe), target);
+         break;
+      case Type::greater_equal:
+      case Type::smaller_equal:
+         jump((jump_if ? jbe : ja), target);
+         break;
+      default:
+         throw Unsupported {};
+      }
+   }
+
+   // Emit functions
+
+   void Compiler::emit(std::initializer_list<std::uint8_t> bytes) {
+      code.insert(code.end(), bytes);
+   }
+
+   void Compiler::emit32(std::int32_t value) {
+      std::uint8_t bytes[4];
+      std::memcpy(bytes, &value, 4);
+      code.insert(code.end(), bytes, bytes + 4);
+   }
+
+   void Compiler::patch32(size_t position, std::int32_t value) {
+      std::memcpy(code.data() + position, &value, 4);
+   }
+
+   void Compiler::jump(std::initializer_list<std::uint8_t> opcode, Label& label) {
+      emit(opcode);
+      size_t position = code.size();
+      emit32(0);
+
+      if (label.position != std::numeric_limits<size_t>::max()) {
+         patch32(position, std::int32_t(label.position) - std::int32_t(position + 4));
+      } else {
+         label.fixups.push_back(position);
+      }
+   }
+
+   // Unordered comparisons (NaN) set both ZF and PF, they are never equal
+   void Compiler::jump_equal(bool equal, Label& target) {
+      if (equal) {
+         Label skip;
+         jump(jp, skip);
+         jump(je, target);
+         bind(skip);
+      } else {
+         jump(jp, target);
+         jump(jne, target);
+      }
+   }
+
+   void Compiler::bind(Label& label) {
+      label.position = code.size();
+      for (auto position : label.fixups) {
+         patch32(position, std::int32_t(label.position) - std::int32_t(position + 4));
+      }
+      label.fixups.clear();
+   }
+
+   void Compiler::load(int slot) {
+      // fld tword [rbp + slot]
+      emit({0xDB, 0xAD});
+      emit32(-16 * (slot + 2));
+   }
+
+   void Compiler::store(int slot) {
+      // fstp tword [rbp + slot]
+      emit({0xDB, 0xBD});
+      emit32(-16 * (slot + 2));
+   }
+
+   void Compiler::load_constant(long double number) {
+      if (number == 0 && !std::signbit(number)) {
+         // fldz
+         emit({0xD9, 0xEE});
+      } else if (number == 1) {
+         // fld1
+         emit({0xD9, 0xE8});
+      } else {
+         // fld tword [rip + constant]
+         emit({0xDB, 0x2D});
+         constant_fixups.push_back({code.size(), constants.size()});
+         emit32(0);
+         constants.push_back(number);
+      }
+   }
+
+   // Utility functions
+
+   int Compiler::allocate() {
+      slot_max = std::max(slot_max, slot_top + 1);
+      return slot_top++;
+   }
+
+   int Compiler::find(const std::string& identifier) const {
+      for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+         if (auto slot = it->find(identifier); slot != it->end()) {
+            return slot->second;
+         }
+      }
+      return -1;
+   }
+
+   int Compiler::lookup(const std::string& identifier) const {
+      int slot = find(identifier);
+      if (slot == -1) {
+         throw Unsupported {};
+      }
+      return slot;
+   }
+}
+
+// Baseline JIT
+
+namespace jit {
+   Code::Code(const std::vector<std::uint8_t>& code)
+      : memory(nullptr), size(0), entry(nullptr)
+   {
+#ifdef CLL_JIT
+      size_t page = sysconf(_SC_PAGESIZE);
+      size = (code.size() + page - 1) / page * page;
+      memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (memory == MAP_FAILED) {
+         memory = nullptr;
+         return;
+      }
+
+      std::memcpy(memory, code.data(), code.size());
+      if (mprotect(memory, size, PROT_READ | PROT_EXEC) == 0) {
+         entry = reinterpret_cast<Entry>(memory);
+      }
+#endif
+   }
+
+   Code::~Code() {
+#ifdef CLL_JIT
+      if (memory) {
+         munmap(memory, size);
+      }
+#endif
+   }
+
+   bool available() {
+#ifdef CLL_JIT
+      return true;
+#else
+      return false;
+#endif
+   }
+
+   std::shared_ptr<const Code> compile(const FnDeclaration& decl, const Program& body, const std::vector<StaticType>& parameters) {
+      if (!available() || decl.identifier->type != StmtType::identifier) {
+         return nullptr;
+      }
+
+      try {
+         auto compiled = std::make_shared<const Code>(Compiler(decl).compile(body, parameters));
+         return (compiled->entry ? compiled : nullptr);
+      } catch (const Unsupported&) {
+         return nullptr;
+      }
+   }
+}
@@ -2,145 +2,269 @@
 
 // Includes
 
-#include "fmt.hpp"
+#include "scan.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <thread>
+#include <unordered_map>
 
 // Lex functions
 
-Lexer::Lexer(const std::string& code)
+Lexer::Lexer(std::string_view code)
    : code(code) {}
 
-std::vector<Token>& Lexer::lex() {
-   for (char ch = current(); index < code.size(); ch = advance()) {
-      if (isspace(ch)) {
-         line += (ch == '\n');
-         continue;
+Lexer::Lexer(std::string_view code, std::size_t begin, std::size_t end)
+   : code(code), index(begin), begin(begin), end(end), speculative(true) {}
+
+std::vector<Token>& Lexer::lex(unsigned threads) {
+   // Roughly one token per six bytes of source code, so most programs never grow the vector
+   tokens.reserve(code.size() / 6 + 1);
+
+   std::size_t chunk_size = std::max(min_chunk_size, code.size() / std::max(threads, 1u) + 1);
+   if (threads <= 1 || code.size() < 2 * min_chunk_size) {
+      while (index < code.size()) {
+         step();
       }
+      tokens.push_back({Type::eof, "EOF", line});
+      return tokens;
+   }
 
-      if (ch == '/' && peek() == '/') {
-         for (; index < code.size() && ch != '\n'; ch = advance());
-         ++line;
-      } else if (ch == '/' && peek() == '*') {
-         int original_line = line;
-         for (; index < code.size() && (ch != '*' || peek() != '/'); ch = advance()) {
-            line += (ch == '\n');
-         }
-         advance();
-         fmt::raise_if(original_line, index >= code.size(), "Unterminated block comment.");
-      } else if (isdigit(ch)) {
-         std::string number;
-         bool dot = false, last_dash = false, prefix = false, scientific = false;
-         bool bin = false, hex = false, oct = false;
-
-         if (ch == '0' && index + 1 < code.size()) {
+   // Chunks start at the beginning of a line
+   chunks.reserve(threads);
+   for (std::size_t start = 0; start < code.size();) {
+      std::size_t stop = std::min(scan::find(code, start + chunk_size, '\n', '\n') + 1, code.size());
+      chunks.push_back(Lexer(code, start, stop));
+      start = stop;
+   }
+
+   std::vector<std::thread> workers;
+   for (auto& chunk : chunks) {
+      workers.emplace_back(&Lexer::lex_chunk, &chunk);
+   }
+   for (auto& worker : workers) {
+      worker.join();
+   }
+
+   for (auto& chunk : chunks) {
+      stitch(chunk);
+   }
+   tokens.push_back({Type::eof, "EOF", line});
+   return tokens;
+}
+
+// Streaming functions
+
+Token Lexer::next() {
+   while (tokens.empty() && index < code.size()) {
+      step();
+   }
+
+   if (tokens.empty()) {
+      return {Type::eof, "EOF", line};
+   }
+   auto token = tokens.back();
+   tokens.pop_back();
+   return token;
+}
+
+// Frees the decoded strings of all streamed tokens except 'kept', which are the most recently streamed ones
+void Lexer::release(const std::vector<Token>& kept) {
+   auto decoded = std::count_if(kept.begin(), kept.end(), [&](const Token& token) {
+      return token.type == Type::string && (token.lexeme.data() < code.data() || token.lexeme.data() > code.data() + code.size());
+   });
+
+   while (strings.size() > std::size_t(decoded)) {
+      strings.pop_front();
+   }
+}
+
+std::size_t Lexer::position() const {
+   return index;
+}
+
+// Lexes a single token, or skips whitespace or a comment
+void Lexer::step() {
+   char ch = current();
+   if (isspace(ch)) {
+      index = scan::whitespace(code, index, line);
+      return;
+   }
+
+   if (ch == '/' && peek() == '/') {
+      index = scan::find(code, index, '\n', '\n');
+      ++line;
+   } else if (ch == '/' && peek() == '*') {
+      // Searching from the '*' keeps "/*/" a closed comment
+      int original_line = line;
+      index = scan::block_comment(code, index + 1, line);
+      advance();
+      raise_if(original_line, index >= code.size(), "Unterminated block comment.");
+   } else if (isdigit(ch)) {
+      int start = index;
+      std::string number;
+      bool dot = false, last_dash = false, prefix = false, scientific = false;
+      bool bin = false, hex = false, oct = false;
+
+      if (ch == '0' && index + 1 < code.size()) {
+         ch = advance();
+         bin = (ch == 'b' || ch == 'B');
+         hex = (ch == 'x' || ch == 'X');
+         oct = (ch == 'o' || ch == 'O');
+         prefix = bin || hex || oct;
+
+         if (prefix) {
             ch = advance();
-            bin = (ch == 'b' || ch == 'B');
-            hex = (ch == 'x' || ch == 'X');
-            oct = (ch == 'o' || ch == 'O');
-            prefix = bin || hex || oct;
-
-            if (prefix) {
-               ch = advance();
-            }
          }
+      }
 
-         for (; index < code.size(); ch = advance()) {
-            if (isdigit(ch) || (hex && ((tolower(ch) <= 'f' && tolower(ch) >= 'a')))) {
-               last_dash = false;
-               number += ch;
-            } else if (ch == '.') {
-               if (!dot) {
-                  dot = true;
-                  number += '.';
-               } else break;
-            } else if (ch == 'e' || ch == 'E') {
-               fmt::raise_if(line, scientific, "Expected scientific number '{}' to only contain one 'e'.", number);
-               fmt::raise_if(line, prefix, "Expected prefixed number '{}' to not be scientific.", number);
-               scientific = true;
-               number += ch;
-            } else if (scientific && (ch == '-' || ch == '+') && (code.at(index - 1) == 'e' || code.at(index - 1) == 'E')) {
-               number += ch;
-            } else if (ch != '_') break;
-
-            if (ch == '_' || ((ch == '-' || ch == '+') && (code.at(index - 1) != 'e' && code.at(index - 1) != 'E')) || ch == '.' || ch == 'e') {
-               fmt::raise_if(line, last_dash, "Expected number '{}' to not have two or more consecutive '_', 'e' or '.'.", number);
-               last_dash = true;
-            }
+      for (; index < code.size(); ch = advance()) {
+         if (isdigit(ch) || (hex && ((tolower(ch) <= 'f' && tolower(ch) >= 'a')))) {
+            last_dash = false;
+            number += ch;
+         } else if (ch == '.') {
+            if (!dot) {
+               dot = true;
+               number += '.';
+            } else break;
+         } else if (ch == 'e' || ch == 'E') {
+            raise_if(line, scientific, "Expected scientific number '{}' to only contain one 'e'.", number);
+            raise_if(line, prefix, "Expected prefixed number '{}' to not be scientific.", number);
+            scientific = true;
+            number += ch;
+         } else if (scientific && (ch == '-' || ch == '+') && (code.at(index - 1) == 'e' || code.at(index - 1) == 'E')) {
+            number += ch;
+         } else if (ch != '_') break;
+
+         if (ch == '_' || ((ch == '-' || ch == '+') && (code.at(index - 1) != 'e' && code.at(index - 1) != 'E')) || ch == '.' || ch == 'e') {
+            raise_if(line, last_dash, "Expected number '{}' to not have two or more consecutive '_', 'e' or '.'.", number);
+            last_dash = true;
          }
-         fmt::raise_if(line, last_dash, "Expected number '{}' to not end with '_', 'e' or '.'.", number);
-         fmt::raise_if(line, number.empty() && prefix, "Expected number to not only contain the prefix.");
+      }
+      raise_if(line, last_dash, "Expected number '{}' to not end with '_', 'e' or '.'.", number);
+      raise_if(line, number.empty() && prefix, "Expected number to not only contain the prefix.");
 
+      // Digits without separators fit the small string buffer, so decoding does not allocate
+      Token token {Type::number, code.substr(start, index - start), line};
+      if (prefix) {
          try {
-            if (scientific) {
-               number = std::to_string(std::stod(number));
-            } else if (prefix) {
-               number = std::to_string(std::stoi(number, nullptr, (bin ? 2 : (oct ? 8 : 16))));
-            }
+            token.number = std::stoi(number, nullptr, (bin ? 2 : (oct ? 8 : 16)));
          } catch (...) {
-            fmt::raise(line, "Prefixed number '{}' out of range.", number);
+            raise_if(line, true, "Prefixed number '{}' out of range.", number);
          }
+      } else if (!number.empty()) {
+         errno = 0;
+         token.number = std::strtold(number.c_str(), nullptr);
+         raise_if(line, errno == ERANGE, "Failed to convert string '{}' to number. Number might be too large, too small, or invalid.", number);
+      }
 
-         tokens.push_back({Type::number, (number.empty() ? "0" : number), line});
-         --index;
-      } else if (isalpha(ch) || ch == '_') {
-         std::string string;
-
-         for (; index < code.size(); ch = advance()) {
-            if (!isalnum(ch) && ch != '_') {
-               break;
-            }
-            line += (ch == '\n');
-            string += ch;
-         }
+      tokens.push_back(token);
+      --index;
+   } else if (isalpha(ch) || ch == '_') {
+      int start = index;
+      index = scan::identifier(code, index);
+      auto string = code.substr(start, index - start);
 
-         if (auto it = keyword_operators.find(string); it != keyword_operators.end()) {
-            tokens.push_back({it->second, string, line});
-         } else if (keywords.find(string) != keywords.end()) {
-            tokens.push_back({Type::keyword, string, line});
-         } else {
-            tokens.push_back({Type::identifier, string, line});
-         }
-         --index;
-      } else if (ch == '\'') {
-         char character = advance();
+      tokens.push_back({keywords.find(string, Type::identifier), string, line});
+      --index;
+   } else if (ch == '\'') {
+      int start = index;
+      char character = advance();
 
-         if (character == '\\') {
-            character = get_escape_code(advance());
+      if (character == '\\') {
+         character = get_escape_code(advance());
+      }
+      ch = advance();
+      raise_if(line, ch != '\'', "Expected character to be one character long/unterminated character.");
+
+      Token token {Type::character, code.substr(start, index - start + 1), line};
+      token.ch = character;
+      tokens.push_back(token);
+   } else if (ch == '"') {
+      int start = index + 1, original_line = line;
+      bool escaped = false;
+
+      // Jumps between quotes and backslashes, the character after a backslash is skipped
+      std::size_t quote = scan::find(code, start, '"', '\\');
+      for (; quote < code.size() && code[quote] == '\\'; quote = scan::find(code, quote + 2, '"', '\\')) {
+         escaped = true;
+      }
+      raise_if(original_line, quote >= code.size(), "Unterminated string.");
+      index = quote;
+      auto string = code.substr(start, index - start);
+
+      // Only strings with escape codes need their own storage
+      if (escaped) {
+         auto& decoded = strings.emplace_back();
+         for (size_t i = 0; i < string.size(); ++i) {
+            decoded += (string.at(i) == '\\' ? get_escape_code(string.at(++i)) : string.at(i));
          }
-         ch = advance();
-         fmt::raise_if(line, ch != '\'', "Expected character to be one character long/unterminated character.");
-         tokens.push_back({Type::character, std::string(1, character), line});
-      } else if (ch == '"') {
-         std::string string;
-         int original_line = line;
-
-         for (ch = advance(); index < code.size() && ch != '"'; ch = advance()) {
-            if (ch == '\\') {
-               ch = get_escape_code(advance());
-            }
-            string += ch;
+         string = decoded;
+      }
+      tokens.push_back({Type::string, string, line});
+   } else {
+      auto op = code.substr(index, max_op_size);
+      for (; !op.empty(); op.remove_suffix(1)) {
+         if (auto type = operators.find(op, Type::eof); type != Type::eof) {
+            tokens.push_back({type, op, line});
+            break;
+         }
+      }
+      raise_if(line, op.empty(), "Unexpected character: '{}'.", ch);
+      index += op.size() - 1;
+   }
+   advance();
+}
+
+// Lexes a chunk up to the first token starting after its end. Lexing stops at the first error, which might be
+// caused by starting inside a string or comment, leaving the position and line where the failing token started.
+void Lexer::lex_chunk() {
+   std::size_t start = index;
+   int start_line = line;
+   tokens.reserve((end - begin) / 6 + 1);
+
+   try {
+      while (index < end) {
+         start = index;
+         start_line = line;
+
+         auto count = tokens.size();
+         step();
+         if (tokens.size() != count) {
+            starts.push_back(start);
          }
-         fmt::raise_if(original_line, ch != '"', "Unterminated string.");
-         tokens.push_back({Type::string, string, line});
-      } else {
-         std::string op;
-         for (int i = 0; i < max_op_size && index + i < code.size(); ++i) {
-            op += code.at(index + i);
+      }
+   } catch (const Speculation&) {
+      failed = true;
+      index = start;
+      line = start_line;
+   }
+}
+
+// Lexes from the end of the previous chunk until it meets a token of this chunk, then takes the remaining tokens
+void Lexer::stitch(Lexer& chunk) {
+   std::size_t next = 0;
+   while (index < chunk.end) {
+      for (; next < chunk.starts.size() && chunk.starts[next] < index; ++next);
+
+      bool at_begin = (index == chunk.begin);
+      if (at_begin || (next < chunk.starts.size() && chunk.starts[next] == index)) {
+         int delta = line - (at_begin ? 1 : chunk.tokens[next].line);
+         for (auto token = chunk.tokens.begin() + next; token != chunk.tokens.end(); ++token) {
+            tokens.push_back(*token);
+            tokens.back().line += delta;
          }
-         auto original_size = op.size();
-
-         for (int i = 0; i < original_size; ++i) {
-            if (auto t = operators.find(op); t != operators.end()) {
-               tokens.push_back({t->second, op, line});
-               break;
-            }
-            op.pop_back();
+
+         index = chunk.index;
+         line = chunk.line + delta;
+         if (chunk.failed) {
+            step();
          }
-         fmt::raise_if(line, op.empty(), "Unexpected character: '{}'.", ch);  
-         index += op.size() - 1;
+         next = chunk.starts.size();
+         continue;
       }
+      step();
    }
-   tokens.push_back({Type::eof, "EOF", line});
-   return tokens;
 }
 
 // Helper functions
@@ -159,10 +283,10 @@ char Lexer::advance() {
 }
 
 char Lexer::get_escape_code(char escape) {
-   static std::unordered_map<char, char> code_map {
+   static const std::unordered_map<char, char> code_map {
       {'a', '\a'}, {'b', '\b'}, {'t', '\t'}, {'n', '\n'}, {'v', '\v'}, {'f', '\f'},
       {'r', '\r'}, {'e', '\e'}, {'\\', '\\'}, {'\'', '\''}, {'"', '"'}
    };
-   fmt::raise_if(line, code_map.find(escape) == code_map.end(), "Unknown escape code '\\{}'.", escape);
-   return code_map[escape];
+   raise_if(line, code_map.find(escape) == code_map.end(), "Unknown escape code '\\{}'.", escape);
+   return code_map.at(escape);
 }
@@ -1,32 +1,321 @@
 // Includes
 
+#include "batch.hpp"
+#include "cache.hpp"
+#include "checker.hpp"
 #include "file.hpp"
 #include "fmt.hpp"
+#include "functions.hpp"
+#include "inference.hpp"
 #include "interpreter.hpp"
 #include "lexer.hpp"
+#include "module.hpp"
 #include "parser.hpp"
-#include "properties.hpp"
+#include "profile.hpp"
+#include "records.hpp"
+#include "server.hpp"
+#include "snapshot.hpp"
+#include "transpiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <thread>
 
-// Main program entry point
+// Command line options
 
-int main(int argc, char* argv[]) {
-   fmt::raise_if(err::nline, argc != 2, "Expected 2 arguments, got {} instead.", argc);
-   std::string code = argv[1];
+struct Options {
+   std::string code, profile_in, profile_out, cache_dir, socket, restore;
+   std::vector<std::string> scripts;
+   bool dump_types = false, emit_cpp = false, jit = false, stream = false, lazy = false;
+   bool no_cache = false, cache_stats = false, serve = false, map = false;
+   char delimiter = '\n';
+   unsigned workers = 0, jobs = 0;
+   Interpreter::Budget budget;
+};
+
+// Profile is saved on exit, so that runs ending with an error or exit() are recorded as well
+
+static Profile profile;
+static std::string profile_out;
+
+static void save_profile() {
+   if (!profile_out.empty()) {
+      profile.save(profile_out);
+   }
+}
+
+// Positive number following the option at argv[i], which is moved past it
+static std::uint64_t parse_number(int argc, char* argv[], int& i, const char* unit, std::uint64_t max) {
+   fmt::raise_if(err::nline, i + 1 >= argc, "Expected a number of {} after '{}'.", unit, argv[i]);
+   char* end = nullptr;
+   std::string number = argv[++i];
+   auto value = std::strtoull(number.c_str(), &end, 10);
+   fmt::raise_if(err::nline, number.empty() || *end || number.front() == '-' || value == 0 || value > max, "Expected a number of {} between 1 and {}, got '{}' instead.", unit, max, number);
+   return value;
+}
 
-   if (file::exists(code)) {
-      code = file::read(code);
+static Options parse_options(int argc, char* argv[]) {
+   Options options;
+
+   for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "--dump-types") {
+         options.dump_types = true;
+      } else if (arg == "--emit-cpp") {
+         options.emit_cpp = true;
+      } else if (arg == "--jit") {
+         options.jit = true;
+      } else if (arg == "--stream") {
+         options.stream = true;
+      } else if (arg == "--lazy") {
+         options.lazy = true;
+      } else if (arg == "--no-cache") {
+         options.no_cache = true;
+      } else if (arg == "--cache-stats") {
+         options.cache_stats = true;
+      } else if (arg == "--cache-dir") {
+         fmt::raise_if(err::nline, i + 1 >= argc, "Expected a directory after '{}'.", arg);
+         options.cache_dir = argv[++i];
+      } else if (arg == "--serve") {
+         options.serve = true;
+      } else if (arg == "--socket") {
+         fmt::raise_if(err::nline, i + 1 >= argc, "Expected a socket path after '{}'.", arg);
+         options.socket = argv[++i];
+      } else if (arg == "--map") {
+         options.map = true;
+      } else if (arg == "--delimiter") {
+         fmt::raise_if(err::nline, i + 1 >= argc, "Expected a character after '{}'.", arg);
+         std::string delimiter = argv[++i];
+         delimiter = (delimiter == "\\n" ? "\n" : (delimiter == "\\t" ? "\t" : (delimiter == "\\0" ? std::string(1, '\0') : delimiter)));
+         fmt::raise_if(err::nline, delimiter.size() != 1, "Expected a single character or '\\n', '\\t' or '\\0' after '{}', got '{}' instead.", arg, argv[i]);
+         options.delimiter = delimiter.front();
+      } else if (arg == "--workers") {
+         options.workers = unsigned(parse_number(argc, argv, i, "workers", 1024));
+      } else if (arg == "--jobs") {
+         options.jobs = unsigned(parse_number(argc, argv, i, "jobs", 1024));
+      } else if (arg == "--max-steps") {
+         options.budget.steps = parse_number(argc, argv, i, "steps", UINT64_MAX);
+      } else if (arg == "--max-memory") {
+         options.budget.memory = parse_number(argc, argv, i, "megabytes", UINT64_MAX >> 20) << 20;
+      } else if (arg == "--max-time") {
+         options.budget.milliseconds = parse_number(argc, argv, i, "milliseconds", UINT64_MAX);
+      } else if (arg == "--restore") {
+         fmt::raise_if(err::nline, i + 1 >= argc, "Expected a snapshot path after '{}'.", arg);
+         options.restore = argv[++i];
+      } else if (arg == "--profile-in" || arg == "--profile-out") {
+         fmt::raise_if(err::nline, i + 1 >= argc, "Expected a file path after '{}'.", arg);
+         (arg == "--profile-in" ? options.profile_in : options.profile_out) = argv[++i];
+      } else {
+         options.scripts.push_back(arg);
+      }
+   }
+
+   // A snapshot names the script it was taken from, which is only given when it moved
+   if (options.scripts.empty() && !options.restore.empty()) {
+      options.scripts.push_back(snap::point(options.restore).script);
+   }
+   fmt::raise_if(err::nline, options.scripts.empty(), "Expected code or a file path as an argument.");
+   // With '--jobs', every code argument is a script to run
+   fmt::raise_if(err::nline, options.scripts.size() > 1 && !options.jobs, "Expected a single code argument, got '{}' as well.", options.scripts[1]);
+   options.code = options.scripts.front();
+   fmt::raise_if(err::nline, options.stream && (options.dump_types || options.emit_cpp), "Option '--stream' cannot be combined with '{}'.", (options.dump_types ? "--dump-types" : "--emit-cpp"));
+
+   // Lazily parsed bodies view the tokens, which streamed programs free, and are missing from the analysis and C++ output
+   fmt::raise_if(err::nline, options.lazy && (options.stream || options.dump_types || options.emit_cpp), "Option '--lazy' cannot be combined with '{}'.", (options.stream ? "--stream" : (options.dump_types ? "--dump-types" : "--emit-cpp")));
+
+   // A server answers requests instead of running main(), and its workers exit without saving a profile
+   fmt::raise_if(err::nline, options.serve != !options.socket.empty(), "Options '--serve' and '--socket' must be given together.");
+   fmt::raise_if(err::nline, options.workers && !options.serve && !options.map, "Option '--workers' requires '--serve' or '--map'.");
+   fmt::raise_if(err::nline, options.serve && (options.dump_types || options.emit_cpp || !options.profile_out.empty()), "Option '--serve' cannot be combined with '{}'.", (options.dump_types ? "--dump-types" : (options.emit_cpp ? "--emit-cpp" : "--profile-out")));
+
+   // Every worker of a record mode script parses and runs it by itself
+   fmt::raise_if(err::nline, options.map && (options.serve || options.jobs || options.stream || options.lazy || options.dump_types || options.emit_cpp || !options.profile_in.empty() || !options.profile_out.empty()), "Option '--map' cannot be combined with options other than '--jit', '--workers' and '--delimiter'.");
+   fmt::raise_if(err::nline, options.delimiter != '\n' && !options.map, "Option '--delimiter' requires '--map'.");
+
+   // Scripts run at once would overwrite each other's profile
+   fmt::raise_if(err::nline, options.jobs && (options.serve || !options.profile_out.empty()), "Option '--jobs' cannot be combined with '{}'.", (options.serve ? "--serve" : "--profile-out"));
+
+   // Restored programs skip the top-level statements before the snapshot, which streamed programs never hold at once
+   fmt::raise_if(err::nline, !options.restore.empty() && (options.stream || options.jobs || options.map || options.dump_types || options.emit_cpp), "Option '--restore' cannot be combined with '{}'.", (options.stream ? "--stream" : (options.jobs ? "--jobs" : (options.map ? "--map" : (options.dump_types ? "--dump-types" : "--emit-cpp")))));
+   return options;
+}
+
+// Cache statistics
+
+static std::uint64_t elapsed(std::chrono::steady_clock::time_point start) {
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double milliseconds(std::uint64_t nanoseconds) {
+   return std::round(nanoseconds / 1e4) / 100;
+}
+
+// Snapshots
+
+// A top-level call of checkpoint() is done once restored, any other statement taking one is evaluated again
+static bool is_checkpoint(const Stmt& stmt) {
+   if (stmt->type != StmtType::call) {
+      return false;
+   }
+   const auto& identifier = get_stmt<CallExpr>(stmt).identifier;
+   return identifier->type == StmtType::identifier && get_stmt<IdentLiteral>(identifier).identifier == "checkpoint";
+}
+
+// Runs the program, errors not caught by it and exit() unwind to main()
+
+static int run(const Options& options) {
+   std::string_view code = options.code;
+
+   // Tokens and error messages view the mapped file, so it stays mapped until the program ends
+   // Imports are resolved against the directory of the script, or the working directory for inline code
+   file::Mapping source;
+   std::string directory;
+   if (file::exists(options.code)) {
+      source = file::Mapping(options.code);
+      code = source.view();
+      directory = std::filesystem::absolute(options.code).parent_path().string();
+   } else {
+      directory = std::filesystem::current_path().string();
    }
    err::set_program_code(code);
+   if (options.map) {
+      return rec::map(code, directory, (options.workers ? options.workers : std::max(std::thread::hardware_concurrency(), 1u)), options.delimiter, options.jit, options.budget);
+   }
+
+   mod::Registry modules (directory);
    Lexer lexer (code);
-   auto& tokens = lexer.lex();
 
-   Parser parser (tokens);
-   auto& program = parser.parse();
+   // Parsed files are cached, except when only parts of them are parsed at a time. Hashing reads the whole source,
+   // so it is skipped when neither the cache nor a profile is used.
+   bool use_cache = !source.view().empty() && !options.no_cache && !options.stream && !options.lazy;
+   auto cache_dir = (options.cache_dir.empty() ? cache::default_directory() : options.cache_dir);
+   std::uint64_t hash = 0;
+   if (use_cache || !options.profile_in.empty() || !options.profile_out.empty() || !options.restore.empty()) {
+      hash = file::hash(code);
+   }
+
+   // Streamed programs are lexed, parsed and evaluated one top-level statement at a time
+   std::optional<Parser> parser;
+   Program cached;
+   Program* program = nullptr;
+   std::uint64_t parse_time = 0;
+   auto start = std::chrono::steady_clock::now();
+
+   if (options.stream) {
+      parser.emplace(lexer);
+   } else if (use_cache && cache::load(cache_dir, code, hash, cached, parse_time)) {
+      program = &cached;
+      auto load_time = elapsed(start);
+      if (options.cache_stats) {
+         std::cerr << fmt::format("Cache hit: loaded in {} ms instead of parsing in {} ms, saved {} ms.", milliseconds(load_time), milliseconds(parse_time), milliseconds(parse_time > load_time ? parse_time - load_time : 0)) << '\n';
+      }
+   } else {
+      parser.emplace(lexer.lex(std::thread::hardware_concurrency()), options.lazy);
+      program = &parser->parse();
+      parse_time = elapsed(start);
+
+      if (use_cache) {
+         cache::store(cache_dir, code, hash, *program, parse_time);
+      }
+      if (use_cache && options.cache_stats) {
+         std::cerr << fmt::format("Cache miss: parsed in {} ms.", milliseconds(parse_time)) << '\n';
+      }
+   }
+
+   // Profiles accumulate, so the existing output profile is loaded as well
+   if (!options.profile_in.empty() || !options.profile_out.empty()) {
+      profile = Profile(hash);
+   }
+
+   if (!options.profile_in.empty()) {
+      profile.load(options.profile_in);
+   }
+
+   if (!options.profile_out.empty() && options.profile_out != options.profile_in) {
+      profile.load(options.profile_out);
+   }
+
+   Checker checker;
+   TypeInference inference (options.profile_in.empty() ? nullptr : &profile);
+   if (options.stream) {
+      inference.begin();
+   } else {
+      checker.check(*program);
+      modules.load(*program, code);
+      inference.analyze(*program);
+   }
+
+   if (options.dump_types) {
+      inference.dump();
+      return 0;
+   } else if (options.emit_cpp) {
+      Transpiler transpiler (code);
+      std::cout << transpiler.transpile(*program);
+      return 0;
+   }
+
+   profile_out = options.profile_out;
+   std::atexit(save_profile);
 
-   prop::init();
    Environment global;
-   Interpreter interpreter;
-   interpreter.evaluate(program, global);
+   // Compiled functions are not profiled, so training runs stay interpreted
+   Interpreter interpreter (modules, profile_out.empty() ? nullptr : &profile, options.jit && profile_out.empty());
+   interpreter.set_budget(options.budget);
+
+   // Snapshots hold the index of the top-level statement to resume at, which counts the statements of streamed
+   // programs as well
+   std::uint64_t statement = 0, resume = 0;
+   if (!options.restore.empty()) {
+      auto point = snap::point(options.restore);
+      fmt::raise_if(err::nline, point.hash != hash, "Snapshot '{}' was taken from another version of '{}'.", options.restore, options.code);
+      // Modules are imported the way an import statement in the script would, declared in a scope of their own
+      snap::restore(options.restore, global, code, [&](const std::string& identifier, const std::string& path) {
+         auto import = ImportStmt::make(path, IdentLiteral::make(identifier, err::nline), err::nline);
+         modules.load(import);
+         Environment scope (&global);
+         interpreter.evaluate(std::move(import), scope);
+         return scope.get_variable(identifier, err::nline);
+      });
+      statement = point.statement;
+   }
+   if (!source.view().empty()) {
+      auto script = std::filesystem::absolute(options.code).string();
+      fun::checkpoint_handler = [&, script](const std::string& file, int line) {
+         hash = (hash ? hash : file::hash(code));
+         snap::save(file, {script, hash, resume}, global, line);
+      };
+   }
+
+   interpreter.begin();
+   if (options.stream) {
+      for (; auto stmt = parser->next(); ++statement) {
+         source.release(lexer.position());
+         checker.check(stmt);
+         modules.load(stmt);
+         inference.analyze(stmt);
+         resume = statement + is_checkpoint(stmt);
+         if (!interpreter.evaluate(std::move(stmt), global)) {
+            break;
+         }
+      }
+   } else {
+      for (; statement < program->statements.size(); ++statement) {
+         auto& stmt = program->statements[statement];
+         resume = statement + is_checkpoint(stmt);
+         if (!interpreter.evaluate(std::move(stmt), global)) {
+            break;
+         }
+      }
+   }
+   resume = statement;
+
+   if (options.serve) {
+      return srv::serve(options.socket, (options.workers ? options.workers : std::max(std::thread::hardware_concurrency(), 1u)), interpreter, global);
+   }
 
    // Evaluate main function if it exists
    if (global.variable_exists("main"s)) {
@@ -38,3 +327,23 @@ int main(int argc, char* argv[]) {
    }
    return 0;
 }
+
+// Main program entry point
+
+int main(int argc, char* argv[]) {
+   try {
+      auto options = parse_options(argc, argv);
+      if (options.jobs) {
+         return batch::run(options.scripts, options.jobs, [&options](const std::string& script) {
+            auto job = options;
+            job.code = script;
+            return run(job);
+         });
+      }
+      return run(options);
+   } catch (const err::Error& error) {
+      err::report(error);
+   } catch (const err::Exit& exit) {
+      err::report(exit);
+   }
+}
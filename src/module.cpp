@@ -0,0 +1,251 @@
+#include "module.hpp"
+
+// Includes
+
+#include "checker.hpp"
+#include "fmt.hpp"
+#include "inference.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// Utility functions
+
+// Collects the import statements anywhere in a statement, including function bodies
+static void find_imports(Stmt& stmt, std::vector<ImportStmt*>& imports) {
+   auto visit = [&](Stmt& child) {
+      find_imports(child, imports);
+   };
+   auto visit_all = [&](std::vector<Stmt>& stmts) {
+      for (auto& child : stmts) {
+         find_imports(child, imports);
+      }
+   };
+
+   switch (stmt->type) {
+   case StmtType::import_stmt:
+      imports.push_back(&get_stmt<ImportStmt>(stmt));
+      break;
+   case StmtType::var_decl:
+      visit_all(get_stmt<VarDeclaration>(stmt).values);
+      break;
+   case StmtType::fn_decl:
+      visit_all(get_stmt<FnDeclaration>(stmt).argument_def);
+      visit(get_stmt<FnDeclaration>(stmt).return_def);
+      visit(get_stmt<FnDeclaration>(stmt).body);
+      break;
+   case StmtType::ifelse: {
+      auto& ifelse = get_stmt<IfElseStmt>(stmt);
+      visit(ifelse.ifclause);
+      visit_all(ifelse.elifclauses);
+      if (ifelse.elseclause.has_value()) {
+         visit(ifelse.elseclause.value());
+      }
+      break;
+   }
+   case StmtType::if_clause:
+      visit(get_stmt<IfClauseStmt>(stmt).expr);
+      visit(get_stmt<IfClauseStmt>(stmt).stmt);
+      break;
+   case StmtType::while_loop:
+      visit(get_stmt<WhileStmt>(stmt).expr);
+      visit(get_stmt<WhileStmt>(stmt).stmt);
+      break;
+   case StmtType::for_loop: {
+      auto& loop = get_stmt<ForStmt>(stmt);
+      for (auto* expr : {&loop.initexpr, &loop.condition, &loop.loopexpr}) {
+         if (expr->has_value()) {
+            visit(expr->value());
+         }
+      }
+      visit(loop.stmt);
+      break;
+   }
+   case StmtType::return_stmt:
+      visit(get_stmt<ReturnStmt>(stmt).value);
+      break;
+   case StmtType::unless_stmt:
+      visit(get_stmt<UnlessStmt>(stmt).expr);
+      visit(get_stmt<UnlessStmt>(stmt).stmt);
+      break;
+   case StmtType::try_stmt:
+      visit(get_stmt<TryStmt>(stmt).body);
+      visit(get_stmt<TryStmt>(stmt).handler);
+      break;
+   case StmtType::assignment:
+      visit(get_stmt<AssignmentExpr>(stmt).right);
+      break;
+   case StmtType::ternary:
+      visit(get_stmt<TernaryExpr>(stmt).left);
+      visit(get_stmt<TernaryExpr>(stmt).middle);
+      visit(get_stmt<TernaryExpr>(stmt).right);
+      break;
+   case StmtType::binary:
+      visit(get_stmt<BinaryExpr>(stmt).left);
+      visit(get_stmt<BinaryExpr>(stmt).right);
+      break;
+   case StmtType::unary:
+      visit(get_stmt<UnaryExpr>(stmt).value);
+      break;
+   case StmtType::member:
+      visit(get_stmt<MemberAccess>(stmt).left);
+      visit(get_stmt<MemberAccess>(stmt).key);
+      break;
+   case StmtType::property:
+      visit(get_stmt<PropertyAccess>(stmt).left);
+      visit_all(get_stmt<PropertyAccess>(stmt).right);
+      break;
+   case StmtType::call:
+      visit(get_stmt<CallExpr>(stmt).args);
+      visit(get_stmt<CallExpr>(stmt).identifier);
+      break;
+   case StmtType::args:
+      visit_all(get_stmt<ArgsListExpr>(stmt).args);
+      break;
+   case StmtType::array:
+      visit_all(get_stmt<ArrayLiteral>(stmt).array);
+      break;
+   case StmtType::program:
+      visit_all(get_stmt<Program>(stmt).statements);
+      break;
+   default:
+      break;
+   }
+}
+
+// Lexes, parses and checks a module on a thread of the pool, its errors show its code
+static void parse(mod::Module& module) {
+   module.source = file::Mapping(module.path);
+   err::set_program_code(module.source.view(), module.path);
+
+   module.lexer = std::make_unique<Lexer>(module.source.view());
+   module.parser = std::make_unique<Parser>(module.lexer->lex());
+   module.program = &module.parser->parse();
+   Checker().check(*module.program);
+   TypeInference().analyze(*module.program);
+}
+
+// Module functions
+
+namespace mod {
+   Registry::Registry(const std::string& directory)
+      : directory(directory) {}
+
+   void Registry::set_directory(const std::string& directory) {
+      this->directory = directory;
+   }
+
+   // Resolves imports against the directory of the importing file, the modules not loaded yet are added to 'pending'
+   void Registry::resolve(const std::vector<ImportStmt*>& imports, const std::filesystem::path& directory, std::vector<Module*>& pending) {
+      for (auto* import : imports) {
+         auto path = directory / import->file;
+         fmt::raise_if(import->line, !file::exists(path.string()), "Cannot import '{}' as the file does not exist.", import->file);
+         import->path = std::filesystem::weakly_canonical(path).string();
+
+         auto& module = modules[import->path];
+         if (!module) {
+            module = std::make_unique<Module>();
+            module->path = import->path;
+            pending.push_back(module.get());
+         }
+      }
+   }
+
+   // Loads imports of the main program and every module imported by them in turn
+   void Registry::load(const std::vector<ImportStmt*>& imports) {
+      std::vector<Module*> pending, added;
+      auto source = err::program_code();
+
+      try {
+         resolve(imports, directory, pending);
+         while (!pending.empty()) {
+            added.insert(added.end(), pending.begin(), pending.end());
+
+            // Workers stop at the first error, which is raised again once they all finished
+            std::atomic<std::size_t> next = 0;
+            std::exception_ptr error;
+            std::mutex mutex;
+            auto work = [&]() {
+               try {
+                  for (std::size_t i = next++; i < pending.size(); i = next++) {
+                     parse(*pending.at(i));
+                  }
+               } catch (...) {
+                  std::lock_guard<std::mutex> lock (mutex);
+                  error = (error ? error : std::current_exception());
+                  next = pending.size();
+               }
+            };
+
+            std::vector<std::thread> workers;
+            auto threads = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), pending.size());
+            for (std::size_t i = 0; i < threads; ++i) {
+               workers.emplace_back(work);
+            }
+            for (auto& worker : workers) {
+               worker.join();
+            }
+            if (error) {
+               std::rethrow_exception(error);
+            }
+
+            // Modules without the keyword in their code import nothing
+            auto parsed = std::move(pending);
+            pending.clear();
+            for (auto* module : parsed) {
+               if (module->source.view().find("import") == std::string_view::npos) {
+                  continue;
+               }
+
+               std::vector<ImportStmt*> imports;
+               for (auto& stmt : module->program->statements) {
+                  find_imports(stmt, imports);
+               }
+               err::set_program_code(module->source.view(), module->path);
+               resolve(imports, std::filesystem::path(module->path).parent_path(), pending);
+            }
+            err::set_program_code(source.code, source.file);
+         }
+      } catch (...) {
+         // Modules loaded along with a failing one are dropped, so that programs importing them later load them again
+         std::vector<std::string> paths;
+         for (auto* module : added) {
+            paths.push_back(module->path);
+         }
+         for (auto* module : pending) {
+            paths.push_back(module->path);
+         }
+         for (const auto& path : paths) {
+            modules.erase(path);
+         }
+         err::set_program_code(source.code, source.file);
+         throw;
+      }
+   }
+
+   void Registry::load(Stmt& stmt) {
+      std::vector<ImportStmt*> imports;
+      find_imports(stmt, imports);
+      load(imports);
+   }
+
+   void Registry::load(Program& program, std::string_view code) {
+      if (code.find("import") == std::string_view::npos) {
+         return;
+      }
+
+      std::vector<ImportStmt*> imports;
+      for (auto& stmt : program.statements) {
+         find_imports(stmt, imports);
+      }
+      load(imports);
+   }
+
+   Module& Registry::get(const ImportStmt& import) {
+      return *modules.at(import.path);
+   }
+}
@@ -3,11 +3,58 @@
 // Includes
 
 #include "fmt.hpp"
+#include <array>
+#include <filesystem>
+#include <unordered_map>
+
+// Binding powers of binary operators, from the operator precedence table in the README (power is 16 - precedence)
+
+struct Binding {
+   int power = 0;
+   bool right_to_left = false, assignment = false;
+};
+
+static constexpr auto bindings = [] {
+   std::array<Binding, std::size(type_str)> table {};
+   table[int(Type::quesion)] = {1, true};
+   table[int(Type::binary_cond)] = {2, true};
+
+   for (auto op : {Type::assign, Type::plus_eq, Type::minus_eq, Type::multiply_eq, Type::divide_eq, Type::remainder_eq, Type::exponentiate_eq}) {
+      table[int(op)] = {3, true, true};
+   }
+   table[int(Type::log_or)] = {4};
+   table[int(Type::log_and)] = {5};
+
+   for (auto op : {Type::equals, Type::really_equals, Type::not_equals, Type::really_not_equals, Type::divisible}) {
+      table[int(op)] = {6};
+   }
+   for (auto op : {Type::greater, Type::greater_equal, Type::smaller, Type::smaller_equal}) {
+      table[int(op)] = {7};
+   }
+   table[int(Type::plus)] = table[int(Type::minus)] = {8};
+   table[int(Type::multiply)] = table[int(Type::divide)] = table[int(Type::remainder)] = {9};
+   table[int(Type::exponentiate)] = {10, true};
+   return table;
+}();
+
+// Type names used by annotations
+
+static const std::unordered_map<std::string_view, StaticType> type_names {
+   {"number", StaticType::number}, {"string", StaticType::string}, {"char", StaticType::character}, {"bool", StaticType::boolean},
+   {"null", StaticType::null}, {"fn", StaticType::function}, {"array", StaticType::array}, {"any", StaticType::dynamic}
+};
 
 // Parse functions
 
-Parser::Parser(std::vector<Token>& tokens)
-   : tokens(tokens) {}
+Parser::Parser(std::vector<Token>& tokens, bool lazy)
+   : tokens(tokens), lazy(lazy) {}
+
+Parser::Parser(Lexer& lexer)
+   : tokens(window), lexer(&lexer)
+{
+   tokens.push_back(lexer.next());
+   fill();
+}
 
 Program& Parser::parse() {
    while (!is(Type::eof)) {
@@ -16,6 +63,22 @@ Program& Parser::parse() {
    return program;
 }
 
+// Parses the next top-level statement of a streamed program, or returns nullptr at its end
+Stmt Parser::next() {
+   if (lexer && index > 1) {
+      tokens.erase(tokens.begin(), tokens.begin() + index - 1);
+      index = 1;
+      lexer->release(tokens);
+   }
+   return (is(Type::eof) ? nullptr : parse_expr());
+}
+
+// Parses the body of a lazily parsed function, starting at its '{'
+Stmt Parser::parse_body(size_t begin) {
+   index = begin;
+   return parse_block();
+}
+
 // Parse statement functions
 
 // Parse statement
@@ -23,53 +86,61 @@ Program& Parser::parse() {
 Stmt Parser::parse_stmt() {
    auto& token = current();
 
-   if (token.type == Type::keyword) {
-      if (token.lexeme == "let"s || token.lexeme == "con"s) {
-         return parse_var_decl();
-      } else if (token.lexeme == "fn"s) {
-         return parse_fn_decl();
-      } else if (token.lexeme == "delete"s) {
-         return parse_del_stmt();
-      } else if (token.lexeme == "exists"s) {
-         return parse_exists_stmt();
-      } else if (token.lexeme == "if"s) {
-         return parse_if_else_stmt();
-      } else if (token.lexeme == "while"s) {
-         return parse_while_loop();
-      } else if (token.lexeme == "for"s) {
-         return parse_for_loop();
-      } else if (token.lexeme == "break"s) {
-         advance();
-         return parse_unless_stmt(BreakStmt::make(line()));
-      } else if (token.lexeme == "continue"s) {
-         advance();
-         return parse_unless_stmt(ContinueStmt::make(line()));
-      } else if (token.lexeme == "return"s) {
-         return parse_return_stmt();
-      } else if (token.lexeme == "do"s) {
-         return parse_unless_stmt(parse_block());
-      } else {
-         fmt::raise(token.line, "Unknown keyword '{}'.", token.lexeme);
-      }
+   switch (token.type) {
+   case Type::kw_let:
+   case Type::kw_con:
+      return parse_var_decl();
+   case Type::kw_fn:
+      return parse_fn_decl();
+   case Type::kw_delete:
+      return parse_del_stmt();
+   case Type::kw_exists:
+      return parse_exists_stmt();
+   case Type::kw_if:
+      return parse_if_else_stmt();
+   case Type::kw_while:
+      return parse_while_loop();
+   case Type::kw_for:
+      return parse_for_loop();
+   case Type::kw_break:
+      advance();
+      return parse_unless_stmt(BreakStmt::make(line()));
+   case Type::kw_continue:
+      advance();
+      return parse_unless_stmt(ContinueStmt::make(line()));
+   case Type::kw_return:
+      return parse_return_stmt();
+   case Type::kw_do:
+      return parse_unless_stmt(parse_block());
+   case Type::kw_import:
+      return parse_import_stmt();
+   case Type::kw_try:
+      return parse_try_stmt();
+   default:
+      fmt::raise_if(token.line, is_keyword(token.type), "Unknown keyword '{}'.", token.lexeme);
+      return parse_expr();
    }
-   return parse_expr();
 }
 
 // Parse variable declaration statement
 
 Stmt Parser::parse_var_decl() {
-   bool constant = current().lexeme == "con"s;
+   bool constant = is(Type::kw_con);
    advance();
 
    std::vector<Stmt> identifiers;
    auto identifier = std::move(parse_primary_expr());
    fmt::raise_if(line(), identifier->type != StmtType::identifier, "Expected 'IdentifierLiteral', got '{}' instead.", stmt_type_str[int(identifier->type)]);
+   parse_annotation(identifier);
+   bool annotated = !get_stmt<IdentLiteral>(identifier).annotation.accepts_any();
 
    while (is(Type::comma)) {
       advance();
       identifiers.push_back(std::move(identifier));
       identifier = std::move(parse_primary_expr());
       fmt::raise_if(line(), identifier->type != StmtType::identifier, "Expected 'IdentifierLiteral', got '{}' instead.", stmt_type_str[int(identifier->type)]);
+      parse_annotation(identifier);
+      annotated = annotated || !get_stmt<IdentLiteral>(identifier).annotation.accepts_any();
    }
 
    identifiers.push_back(std::move(identifier));
@@ -92,6 +163,7 @@ Stmt Parser::parse_var_decl() {
    }
 
    fmt::raise_if(line(), constant, "Expected constant variableto have initialized value.");
+   fmt::raise_if(line(), annotated, "Expected annotated variable to have initialized value.");
    return VarDeclaration::make(constant, std::move(identifiers), std::move(body), line());
 }
 
@@ -100,10 +172,14 @@ Stmt Parser::parse_var_decl() {
 Stmt Parser::parse_fn_decl() {
    advance();
    auto original_line = line();
-   auto identifier = parse_primary_expr();
-   fmt::raise_if(line(), identifier->type != StmtType::identifier, "Expected identifier after 'fn' keyword, got '{}' instead.", stmt_type_str[int(identifier->type)]);
 
-   fmt::raise_if(line(), !is(Type::l_paren), "Expected '(' after 'fn {}', got '{}' instead.", get_stmt<IdentLiteral>(identifier).identifier, type_str[int(current().type)]);
+   // Anonymous functions are expressions evaluating to the function
+   Stmt identifier = NullLiteral::make(line());
+   if (!is(Type::l_paren)) {
+      identifier = parse_primary_expr();
+      fmt::raise_if(line(), identifier->type != StmtType::identifier, "Expected identifier after 'fn' keyword, got '{}' instead.", stmt_type_str[int(identifier->type)]);
+      fmt::raise_if(line(), !is(Type::l_paren), "Expected '(' after 'fn {}', got '{}' instead.", get_stmt<IdentLiteral>(identifier).identifier, type_str[int(current().type)]);
+   }
    advance();
 
    std::vector<Stmt> arguments, argument_def;
@@ -111,6 +187,7 @@ Stmt Parser::parse_fn_decl() {
 
    if (!is(Type::r_paren)) {
       auto arg = parse_primary_expr();
+      parse_annotation(arg);
       if (is(Type::assign)) {
          advance();
          argument_def.push_back(parse_expr());
@@ -125,6 +202,7 @@ Stmt Parser::parse_fn_decl() {
 
          arguments.push_back(std::move(arg));
          arg = parse_primary_expr();
+         parse_annotation(arg);
 
          fmt::raise_if(line(), def_args && !is(Type::assign), "All arguments with a default value must be placed at the end of the parameter list.");
          if (is(Type::assign)) {
@@ -141,20 +219,30 @@ Stmt Parser::parse_fn_decl() {
 
    auto returns = NullLiteral::make(line());
    auto return_def = NullLiteral::make(line());
+   Annotation return_type;
 
    if (is(Type::arrow)) {
       advance();
-      returns = parse_primary_expr();
-      fmt::raise_if(line(), returns->type != StmtType::identifier, "Expected 'IdentifierLiteral' after '->', got '{}' instead.", stmt_type_str[int(returns->type)]);
 
-      if (is(Type::assign)) {
-         advance();
-         return_def = parse_expr();
+      // '-> type' annotates the returned value, '-> name' declares a return variable
+      if (is_type_name() && peek().type != Type::assign && peek().type != Type::colon) {
+         return_type = parse_type();
+      } else {
+         returns = parse_primary_expr();
+         fmt::raise_if(line(), returns->type != StmtType::identifier, "Expected 'IdentifierLiteral' after '->', got '{}' instead.", stmt_type_str[int(returns->type)]);
+         parse_annotation(returns);
+
+         if (is(Type::assign)) {
+            advance();
+            return_def = parse_expr();
+         }
       }
    }
 
-   auto body = parse_block();
-   return parse_unless_stmt(FnDeclaration::make(std::move(identifier), std::move(arguments), std::move(argument_def), std::move(returns), std::move(return_def), std::move(body), def_args, original_line));
+   auto body = (lazy && is(Type::l_brace) ? skip_block() : parse_block());
+   auto decl = FnDeclaration::make(std::move(identifier), std::move(arguments), std::move(argument_def), std::move(returns), std::move(return_def), std::move(body), def_args, original_line);
+   get_stmt<FnDeclaration>(decl).return_type = return_type;
+   return parse_unless_stmt(std::move(decl));
 }
 
 // Parse exists statement
@@ -193,12 +281,12 @@ Stmt Parser::parse_if_else_stmt() {
    auto ifclause = parse_if_clause();
    std::vector<Stmt> elifclauses;
 
-   while (is(Type::keyword) && current().lexeme == "elif"s) {
+   while (is(Type::kw_elif)) {
       auto elif = parse_if_clause();
       elifclauses.push_back(std::move(elif));
    }
 
-   if (is(Type::keyword) && current().lexeme == "else"s) {
+   if (is(Type::kw_else)) {
       auto elseclause = parse_if_clause();
       return parse_unless_stmt(IfElseStmt::make(std::move(ifclause), std::move(elifclauses), std::move(elseclause), line()));
    }
@@ -208,10 +296,11 @@ Stmt Parser::parse_if_else_stmt() {
 // Parse if clause statement
 
 Stmt Parser::parse_if_clause() {
-   std::string keyword = current().lexeme;
+   std::string keyword (current().lexeme);
+   bool is_else = is(Type::kw_else);
    advance();
 
-   auto expr = (keyword == "else"s ? NullLiteral::make(line()) : parse_expr());
+   auto expr = (is_else ? NullLiteral::make(line()) : parse_expr());
    auto stmt = parse_block();
    return IfClauseStmt::make(keyword, std::move(expr), std::move(stmt), line());
 }
@@ -221,7 +310,7 @@ Stmt Parser::parse_if_clause() {
 Stmt Parser::parse_while_loop() {
    advance();
 
-   if (is(Type::keyword) && current().lexeme == "do"s || is(Type::l_brace)) {
+   if (is(Type::kw_do) || is(Type::l_brace)) {
       auto stmt = parse_block();
       return WhileStmt::make(true, NullLiteral::make(line()), std::move(stmt), line());
    }
@@ -236,7 +325,7 @@ Stmt Parser::parse_while_loop() {
 Stmt Parser::parse_for_loop() {
    advance();
 
-   if (is(Type::keyword) && current().lexeme == "do"s || is(Type::l_brace)) {
+   if (is(Type::kw_do) || is(Type::l_brace)) {
       auto stmt = parse_block();
       return ForStmt::make(std::nullopt, std::nullopt, std::nullopt, std::move(stmt), line());
    }
@@ -254,7 +343,7 @@ Stmt Parser::parse_for_loop() {
    fmt::raise_if(line(), !is(Type::semicolon), "Expected semicolon after conditional for loop expression, got '{}' instead.", type_str[int(current().type)]);
    advance();
 
-   if ((!is(Type::keyword) || current().lexeme != "do"s) && !is(Type::l_brace)) {
+   if (!is(Type::kw_do) && !is(Type::l_brace)) {
       loopexpr = std::optional(parse_expr());
    }
 
@@ -265,7 +354,7 @@ Stmt Parser::parse_for_loop() {
 // Parse block (scope/do statement)
 
 Stmt Parser::parse_block() {
-   if (is(Type::keyword) && current().lexeme == "do"s) {
+   if (is(Type::kw_do)) {
       advance();
       auto program = std::make_unique<Program>(line());
       auto stmt = parse_expr();
@@ -276,187 +365,154 @@ Stmt Parser::parse_block() {
    return parse_primary_expr();
 }
 
-// Parse return statement
+// Skip block (scope) of a lazily parsed function
 
-Stmt Parser::parse_return_stmt() {
-   advance();
-   auto expr = ReturnStmt::make(parse_expr(), line());
-   return parse_unless_stmt(std::move(expr));
-}
-
-// Parse unless statement
+Stmt Parser::skip_block() {
+   auto begin = index;
+   auto original_line = line();
 
-Stmt Parser::parse_unless_stmt(Stmt stmt) {
-   if (is(Type::keyword) && current().lexeme == "unless"s) {
-      advance();
-      auto expr = parse_expr();
-      return UnlessStmt::make(std::move(expr), std::move(stmt), line());
+   for (int depth = 0; !is(Type::eof); advance()) {
+      depth += is(Type::l_brace) - is(Type::r_brace);
+      if (depth == 0) {
+         advance();
+         return LazyBody::make(&tokens, begin, index, original_line);
+      }
    }
-   return std::move(stmt);
+   fmt::raise(original_line, "Unterminated scope.");
 }
 
-// Parse expression functions
-
-// Parse expression
+// Parse return statement
 
-Stmt Parser::parse_expr() {
-   return parse_ternary_expr();
+Stmt Parser::parse_return_stmt() {
+   advance();
+   auto expr = ReturnStmt::make(parse_expr(), line());
+   return parse_unless_stmt(std::move(expr));
 }
 
-// Parse ternary expression
+// Parse import statement, the module is named after its file unless '-> name' names it
 
-Stmt Parser::parse_ternary_expr() {
-   auto left = parse_value_or_expr();
-
-   while (is(Type::quesion)) {
-      advance();
+Stmt Parser::parse_import_stmt() {
+   advance();
+   fmt::raise_if(line(), !is(Type::string), "Expected a file path after 'import' keyword, got '{}' instead.", type_str[int(current().type)]);
+   std::string file (current().lexeme);
+   advance();
 
-      auto middle = parse_ternary_expr();
-      fmt::raise_if(line(), !is(Type::colon), "Expected ':' after '{} ? {}'.", stmt_type_str[int(left->type)], stmt_type_str[int(middle->type)]);
+   Stmt identifier;
+   if (is(Type::arrow)) {
       advance();
-
-      auto right = parse_ternary_expr();
-      left = TernaryExpr::make(std::move(left), std::move(middle), std::move(right), line());
+      identifier = parse_primary_expr();
+      fmt::raise_if(line(), identifier->type != StmtType::identifier, "Expected 'IdentifierLiteral' after '->', got '{}' instead.", stmt_type_str[int(identifier->type)]);
+   } else {
+      auto name = std::filesystem::path(file).stem().string();
+      bool valid = !name.empty() && !isdigit(name.front()) && keywords.find(name, Type::identifier) == Type::identifier;
+      for (char ch : name) {
+         valid = valid && (isalnum(ch) || ch == '_');
+      }
+      fmt::raise_if(line(), !valid, "Expected the file name of module '{}' to be an identifier, name the module with '->' instead.", file);
+      identifier = IdentLiteral::make(name, line());
    }
-   return std::move(left);
+   return parse_unless_stmt(ImportStmt::make(file, std::move(identifier), line()));
 }
 
-// Parse value or expression
+// Parse try statement, the error is only declared if an identifier follows 'catch'
 
-Stmt Parser::parse_value_or_expr() {
-   auto left = parse_assignment_expr();
-
-   while (is(Type::binary_cond)) {
-      Type op = current().type;
-      advance();
+Stmt Parser::parse_try_stmt() {
+   advance();
+   auto body = parse_block();
+   fmt::raise_if(line(), !is(Type::kw_catch), "Expected 'catch' keyword after the body of a try statement, got '{}' instead.", type_str[int(current().type)]);
+   advance();
 
-      auto right = parse_value_or_expr();
-      left = BinaryExpr::make(op, std::move(left), std::move(right), line());
+   std::optional<Stmt> identifier = std::nullopt;
+   if (!is(Type::kw_do) && !is(Type::l_brace)) {
+      identifier = std::optional(parse_primary_expr());
+      fmt::raise_if(line(), identifier.value()->type != StmtType::identifier, "Expected 'IdentifierLiteral' after 'catch', got '{}' instead.", stmt_type_str[int(identifier.value()->type)]);
    }
-   return std::move(left);
-}
-
-// Parse assignment expression
 
-Stmt Parser::parse_assignment_expr() {
-   auto left = parse_logical_or_expr();
-
-   while (is(Type::assign) || is(Type::plus_eq) || is(Type::minus_eq) || is(Type::multiply_eq) || is(Type::divide_eq) || is(Type::remainder_eq) || is(Type::exponentiate_eq)) {
-      Type op = current().type;
-      advance();
-
-      auto right = parse_assignment_expr();
-      left = AssignmentExpr::make(op, std::move(left), std::move(right), line());
-   }
-   return std::move(left);
+   auto handler = parse_block();
+   return parse_unless_stmt(TryStmt::make(std::move(body), std::move(identifier), std::move(handler), line()));
 }
 
-// Parse logical or expression
-
-Stmt Parser::parse_logical_or_expr() {
-   auto left = parse_logical_and_expr();
+// Parse unless statement
 
-   while (is(Type::log_or)) {
-      Type op = current().type;
+Stmt Parser::parse_unless_stmt(Stmt stmt) {
+   if (is(Type::kw_unless)) {
       advance();
-
-      auto right = parse_logical_and_expr();
-      left = BinaryExpr::make(op, std::move(left), std::move(right), line());
+      auto expr = parse_expr();
+      return UnlessStmt::make(std::move(expr), std::move(stmt), line());
    }
-   return std::move(left);
+   return std::move(stmt);
 }
 
-// Parse logical and expression
-
-Stmt Parser::parse_logical_and_expr() {
-   auto left = parse_equality_expr();
-
-   while (is(Type::log_and)) {
-      Type op = current().type;
-      advance();
+// Parse type annotation of a declared identifier, if there is one
 
-      auto right = parse_equality_expr();
-      left = BinaryExpr::make(op, std::move(left), std::move(right), line());
+void Parser::parse_annotation(Stmt& identifier) {
+   if (!is(Type::colon)) {
+      return;
    }
-   return std::move(left);
+   fmt::raise_if(line(), identifier->type != StmtType::identifier, "Expected 'IdentifierLiteral' before type annotation, got '{}' instead.", stmt_type_str[int(identifier->type)]);
+   advance();
+   get_stmt<IdentLiteral>(identifier).annotation = parse_type();
 }
 
-// Parse equality expression
-
-Stmt Parser::parse_equality_expr() {
-   auto left = parse_relational_expr();
+// Parse type
 
-   while (is(Type::equals) || is(Type::really_equals) || is(Type::not_equals) || is(Type::really_not_equals) || is(Type::divisible)) {
-      Type op = current().type;
+Annotation Parser::parse_type() {
+   if (is(Type::l_bracket)) {
       advance();
-
-      auto right = parse_relational_expr();
-      left = BinaryExpr::make(op, std::move(left), std::move(right), line());
-   }
-   return std::move(left);
-}
-
-// Parse relational expression
-
-Stmt Parser::parse_relational_expr() {
-   auto left = parse_additive_expr();
-
-   while (is(Type::greater) || is(Type::greater_equal) || is(Type::smaller) || is(Type::smaller_equal)) {
-      Type op = current().type;
+      auto element = parse_type();
+      fmt::raise_if(line(), !is(Type::r_bracket), "Expected ']' after array element type, got '{}' instead.", current().lexeme);
       advance();
-
-      auto right = parse_additive_expr();
-      left = BinaryExpr::make(op, std::move(left), std::move(right), line());
+      return {StaticType::array, element.type};
    }
-   return std::move(left);
-}
-
-// Parse additive expression
-
-Stmt Parser::parse_additive_expr() {
-   auto left = parse_multiplicative_expr();
-
-   while (is(Type::plus) || is(Type::minus)) {
-      Type op = current().type;
-      advance();
 
-      auto right = parse_multiplicative_expr();
-      left = BinaryExpr::make(op, std::move(left), std::move(right), line());
-   }
-   return std::move(left);
+   fmt::raise_if(line(), !is_type_name(), "Expected type name, got '{}' instead.", current().lexeme);
+   auto type = type_names.at(current().lexeme);
+   advance();
+   return {type};
 }
 
-// Parse multiplicative expression
-
-Stmt Parser::parse_multiplicative_expr() {
-   auto left = parse_exponentiative_expr();
+// Parse expression functions
 
-   while (is(Type::multiply) || is(Type::divide) || is(Type::remainder)) {
-      Type op = current().type;
-      advance();
+// Parse expression
 
-      auto right = parse_exponentiative_expr();
-      left = BinaryExpr::make(op, std::move(left), std::move(right), line());
-   }
-   return std::move(left);
+Stmt Parser::parse_expr() {
+   return parse_binary_expr(1);
 }
 
-// Parse exponentiative expression
+// Parse binary expression
+// Operators are parsed by precedence climbing. Every operand absorbs the operators binding at least as strong as
+// 'power', so each operator is looked up once instead of descending through every precedence level.
 
-Stmt Parser::parse_exponentiative_expr() {
+Stmt Parser::parse_binary_expr(int power) {
+   fmt::raise_if(line(), ++depth > max_depth, "Expression is nested deeper than {} levels.", max_depth);
    auto left = parse_unary_expr();
 
-   while (is(Type::exponentiate)) {
+   for (auto binding = bindings[int(current().type)]; binding.power >= power; binding = bindings[int(current().type)]) {
       Type op = current().type;
       advance();
 
-      auto right = parse_exponentiative_expr();
-      left = BinaryExpr::make(op, std::move(left), std::move(right), line());
+      if (op == Type::quesion) {
+         auto middle = parse_expr();
+         fmt::raise_if(line(), !is(Type::colon), "Expected ':' after '{} ? {}'.", stmt_type_str[int(left->type)], stmt_type_str[int(middle->type)]);
+         advance();
+
+         auto right = parse_expr();
+         left = TernaryExpr::make(std::move(left), std::move(middle), std::move(right), line());
+         continue;
+      }
+
+      auto right = parse_binary_expr(binding.right_to_left ? binding.power : binding.power + 1);
+      if (binding.assignment) {
+         left = AssignmentExpr::make(op, std::move(left), std::move(right), line());
+      } else {
+         left = BinaryExpr::make(op, std::move(left), std::move(right), line());
+      }
    }
+   --depth;
    return std::move(left);
 }
 
-// Parse unary expression
+// Parse unary expression (prefix operators, then a single increment or decrement operator)
 
 Stmt Parser::parse_unary_expr() {
    std::vector<Type> ops;
@@ -465,22 +521,17 @@ Stmt Parser::parse_unary_expr() {
       ops.push_back(current().type);
       advance();
    }
-   auto expr = parse_reverse_unary_expr();
-   for (int i = ops.size() - 1; i >= 0; --i) {
-      expr = UnaryExpr::make(ops.at(i), std::move(expr), line());
-   }
-   return expr;
-}
-
-// Parse reverse unary expression (increment and decrement operators)
 
-Stmt Parser::parse_reverse_unary_expr() {
    auto expr = parse_property_access();
    if (is(Type::increment) || is(Type::decrement)) {
       Type op = current().type;
       advance();
       expr = UnaryExpr::make(op, std::move(expr), line());
    }
+
+   for (int i = ops.size() - 1; i >= 0; --i) {
+      expr = UnaryExpr::make(ops.at(i), std::move(expr), line());
+   }
    return expr;
 }
 
@@ -568,25 +619,19 @@ Stmt Parser::parse_member_access() {
 
 Stmt Parser::parse_primary_expr() {
    if (is(Type::identifier)) {
-      std::string identifier = current().lexeme;
+      std::string identifier (current().lexeme);
       advance();
       return IdentLiteral::make(identifier, line());
    } else if (is(Type::number)) {
-      long double number = 0.0;
-
-      try {
-         number = std::stold(current().lexeme);
-      } catch (...) {
-         fmt::raise(line(), "Failed to convert string '{}' to number. Number might be too large, too small, or invalid.", current().lexeme);
-      }
+      long double number = current().number;
       advance();
       return NumberLiteral::make(number, line());
    } else if (is(Type::character)) {
-      char ch = current().lexeme.at(0);
+      char ch = current().ch;
       advance();
       return CharLiteral::make(ch, line());
    } else if (is(Type::string)) {
-      std::string string = current().lexeme;
+      std::string string (current().lexeme);
       advance();
       return StringLiteral::make(string, line());
    } else if (is(Type::l_paren)) {
@@ -632,7 +677,7 @@ Stmt Parser::parse_primary_expr() {
       fmt::raise_if(array->line, !is(Type::r_bracket), "Unterminated array literal.");
       advance();
       return std::move(array);
-   } else if (is(Type::keyword)) {
+   } else if (is_keyword(current().type)) {
       return std::move(parse_stmt());
    } else {
       fmt::raise(line(), "Expected primary expression, got '{}' instead.", type_str[int(current().type)]);
@@ -642,18 +687,36 @@ Stmt Parser::parse_primary_expr() {
 // Utility functions
 
 void Parser::advance() {
+   fill();
    if (index + 1 < tokens.size())
       ++index;
 }
 
+void Parser::fill() {
+   while (lexer && tokens.size() < index + 3 && tokens.back().type != Type::eof) {
+      tokens.push_back(lexer->next());
+   }
+}
+
 bool Parser::is(Type type) const {
    return index < tokens.size() && tokens.at(index).type == type;
 }
 
+bool Parser::is_type_name() const {
+   if (is(Type::l_bracket)) {
+      return true;
+   }
+   return (is(Type::identifier) || is_keyword(tokens.at(index).type)) && type_names.find(tokens.at(index).lexeme) != type_names.end();
+}
+
 Token& Parser::current() {
    return tokens.at(index);
 }
 
+const Token& Parser::peek() const {
+   return tokens.at(std::min(index + 1, tokens.size() - 1));
+}
+
 int Parser::line() const {
    return (index == 0 ? tokens.at(index).line : tokens.at(index - 1).line);
 }
@@ -0,0 +1,120 @@
+#include "profile.hpp"
+
+// Includes
+
+#include "file.hpp"
+#include "fmt.hpp"
+#include <fstream>
+
+// Static variables
+
+static constexpr auto profile_header = "cll-profile 1";
+
+// Utility functions
+
+static std::uint16_t type_bit(ValueType type) {
+   return std::uint16_t(1) << int(type);
+}
+
+// Parameter type used to specialize a function, only if every profiled call passed the same type
+static StaticType guard_type(std::uint16_t mask) {
+   static const std::pair<ValueType, StaticType> types[] {
+      {ValueType::number, StaticType::number}, {ValueType::character, StaticType::character}, {ValueType::string, StaticType::string},
+      {ValueType::boolean, StaticType::boolean}, {ValueType::array, StaticType::array}, {ValueType::null, StaticType::null}
+   };
+
+   for (const auto& [value_type, static_type] : types) {
+      if (mask == type_bit(value_type)) {
+         return static_type;
+      }
+   }
+   return StaticType::unknown;
+}
+
+// Constructors
+
+Profile::Profile(std::uint64_t source)
+   : source(source) {}
+
+// Profile functions
+
+void Profile::load(const std::string& file) {
+   if (!file::exists(file)) {
+      return;
+   }
+
+   std::ifstream fbuf (file);
+   std::string header;
+   std::getline(fbuf, header);
+   fmt::raise_if(err::nline, header != profile_header, "File '{}' is not a profile.", file);
+
+   std::string line;
+   for (int i = 2; std::getline(fbuf, line); ++i) {
+      std::stringstream ss (line);
+      std::uint64_t hash = 0, calls = 0;
+      int fn_line = 0;
+      std::string identifier;
+      ss >> std::hex >> hash >> std::dec >> fn_line >> identifier >> calls;
+      fmt::raise_if(err::nline, !ss, "Malformed profile '{}' at line {}.", file, i);
+
+      auto& entry = functions[{hash, fn_line, identifier}];
+      entry.calls += calls;
+
+      std::uint16_t mask = 0;
+      for (size_t param = 0; ss >> mask; ++param) {
+         if (param >= entry.parameters.size()) {
+            entry.parameters.push_back(0);
+         }
+         entry.parameters.at(param) |= mask;
+      }
+   }
+}
+
+void Profile::save(const std::string& file) const {
+   std::ofstream fbuf (file);
+   fmt::raise_if(err::nline, !fbuf, "Could not write profile '{}'.", file);
+
+   fbuf << profile_header << '\n';
+   for (const auto& [key, entry] : functions) {
+      const auto& [hash, line, identifier] = key;
+      fbuf << std::hex << hash << std::dec << ' ' << line << ' ' << identifier << ' ' << entry.calls;
+
+      for (auto mask : entry.parameters) {
+         fbuf << ' ' << mask;
+      }
+      fbuf << '\n';
+   }
+}
+
+void Profile::record(const Function& fn, const std::vector<Value>& args) {
+   auto& entry = functions[{source, fn.line, fn.identifier}];
+   entry.parameters.resize(fn.parameters.size());
+   ++entry.calls;
+
+   for (size_t i = 0; i < fn.parameters.size(); ++i) {
+      const auto& value = (i < args.size() ? args.at(i) : fn.parameter_def.at(i - (fn.parameters.size() - fn.def_args)));
+      entry.parameters.at(i) |= type_bit(value->type);
+   }
+}
+
+// Access functions
+
+std::vector<StaticType> Profile::guards(int line, const std::string& identifier, size_t parameters) const {
+   auto entry = find(line, identifier);
+   if (!entry || entry->parameters.size() != parameters) {
+      return {};
+   }
+
+   std::vector<StaticType> guards;
+   bool guarded = false;
+   for (auto mask : entry->parameters) {
+      guards.push_back(guard_type(mask));
+      guarded = guarded || guards.back() != StaticType::unknown;
+   }
+   return (guarded ? guards : std::vector<StaticType>{});
+}
+
+const Profile::FnProfile* Profile::find(int line, const std::string& identifier) const {
+   auto it = functions.find({source, line, identifier});
+   return (it == functions.end() ? nullptr : &it->second);
+}
@@ -4,53 +4,60 @@
 
 #include "environment.hpp"
 #include "fmt.hpp"
+#include "functions.hpp"
+#include "tokens.hpp"
+#include <cmath>
 
 // Properties
 
 namespace prop {
-   // Property map
+   // Property table
+   // Constant-initialized like fun::builtins, values are made on lookup. Properties that override assign the result
+   // back to the variable they were called on.
+
+   struct Property {
+      std::string_view name;
+      ValueType type;
+      fun::Native call;
+      bool overrides = false;
+   };
 
-   using Key = std::pair<std::string, char>;
-   using Val = std::pair<Value, bool>;
-   constexpr char array_v = char(ValueType::array);
+   static constexpr Property properties[] {
+      {"push", ValueType::array, array_push, true}, {"pop", ValueType::array, array_pop}, {"size", ValueType::array, array_size},
+      {"empty", ValueType::array, array_empty}, {"at", ValueType::array, array_at}, {"find", ValueType::array, array_find},
+      {"find_all", ValueType::array, array_find_all}, {"contains", ValueType::array, array_contains}, {"in_bounds", ValueType::array, array_in_bounds},
+      {"first", ValueType::array, array_first}, {"last", ValueType::array, array_last}, {"clear", ValueType::array, array_clear, true},
+      {"fill", ValueType::array, array_fill, true}, {"join", ValueType::array, array_join},
+      {"message", ValueType::error, error_message}, {"line", ValueType::error, error_line}, {"code", ValueType::error, error_code}
+   };
 
-   struct PairHash {
-      std::size_t operator()(const Key& pair) const {
-         return std::hash<std::string>{}(pair.first) ^ (std::hash<char>{}(pair.second) << 1);
+   static constexpr auto property_index = [] {
+      std::array<PerfectHash<64, int>::Entry, std::size(properties)> entries {};
+      for (std::size_t i = 0; i < entries.size(); ++i) {
+         entries[i] = {properties[i].name, int(i)};
       }
-   };
+      return PerfectHash<64, int>(entries);
+   }();
 
-   static std::unordered_map<Key, Val, PairHash> properties {};
+   static const Property* find(const std::string& name, ValueType type) {
+      int index = property_index.find(name, -1);
+      return (index == -1 || properties[index].type != type ? nullptr : &properties[index]);
+   }
 
    // Property functions
 
-   void init() {
-      properties.insert({Key{"push", array_v}, Val{NativeFn::make(array_push, "push", err::nline), true}});
-      properties.insert({Key{"pop", array_v}, Val{NativeFn::make(array_pop, "pop", err::nline), false}});
-      properties.insert({Key{"size", array_v}, Val{NativeFn::make(array_size, "size", err::nline), false}});
-      properties.insert({Key{"empty", array_v}, Val{NativeFn::make(array_empty, "empty", err::nline), false}});
-      properties.insert({Key{"at", array_v}, Val{NativeFn::make(array_at, "at", err::nline), false}});
-      properties.insert({Key{"find", array_v}, Val{NativeFn::make(array_find, "find", err::nline), false}});
-      properties.insert({Key{"find_all", array_v}, Val{NativeFn::make(array_find_all, "find_all", err::nline), false}});
-      properties.insert({Key{"contains", array_v}, Val{NativeFn::make(array_contains, "contains", err::nline), false}});
-      properties.insert({Key{"in_bounds", array_v}, Val{NativeFn::make(array_in_bounds, "in_bounds", err::nline), false}});
-      properties.insert({Key{"first", array_v}, Val{NativeFn::make(array_first, "first", err::nline), false}});
-      properties.insert({Key{"last", array_v}, Val{NativeFn::make(array_last, "last", err::nline), false}});
-      properties.insert({Key{"clear", array_v}, Val{NativeFn::make(array_clear, "clear", err::nline), true}});
-      properties.insert({Key{"fill", array_v}, Val{NativeFn::make(array_fill, "fill", err::nline), true}});
-      properties.insert({Key{"join", array_v}, Val{NativeFn::make(array_join, "join", err::nline), false}});
-   }
-
    bool exists(const std::string& name, ValueType type) {
-      return properties.find(Key{name, char(type)}) != properties.end();
+      return find(name, type);
    }
 
    bool overrides(const std::string& name, ValueType type) {
-      return properties[Key{name, char(type)}].second;
+      auto property = find(name, type);
+      return property && property->overrides;
    }
 
    Value get(const std::string& name, ValueType type) {
-      return properties[Key{name, char(type)}].first->copy();
+      auto& property = *find(name, type);
+      return NativeFn::make(property.call, std::string(property.name), err::nline);
    }
 
    // Property functions
@@ -62,9 +69,15 @@ namespace prop {
       fmt::raise_if(line, args.size() < 3, "'Array.push': Expected at least a single argument.");
       auto& array = get_value<Array>(args.at(1));
 
+      // The array grows, then is copied into the variable and as the result
+      if (mem::account) {
+         auto growth = (array.array.size() + args.size() - 2 > array.array.capacity() ? array.array.size() + args.size() : 0) * sizeof(Value);
+         mem::reserve(growth + 2 * mem::footprint(array), line);
+      }
       for (int i = 2; i < args.size(); ++i) {
          array.array.push_back(std::move(args.at(i)));
       }
+      array.recharge();
 
       if (args.at(0)->type == ValueType::identifier) {
          auto identifier = get_value<IdentValue>(args.at(0));
@@ -193,11 +206,17 @@ namespace prop {
       fmt::raise_if(line, size < 0, "'Array.fill': Expected first argument to be non-negative.");
 
       auto value = (args.size() == 3 ? NullValue::make() : std::move(args.at(3)));
+      // The filled array is copied into the variable and as the result
+      if (mem::account) {
+         auto filled = std::ceil(size) * (sizeof(Value) + mem::footprint(*value));
+         mem::reserve(std::min<long double>(filled * (args.at(0)->type == ValueType::identifier ? 3 : 2), UINT64_MAX), line);
+      }
       array.array.clear();
 
       for (int i = 0; i < size; ++i) {
          array.array.push_back(value->copy());
       }
+      array.recharge();
 
       if (args.at(0)->type == ValueType::identifier) {
          auto identifier = get_value<IdentValue>(args.at(0));
@@ -220,4 +239,22 @@ namespace prop {
       }
       return StringValue::make(std::move(result), line);
    }
+
+   // Error functions
+
+   Value error_message(std::vector<Value>& args, Environment* env, int line) {
+      fmt::raise_if(line, args.size() != 2, "'Error.message': Expected no arguments.");
+      return StringValue::make(get_value<ErrorValue>(args.at(1)).message, line);
+   }
+
+   Value error_line(std::vector<Value>& args, Environment* env, int line) {
+      fmt::raise_if(line, args.size() != 2, "'Error.line': Expected no arguments.");
+      auto& error = get_value<ErrorValue>(args.at(1));
+      return (error.error_line == err::nline ? NullValue::make(line) : NumberValue::make(error.error_line, line));
+   }
+
+   Value error_code(std::vector<Value>& args, Environment* env, int line) {
+      fmt::raise_if(line, args.size() != 2, "'Error.code': Expected no arguments.");
+      return NumberValue::make(get_value<ErrorValue>(args.at(1)).code, line);
+   }
 }
@@ -0,0 +1,297 @@
+#include "records.hpp"
+
+// Includes
+
+#include "checker.hpp"
+#include "fmt.hpp"
+#include "inference.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "module.hpp"
+#include "parser.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// Workers
+
+namespace {
+   // Tokens and syntax tree of the script stay alive for the functions declared by it
+   struct Worker {
+      mod::Registry modules;
+      Environment global;
+      Lexer lexer;
+      std::optional<Parser> parser;
+      Interpreter interpreter;
+      Value map, reduce;
+
+      Worker(std::string_view code, const std::string& directory, bool jit)
+         : modules(directory), lexer(code), interpreter(modules, nullptr, jit) {}
+   };
+
+   struct Batch {
+      std::string input, output;
+      Value partial;
+      std::exception_ptr error;
+      bool done = false;
+   };
+}
+
+// Constants
+
+constexpr size_t block_size = 1 << 20;
+constexpr size_t batch_size = 1 << 16;
+
+// Utility functions
+
+// Output of the batch being mapped by the thread, where what it prints goes
+static thread_local std::string* captured = nullptr;
+
+// Sends what is printed to the output of the batch being mapped by the printing thread while it exists, and what
+// other threads print to stdout
+class Capture : public std::streambuf {
+   std::streambuf* buffer;
+
+public:
+   Capture()
+      : buffer(std::cout.rdbuf(this)) {}
+
+   ~Capture() {
+      std::cout.rdbuf(buffer);
+   }
+
+protected:
+   int_type overflow(int_type ch) override {
+      if (traits_type::eq_int_type(ch, traits_type::eof())) {
+         return traits_type::not_eof(ch);
+      } else if (!captured) {
+         return buffer->sputc(traits_type::to_char_type(ch));
+      }
+      captured->push_back(traits_type::to_char_type(ch));
+      return ch;
+   }
+
+   std::streamsize xsputn(const char* data, std::streamsize size) override {
+      if (!captured) {
+         return buffer->sputn(data, size);
+      }
+      captured->append(data, size);
+      return size;
+   }
+
+   int sync() override {
+      return (captured ? 0 : buffer->pubsync());
+   }
+};
+
+// Discards what is printed while it exists
+class Silence {
+   std::streambuf* buffer;
+
+public:
+   Silence()
+      : buffer(std::cout.rdbuf(nullptr)) {}
+
+   ~Silence() {
+      std::cout.clear();
+      std::cout.rdbuf(buffer);
+   }
+};
+
+static Value get_function(Environment& global, const std::string& name, size_t parameters) {
+   if (!global.variable_exists(name)) {
+      return nullptr;
+   }
+   auto function = global.get_variable(name, err::nline);
+   fmt::raise_if(err::nline, function->type != ValueType::fn || get_value<Function>(function).parameters.size() != parameters, "Expected '{}' to be a function with {} parameter{}.", name, parameters, (parameters == 1 ? "" : "s"));
+   return function;
+}
+
+static void setup(Worker& worker, std::string_view code) {
+   worker.parser.emplace(worker.lexer.lex());
+   auto& program = worker.parser->parse();
+   Checker().check(program);
+   worker.modules.load(program, code);
+   TypeInference().analyze(program);
+   worker.interpreter.evaluate(program, worker.global);
+
+   worker.map = get_function(worker.global, "map", 1);
+   fmt::raise_if(err::nline, !worker.map, "Expected the script to declare 'fn map(record)' to be run with '--map'.");
+   worker.reduce = get_function(worker.global, "reduce", 2);
+}
+
+static Value call(Worker& worker, const Value& function, std::vector<Value>& args) {
+   auto result = worker.interpreter.call_function(worker.global, function->copy(), args, err::nline);
+   return (result ? std::move(result) : NullValue::make(err::nline));
+}
+
+// Maps the records of a batch, an error stops it after the output of the records before it. What is printed while
+// mapping is part of the output.
+static void process(Worker& worker, Batch& batch, char delimiter) {
+   std::vector<Value> args;
+   captured = &batch.output;
+   try {
+      for (size_t start = 0; start < batch.input.size();) {
+         auto end = std::min(batch.input.find(delimiter, start), batch.input.size());
+         args.clear();
+         args.push_back(StringValue::make(batch.input.substr(start, end - start), err::nline));
+         start = end + 1;
+
+         auto result = call(worker, worker.map, args);
+         if (result->type == ValueType::null) {
+            continue;
+         } else if (!worker.reduce) {
+            batch.output += result->as_string();
+            batch.output += delimiter;
+         } else if (!batch.partial) {
+            batch.partial = std::move(result);
+         } else {
+            args.clear();
+            args.push_back(std::move(batch.partial));
+            args.push_back(std::move(result));
+            batch.partial = call(worker, worker.reduce, args);
+         }
+      }
+   } catch (...) {
+      batch.error = std::current_exception();
+      worker.interpreter.unwind({});
+   }
+   captured = nullptr;
+}
+
+// Record functions
+
+namespace rec {
+   int map(std::string_view code, const std::string& directory, unsigned workers, char delimiter, bool jit, const Interpreter::Budget& budget) {
+      // Scripts run one after another before any thread starts, and only the output of the first is shown
+      std::vector<std::unique_ptr<Worker>> pool;
+      for (unsigned i = 0; i < workers; ++i) {
+         auto& worker = *pool.emplace_back(std::make_unique<Worker>(code, directory, jit));
+         worker.interpreter.set_budget(budget);
+         if (i == 0) {
+            setup(worker, code);
+         } else {
+            Silence silence;
+            setup(worker, code);
+         }
+      }
+      auto source = err::program_code();
+
+      std::mutex mutex;
+      std::condition_variable queued, finished;
+      std::deque<Batch*> queue;
+      bool stopping = false;
+
+      Capture capture;
+      std::vector<std::thread> threads;
+      for (auto& worker : pool) {
+         threads.emplace_back([&, worker = worker.get()] {
+            err::set_program_code(source.code, source.file);
+            std::unique_lock lock (mutex);
+            while (true) {
+               queued.wait(lock, [&] { return stopping || !queue.empty(); });
+               if (queue.empty()) {
+                  return;
+               }
+               auto& batch = *queue.front();
+               queue.pop_front();
+
+               lock.unlock();
+               process(*worker, batch, delimiter);
+               lock.lock();
+               batch.done = true;
+               finished.notify_all();
+            }
+         });
+      }
+
+      // Batches are written once every batch before them is, and reading waits while too many are in flight
+      std::deque<std::unique_ptr<Batch>> batches;
+      std::vector<Value> partials;
+      std::exception_ptr error;
+      auto write = [&](bool all) {
+         std::unique_lock lock (mutex);
+         while (!batches.empty() && !error && (all || batches.size() >= 4 * workers || batches.front()->done)) {
+            finished.wait(lock, [&] { return batches.front()->done; });
+            auto batch = std::move(batches.front());
+            batches.pop_front();
+
+            lock.unlock();
+            std::cout.write(batch->output.data(), batch->output.size());
+            lock.lock();
+            if (batch->partial) {
+               partials.push_back(std::move(batch->partial));
+            }
+            error = batch->error;
+         }
+      };
+
+      // Blocks are cut after the last delimiter in them, the rest is read again with the next block
+      std::string block, rest;
+      while (!error) {
+         block.resize(rest.size() + block_size);
+         std::copy(rest.begin(), rest.end(), block.begin());
+         size_t size = rest.size() + std::fread(block.data() + rest.size(), 1, block_size, stdin);
+         bool last = size < block.size();
+         block.resize(size);
+
+         size_t end = (last ? size : block.rfind(delimiter) + 1);
+         rest.assign(block, std::min(end, size));
+         for (size_t start = 0; start < end && !error;) {
+            auto cut = (end - start <= batch_size ? end : block.find(delimiter, start + batch_size));
+            cut = (cut >= end ? end : cut + 1);
+
+            auto batch = std::make_unique<Batch>();
+            batch->input.assign(block, start, cut - start);
+            start = cut;
+            {
+               std::lock_guard lock (mutex);
+               queue.push_back(batch.get());
+               batches.push_back(std::move(batch));
+            }
+            queued.notify_one();
+            write(false);
+         }
+         if (last) {
+            break;
+         }
+      }
+      write(true);
+
+      {
+         std::lock_guard lock (mutex);
+         stopping = true;
+         queue.clear();
+      }
+      queued.notify_all();
+      for (auto& thread : threads) {
+         thread.join();
+      }
+      std::cout.flush();
+
+      if (error) {
+         std::rethrow_exception(error);
+      }
+
+      // Results of the batches are combined by the first worker, in the order the batches were read
+      auto& worker = *pool.front();
+      if (worker.reduce && !partials.empty()) {
+         auto result = std::move(partials.front());
+         std::vector<Value> args;
+         for (size_t i = 1; i < partials.size(); ++i) {
+            args.clear();
+            args.push_back(std::move(result));
+            args.push_back(std::move(partials[i]));
+            result = call(worker, worker.reduce, args);
+         }
+         std::cout << result->as_string() << '\n';
+      }
+      return 0;
+   }
+}
@@ -0,0 +1,282 @@
+#include "scan.hpp"
+
+// Includes
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CLL_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Scan
+
+namespace scan {
+   // Scalar versions, also used for the bytes after the last full vector
+
+   namespace {
+      std::size_t whitespace_scalar(std::string_view code, std::size_t index, int& line) {
+         for (; index < code.size() && isspace(static_cast<unsigned char>(code[index])); ++index) {
+            line += (code[index] == '\n');
+         }
+         return index;
+      }
+
+      std::size_t identifier_scalar(std::string_view code, std::size_t index) {
+         for (; index < code.size() && (isalnum(static_cast<unsigned char>(code[index])) || code[index] == '_'); ++index);
+         return index;
+      }
+
+      std::size_t find_scalar(std::string_view code, std::size_t index, char first, char second) {
+         for (; index < code.size() && code[index] != first && code[index] != second; ++index);
+         return std::min(index, code.size());
+      }
+
+      std::size_t block_comment_scalar(std::string_view code, std::size_t index, int& line) {
+         for (; index < code.size() && (code[index] != '*' || index + 1 >= code.size() || code[index + 1] != '/'); ++index) {
+            line += (code[index] == '\n');
+         }
+         return std::min(index, code.size());
+      }
+   }
+
+#ifdef CLL_SIMD
+   // Every vector produces a bit mask with one bit per byte. The scanned run ends at the lowest set bit of 'stop',
+   // line breaks before it are counted from 'lines'.
+
+   namespace {
+      inline bool finish(std::uint32_t stop, std::size_t& index) {
+         if (stop) {
+            index += __builtin_ctz(stop);
+         }
+         return stop;
+      }
+
+      inline bool finish(std::uint32_t stop, std::uint32_t lines, std::size_t& index, int& line) {
+         line += __builtin_popcount(stop ? lines & ((stop & -stop) - 1) : lines);
+         return finish(stop, index);
+      }
+
+      // SSE2 is part of x86-64, so these need no runtime check
+
+      inline __m128i load_sse2(const char* data) {
+         return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+      }
+
+      inline __m128i between_sse2(__m128i block, char low, char high) {
+         return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(low - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(high + 1), block));
+      }
+
+      inline std::uint32_t mask_sse2(__m128i block) {
+         return static_cast<std::uint32_t>(_mm_movemask_epi8(block));
+      }
+
+      std::size_t whitespace_sse2(std::string_view code, std::size_t index, int& line) {
+         for (; index + 16 <= code.size(); index += 16) {
+            auto block = load_sse2(code.data() + index);
+            auto spaces = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), between_sse2(block, '\t', '\r'));
+            auto lines = mask_sse2(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+
+            if (finish(~mask_sse2(spaces) & 0xFFFF, lines, index, line)) {
+               return index;
+            }
+         }
+         return whitespace_scalar(code, index, line);
+      }
+
+      // Bytes above 127 are negative in the signed compares, so they never fall into a range
+      std::size_t identifier_sse2(std::string_view code, std::size_t index) {
+         for (; index + 16 <= code.size(); index += 16) {
+            auto block = load_sse2(code.data() + index);
+            auto letters = between_sse2(_mm_or_si128(block, _mm_set1_epi8(0x20)), 'a', 'z');
+            auto valid = _mm_or_si128(_mm_or_si128(letters, between_sse2(block, '0', '9')), _mm_cmpeq_epi8(block, _mm_set1_epi8('_')));
+
+            if (finish(~mask_sse2(valid) & 0xFFFF, index)) {
+               return index;
+            }
+         }
+         return identifier_scalar(code, index);
+      }
+
+      std::size_t find_sse2(std::string_view code, std::size_t index, char first, char second) {
+         for (; index + 16 <= code.size(); index += 16) {
+            auto block = load_sse2(code.data() + index);
+            auto found = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(first)), _mm_cmpeq_epi8(block, _mm_set1_epi8(second)));
+
+            if (finish(mask_sse2(found), index)) {
+               return index;
+            }
+         }
+         return find_scalar(code, index, first, second);
+      }
+
+      std::size_t block_comment_sse2(std::string_view code, std::size_t index, int& line) {
+         for (; index + 17 <= code.size(); index += 16) {
+            auto block = load_sse2(code.data() + index);
+            auto stars = _mm_cmpeq_epi8(block, _mm_set1_epi8('*'));
+            auto slashes = _mm_cmpeq_epi8(load_sse2(code.data() + index + 1), _mm_set1_epi8('/'));
+            auto lines = mask_sse2(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+
+            if (finish(mask_sse2(_mm_and_si128(stars, slashes)), lines, index, line)) {
+               return index;
+            }
+         }
+         return block_comment_scalar(code, index, line);
+      }
+
+      // AVX2 versions are compiled for AVX2 only and selected after checking the processor
+
+#define CLL_AVX2 __attribute__((target("avx2")))
+
+      CLL_AVX2 inline __m256i load_avx2(const char* data) {
+         return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+      }
+
+      CLL_AVX2 inline __m256i between_avx2(__m256i block, char low, char high) {
+         return _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8(low - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), block));
+      }
+
+      CLL_AVX2 inline std::uint32_t mask_avx2(__m256i block) {
+         return static_cast<std::uint32_t>(_mm256_movemask_epi8(block));
+      }
+
+      CLL_AVX2 std::size_t whitespace_avx2(std::string_view code, std::size_t index, int& line) {
+         for (; index + 32 <= code.size(); index += 32) {
+            auto block = load_avx2(code.data() + index);
+            auto spaces = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')), between_avx2(block, '\t', '\r'));
+            auto lines = mask_avx2(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+
+            if (finish(~mask_avx2(spaces), lines, index, line)) {
+               return index;
+            }
+         }
+         return whitespace_sse2(code, index, line);
+      }
+
+      CLL_AVX2 std::size_t identifier_avx2(std::string_view code, std::size_t index) {
+         for (; index + 32 <= code.size(); index += 32) {
+            auto block = load_avx2(code.data() + index);
+            auto letters = between_avx2(_mm256_or_si256(block, _mm256_set1_epi8(0x20)), 'a', 'z');
+            auto valid = _mm256_or_si256(_mm256_or_si256(letters, between_avx2(block, '0', '9')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_')));
+
+            if (finish(~mask_avx2(valid), index)) {
+               return index;
+            }
+         }
+         return identifier_sse2(code, index);
+      }
+
+      CLL_AVX2 std::size_t find_avx2(std::string_view code, std::size_t index, char first, char second) {
+         for (; index + 32 <= code.size(); index += 32) {
+            auto block = load_avx2(code.data() + index);
+            auto found = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(first)), _mm256_cmpeq_epi8(block, _mm256_set1_epi8(second)));
+
+            if (finish(mask_avx2(found), index)) {
+               return index;
+            }
+         }
+         return find_sse2(code, index, first, second);
+      }
+
+      CLL_AVX2 std::size_t block_comment_avx2(std::string_view code, std::size_t index, int& line) {
+         for (; index + 33 <= code.size(); index += 32) {
+            auto block = load_avx2(code.data() + index);
+            auto stars = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('*'));
+            auto slashes = _mm256_cmpeq_epi8(load_avx2(code.data() + index + 1), _mm256_set1_epi8('/'));
+            auto lines = mask_avx2(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+
+            if (finish(mask_avx2(_mm256_and_si256(stars, slashes)), lines, index, line)) {
+               return index;
+            }
+         }
+         return block_comment_sse2(code, index, line);
+      }
+
+#undef CLL_AVX2
+   }
+#endif
+
+   // Level
+
+   namespace {
+      Level current = best_level();
+   }
+
+   Level best_level() {
+#ifdef CLL_SIMD
+      // The level is chosen during static initialization, possibly before the processor was inspected
+      __builtin_cpu_init();
+      return (__builtin_cpu_supports("avx2") ? Level::avx2 : Level::sse2);
+#else
+      return Level::scalar;
+#endif
+   }
+
+   Level level() {
+      return current;
+   }
+
+   void set_level(Level level) {
+      current = std::min(level, best_level());
+   }
+
+   // Scan functions
+
+   std::size_t whitespace(std::string_view code, std::size_t index, int& line) {
+#ifdef CLL_SIMD
+      switch (current) {
+      case Level::avx2:
+         return whitespace_avx2(code, index, line);
+      case Level::sse2:
+         return whitespace_sse2(code, index, line);
+      default:
+         break;
+      }
+#endif
+      return whitespace_scalar(code, index, line);
+   }
+
+   std::size_t identifier(std::string_view code, std::size_t index) {
+#ifdef CLL_SIMD
+      switch (current) {
+      case Level::avx2:
+         return identifier_avx2(code, index);
+      case Level::sse2:
+         return identifier_sse2(code, index);
+      default:
+         break;
+      }
+#endif
+      return identifier_scalar(code, index);
+   }
+
+   std::size_t find(std::string_view code, std::size_t index, char first, char second) {
+#ifdef CLL_SIMD
+      switch (current) {
+      case Level::avx2:
+         return find_avx2(code, index, first, second);
+      case Level::sse2:
+         return find_sse2(code, index, first, second);
+      default:
+         break;
+      }
+#endif
+      return find_scalar(code, index, first, second);
+   }
+
+   std::size_t block_comment(std::string_view code, std::size_t index, int& line) {
+#ifdef CLL_SIMD
+      switch (current) {
+      case Level::avx2:
+         return block_comment_avx2(code, index, line);
+      case Level::sse2:
+         return block_comment_sse2(code, index, line);
+      default:
+         break;
+      }
+#endif
+      return block_comment_scalar(code, index, line);
+   }
+}
@@ -0,0 +1,337 @@
+#include "server.hpp"
+
+// Includes
+
+#include "fmt.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Signals
+// Interrupting or terminating the server stops it and its workers, which finish the request they are answering. They
+// stay blocked except while waiting, so one arriving between checking whether to stop and waiting is never missed.
+
+static volatile std::sig_atomic_t stopping = 0;
+
+static void stop(int) {
+   stopping = 1;
+}
+
+static void wake(int) {}
+
+// Utility functions
+
+static std::uint64_t elapsed(std::chrono::steady_clock::time_point start) {
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string escape(const std::string& string) {
+   std::string escaped;
+   escaped.reserve(string.size());
+   for (char ch : string) {
+      if (ch == '\\') {
+         escaped += "\\\\";
+      } else if (ch == '\n') {
+         escaped += "\\n";
+      } else {
+         escaped += ch;
+      }
+   }
+   return escaped;
+}
+
+static bool write_all(int descriptor, const char* data, size_t size) {
+   while (size) {
+      ssize_t written = write(descriptor, data, size);
+      if (written < 0 && errno == EINTR) {
+         continue;
+      } else if (written <= 0) {
+         return false;
+      }
+      data += written;
+      size -= written;
+   }
+   return true;
+}
+
+// Waits for a descriptor to be readable, false once stopped
+static bool wait_readable(int descriptor, const sigset_t& unblocked) {
+   pollfd readable {descriptor, POLLIN, 0};
+   while (!stopping) {
+      if (ppoll(&readable, 1, nullptr, &unblocked) > 0) {
+         return true;
+      }
+   }
+   return false;
+}
+
+// Requests
+
+// Arguments are literals, so a request cannot evaluate anything but the call it names
+static Value to_argument(const Stmt& expr) {
+   switch (expr->type) {
+   case StmtType::number:
+      return NumberValue::make(get_stmt<NumberLiteral>(expr).number, expr->line);
+   case StmtType::character:
+      return CharValue::make(get_stmt<CharLiteral>(expr).ch, expr->line);
+   case StmtType::string:
+      return StringValue::make(get_stmt<StringLiteral>(expr).string, expr->line);
+   case StmtType::null:
+      return NullValue::make(expr->line);
+   case StmtType::array: {
+      std::vector<Value> array;
+      for (const auto& element : get_stmt<ArrayLiteral>(expr).array) {
+         array.push_back(to_argument(element));
+      }
+      return Array::make(std::move(array), expr->line);
+   }
+   case StmtType::identifier: {
+      const auto& identifier = get_stmt<IdentLiteral>(expr).identifier;
+      if (identifier == "true" || identifier == "false") {
+         return BoolValue::make(identifier == "true", expr->line);
+      } else if (identifier == "null") {
+         return NullValue::make(expr->line);
+      }
+      break;
+   }
+   case StmtType::unary: {
+      const auto& unary = get_stmt<UnaryExpr>(expr);
+      if (unary.op == Type::minus && unary.value->type == StmtType::number) {
+         return NumberValue::make(-get_stmt<NumberLiteral>(unary.value).number, expr->line);
+      }
+      break;
+   }
+   default:
+      break;
+   }
+   fmt::raise(expr->line, "Expected the arguments of a request to be literals, got '{}' instead.", stmt_type_str[int(expr->type)]);
+}
+
+static std::string answer(const std::string& request, Interpreter& interpreter, Environment& global) {
+   try {
+      interpreter.restart_budget();
+      err::set_program_code(request);
+      Lexer lexer (request);
+      Parser parser (lexer.lex());
+      auto& program = parser.parse();
+      fmt::raise_if(1, program.statements.size() != 1 || program.statements.front()->type != StmtType::call, "Expected a request to be a single function call.");
+
+      const auto& call = get_stmt<CallExpr>(program.statements.front());
+      fmt::raise_if(call.line, call.identifier->type != StmtType::identifier, "Expected a request to call a function by its name.");
+      const auto& name = get_stmt<IdentLiteral>(call.identifier).identifier;
+      fmt::raise_if(call.line, !global.variable_exists(name), "Function '{}' is not declared by the prelude.", name);
+
+      auto function = global.get_variable(name, call.line);
+      fmt::raise_if(call.line, function->type != ValueType::fn, "Expected '{}' to be a function declared by the prelude, got '{}' instead.", name, value_type_str[int(function->type)]);
+
+      std::vector<Value> args;
+      for (const auto& arg : get_stmt<ArgsListExpr>(call.args).args) {
+         args.push_back(to_argument(arg));
+      }
+      auto result = interpreter.call_function(global, std::move(function), args, call.line);
+      return "ok " + escape(result ? result->as_string() : "null");
+   } catch (const err::Error& error) {
+      interpreter.unwind({});
+      return "error " + escape(error.message);
+   } catch (const err::Exit& exit) {
+      interpreter.unwind({});
+      return "error " + escape(fmt::format("Program exited with exit code {}.", exit.code));
+   }
+}
+
+// Workers
+
+// Answers the requests of a connection until the client closes it or the worker is stopped
+static void serve_connection(int connection, const sigset_t& unblocked, Interpreter& interpreter, Environment& global, std::vector<std::uint64_t>& latencies) {
+   std::string buffer;
+   char data[4096];
+
+   while (!stopping) {
+      auto newline = buffer.find('\n');
+      if (newline == std::string::npos) {
+         if (!wait_readable(connection, unblocked)) {
+            return;
+         }
+         ssize_t size = read(connection, data, sizeof(data));
+         if (size <= 0) {
+            return;
+         }
+         buffer.append(data, size);
+         continue;
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      auto request = buffer.substr(0, (newline && buffer[newline - 1] == '\r' ? newline - 1 : newline));
+      buffer.erase(0, newline + 1);
+
+      auto response = answer(request, interpreter, global) + '\n';
+      std::cout.flush();
+      if (!write_all(connection, response.data(), response.size())) {
+         return;
+      }
+      latencies.push_back(elapsed(start));
+   }
+}
+
+// Every worker is woken by a new connection, the listener does not block so those not accepting it wait again. Once
+// stopped, the latencies of the requests answered are reported to the server through a pipe.
+static void work(int listener, int report, const sigset_t& unblocked, Interpreter& interpreter, Environment& global) {
+   std::vector<std::uint64_t> latencies;
+   while (wait_readable(listener, unblocked)) {
+      int connection = accept(listener, nullptr, nullptr);
+      if (connection < 0) {
+         continue;
+      }
+      serve_connection(connection, unblocked, interpreter, global, latencies);
+      close(connection);
+   }
+
+   std::cout.flush();
+   write_all(report, reinterpret_cast<const char*>(latencies.data()), latencies.size() * sizeof(std::uint64_t));
+   close(report);
+}
+
+// Reads what a worker reported until it exits, which is nothing if it crashed
+static void collect(int report, std::vector<std::uint64_t>& latencies) {
+   std::string data;
+   char buffer[4096];
+   for (ssize_t size; (size = read(report, buffer, sizeof(buffer))) != 0;) {
+      if (size < 0 && errno == EINTR) {
+         continue;
+      } else if (size < 0) {
+         break;
+      }
+      data.append(buffer, size);
+   }
+   close(report);
+
+   auto start = latencies.size();
+   latencies.resize(start + data.size() / sizeof(std::uint64_t));
+   std::memcpy(latencies.data() + start, data.data(), (latencies.size() - start) * sizeof(std::uint64_t));
+}
+
+static void print_latencies(std::vector<std::uint64_t>& latencies) {
+   if (latencies.empty()) {
+      std::cerr << "Served no requests.\n";
+      return;
+   }
+
+   std::sort(latencies.begin(), latencies.end());
+   auto percentile = [&latencies](double rank) {
+      auto index = std::min(latencies.size() - 1, size_t(std::ceil(rank * latencies.size())) - 1);
+      return std::round(latencies[index] / 1e2) / 10;
+   };
+   std::cerr << fmt::format("Served {} requests, latency p50 {} us, p90 {} us, p99 {} us, p99.9 {} us, max {} us.", latencies.size(), percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), percentile(1)) << '\n';
+}
+
+// Server functions
+
+namespace srv {
+   int serve(const std::string& socket, unsigned workers, Interpreter& interpreter, Environment& global) {
+      sockaddr_un address {};
+      address.sun_family = AF_UNIX;
+      fmt::raise_if(err::nline, socket.size() >= sizeof(address.sun_path), "Socket path '{}' is too long.", socket);
+      std::memcpy(address.sun_path, socket.c_str(), socket.size() + 1);
+
+      // A socket left by a server that did not stop cleanly is replaced, any other file is not
+      struct stat status;
+      if (stat(socket.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+         unlink(socket.c_str());
+      }
+
+      int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      bool listening = listener >= 0 && bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 && listen(listener, SOMAXCONN) == 0;
+      fmt::raise_if(err::nline, !listening, "Cannot listen on socket '{}': {}.", socket, std::strerror(errno));
+
+      fcntl(listener, F_SETFL, O_NONBLOCK);
+
+      struct sigaction action {};
+      action.sa_handler = stop;
+      sigaction(SIGINT, &action, nullptr);
+      sigaction(SIGTERM, &action, nullptr);
+      action.sa_handler = wake;
+      sigaction(SIGCHLD, &action, nullptr);
+      std::signal(SIGPIPE, SIG_IGN);
+
+      sigset_t blocked, unblocked;
+      sigemptyset(&blocked);
+      sigaddset(&blocked, SIGINT);
+      sigaddset(&blocked, SIGTERM);
+      sigaddset(&blocked, SIGCHLD);
+      sigprocmask(SIG_BLOCK, &blocked, &unblocked);
+
+      struct Worker {
+         pid_t pid;
+         int report;
+      };
+
+      auto spawn = [&]() -> Worker {
+         int pipes[2];
+         fmt::raise_if(err::nline, pipe(pipes) != 0, "Cannot create a pipe for a worker: {}.", std::strerror(errno));
+         std::cout.flush();
+
+         pid_t pid = fork();
+         fmt::raise_if(err::nline, pid < 0, "Cannot fork a worker: {}.", std::strerror(errno));
+         if (pid == 0) {
+            close(pipes[0]);
+            try {
+               work(listener, pipes[1], unblocked, interpreter, global);
+            } catch (...) {
+               _exit(1);
+            }
+            _exit(0);
+         }
+         close(pipes[1]);
+         return {pid, pipes[0]};
+      };
+
+      std::vector<Worker> pool;
+      std::vector<std::uint64_t> latencies;
+      for (unsigned i = 0; i < workers; ++i) {
+         pool.push_back(spawn());
+      }
+      std::cerr << fmt::format("Serving '{}' with {} workers.", socket, workers) << '\n';
+
+      // Workers only exit on their own when they crash, and are replaced
+      while (!stopping) {
+         for (pid_t pid; (pid = waitpid(-1, nullptr, WNOHANG)) > 0;) {
+            auto worker = std::find_if(pool.begin(), pool.end(), [pid](const Worker& worker) { return worker.pid == pid; });
+            if (worker != pool.end()) {
+               collect(worker->report, latencies);
+               *worker = spawn();
+            }
+         }
+         if (!stopping) {
+            sigsuspend(&unblocked);
+         }
+      }
+
+      for (const auto& worker : pool) {
+         kill(worker.pid, SIGTERM);
+      }
+      for (const auto& worker : pool) {
+         collect(worker.report, latencies);
+         waitpid(worker.pid, nullptr, 0);
+      }
+      close(listener);
+      unlink(socket.c_str());
+      sigprocmask(SIG_SETMASK, &unblocked, nullptr);
+
+      print_latencies(latencies);
+      return 0;
+   }
+}
@@ -0,0 +1,332 @@
+#include "snapshot.hpp"
+
+// Includes
+
+#include "cache.hpp"
+#include "file.hpp"
+#include "fmt.hpp"
+#include "functions.hpp"
+#include "interpreter.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unistd.h>
+
+#ifndef CLL_VERSION
+#define CLL_VERSION "unknown"
+#endif
+
+// Static variables
+
+// Changes to the layout of the file or of the syntax tree in the parse cache need a new format number
+static constexpr auto snapshot_magic = "cll-snap";
+static constexpr auto snapshot_version = CLL_VERSION " snapshot 2";
+
+// Snapshots
+
+namespace snap {
+   namespace {
+      // Numbers are written in the byte order of the machine, snapshots are restored where they were taken
+
+      class Writer {
+         std::string& data;
+
+      public:
+         Writer(std::string& data)
+            : data(data) {}
+
+         template<typename T>
+         void raw(const T& value) {
+            data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+         }
+
+         // x87 long doubles leave their padding unset, it is written as zeros so equal values write equal snapshots
+         void raw(long double value) {
+            char bytes[sizeof(long double)] {};
+            std::memcpy(bytes, &value, (std::numeric_limits<long double>::digits == 64 ? 10 : sizeof(long double)));
+            data.append(bytes, sizeof(bytes));
+         }
+
+         void number(std::uint64_t value) {
+            raw(value);
+         }
+
+         void string(std::string_view string) {
+            number(string.size());
+            data += string;
+         }
+
+         void annotation(const Annotation& annotation) {
+            data += char(annotation.type);
+            data += char(annotation.element);
+         }
+
+         void value(const Value& value, const std::string& name, int line);
+      };
+
+      class Reader {
+         std::string_view data;
+         std::size_t at = 0;
+         const std::string& file;
+         std::string_view code;
+         const Importer* import;
+
+         void need(std::size_t size) {
+            fmt::raise_if(err::nline, data.size() - at < size, "Snapshot '{}' is damaged.", file);
+         }
+
+      public:
+         Reader(std::string_view data, const std::string& file, std::string_view code = {}, const Importer* import = nullptr)
+            : data(data), file(file), code(code), import(import) {}
+
+         template<typename T>
+         T raw() {
+            need(sizeof(T));
+            T value;
+            std::memcpy(&value, data.data() + at, sizeof(T));
+            at += sizeof(T);
+            return value;
+         }
+
+         std::uint64_t number() {
+            return raw<std::uint64_t>();
+         }
+
+         std::string_view string() {
+            auto size = number();
+            need(size);
+            auto string = data.substr(at, size);
+            at += size;
+            return string;
+         }
+
+         Annotation annotation() {
+            Annotation annotation;
+            annotation.type = StaticType(raw<char>());
+            annotation.element = StaticType(raw<char>());
+            return annotation;
+         }
+
+         Value value(Environment& global);
+
+         // Reads the header, then the variables follow
+         Point header() {
+            need(8);
+            fmt::raise_if(err::nline, std::memcmp(data.data(), snapshot_magic, 8) != 0, "'{}' is not a snapshot.", file);
+            at = 8;
+            fmt::raise_if(err::nline, string() != snapshot_version, "Snapshot '{}' was taken by another version of the interpreter.", file);
+
+            Point point;
+            point.script = std::string(string());
+            point.hash = number();
+            point.statement = number();
+            return point;
+         }
+      };
+
+      // Values start with their type, the fields follow in the order of their declaration
+
+      void Writer::value(const Value& value, const std::string& name, int line) {
+         data += char(value->type);
+
+         switch (value->type) {
+         case ValueType::null:
+            break;
+         case ValueType::boolean:
+            data += char(get_value<BoolValue>(value).value);
+            break;
+         case ValueType::number:
+            raw(get_value<NumberValue>(value).number);
+            break;
+         case ValueType::character:
+            data += get_value<CharValue>(value).ch;
+            break;
+         case ValueType::string:
+            string(get_value<StringValue>(value).string);
+            break;
+         case ValueType::array: {
+            const auto& array = get_value<Array>(value).array;
+            number(array.size());
+            for (const auto& element : array) {
+               this->value(element, name, line);
+            }
+            break;
+         }
+         case ValueType::error: {
+            const auto& error = get_value<ErrorValue>(value);
+            string(error.message);
+            raw(error.error_line);
+            raw(error.code);
+            break;
+         }
+         case ValueType::native_fn: {
+            const auto& native = get_value<NativeFn>(value);
+            fmt::raise_if(line, !fun::find_builtin(native.identifier), "Cannot checkpoint '{}', as host function '{}' cannot be stored.", name, native.identifier);
+            string(native.identifier);
+            break;
+         }
+         case ValueType::fn: {
+            const auto& fn = get_value<Function>(value);
+            fmt::raise_if(line, !fn.source.file.empty(), "Cannot checkpoint '{}', as function '{}' was declared in module '{}'.", name, fn.identifier, fn.source.file);
+            fmt::raise_if(line, fn.captured || !fn.weak_captured.expired(), "Cannot checkpoint '{}', as function '{}' captured variables of the scope it was declared in.", name, fn.identifier);
+
+            string(fn.identifier);
+            number(fn.parameters.size());
+            for (size_t i = 0; i < fn.parameters.size(); ++i) {
+               string(fn.parameters.at(i));
+               annotation(fn.parameter_types.at(i));
+            }
+            number(fn.parameter_def.size());
+            for (const auto& def : fn.parameter_def) {
+               this->value(def, name, line);
+            }
+            string(fn.returns);
+            this->value(fn.return_def, name, line);
+            annotation(fn.returns_type);
+            annotation(fn.return_type);
+            raw(fn.def_args);
+            raw(fn.line);
+
+            // Lazily parsed bodies are parsed whole, as functions declared in them are lazy as well
+            auto parsed = (fn.body->type == StmtType::lazy ? Interpreter::parse_body(fn) : nullptr);
+            fmt::raise_if(line, !cache::write_stmt(data, (parsed ? parsed : fn.body)), "Cannot checkpoint '{}', as the body of function '{}' cannot be stored.", name, fn.identifier);
+            break;
+         }
+         case ValueType::module: {
+            const auto& module = get_value<ModuleValue>(value);
+            fmt::raise_if(line, module.path.empty(), "Cannot checkpoint '{}', as module '{}' was not imported from a file.", name, module.identifier);
+            string(module.identifier);
+            string(module.path);
+            break;
+         }
+         default:
+            fmt::raise(line, "Cannot checkpoint '{}', as values of type '{}' cannot be stored.", name, value_type_str[int(value->type)]);
+         }
+      }
+
+      Value Reader::value(Environment& global) {
+         auto type = ValueType(raw<char>());
+
+         switch (type) {
+         case ValueType::null:
+            return NullValue::make(err::nline);
+         case ValueType::boolean:
+            return BoolValue::make(raw<char>() != 0, err::nline);
+         case ValueType::number:
+            return NumberValue::make(raw<long double>(), err::nline);
+         case ValueType::character:
+            return CharValue::make(raw<char>(), err::nline);
+         case ValueType::string:
+            return StringValue::make(std::string(string()), err::nline);
+         case ValueType::array: {
+            // Every value takes at least a byte, larger counts can only come from a damaged file
+            auto size = number();
+            need(size);
+            std::vector<Value> array (size);
+            for (auto& element : array) {
+               element = value(global);
+            }
+            return Array::make(std::move(array), err::nline);
+         }
+         case ValueType::error: {
+            auto message = std::string(string());
+            auto error_line = raw<int>();
+            return ErrorValue::make(message, error_line, raw<int>(), err::nline);
+         }
+         case ValueType::native_fn: {
+            auto builtin = fun::find_builtin(string());
+            fmt::raise_if(err::nline, !builtin || !builtin->call, "Snapshot '{}' is damaged.", file);
+            return fun::make_builtin(*builtin);
+         }
+         case ValueType::fn: {
+            auto identifier = std::string(string());
+            std::vector<std::string> parameters (number());
+            std::vector<Annotation> parameter_types;
+            for (auto& parameter : parameters) {
+               parameter = std::string(string());
+               parameter_types.push_back(annotation());
+            }
+            std::vector<Value> parameter_def (number());
+            for (auto& def : parameter_def) {
+               def = value(global);
+            }
+            auto returns = std::string(string());
+            auto return_def = value(global);
+            auto returns_type = annotation();
+            auto return_type = annotation();
+            auto def_args = raw<int>();
+            auto line = raw<int>();
+
+            auto body = cache::read_stmt(data, at);
+            fmt::raise_if(err::nline, !body || body->type != StmtType::program, "Snapshot '{}' is damaged.", file);
+
+            auto fn = Function::make(identifier, parameters, std::move(parameter_def), parameter_types, returns, std::move(return_def), returns_type, return_type, &global, std::move(body), def_args, line);
+            get_value<Function>(fn).source = {code, {}};
+            return fn;
+         }
+         case ValueType::module: {
+            auto identifier = std::string(string());
+            auto path = std::string(string());
+            fmt::raise_if(err::nline, !import, "Snapshot '{}' is damaged.", file);
+            return (*import)(identifier, path);
+         }
+         default:
+            fmt::raise(err::nline, "Snapshot '{}' is damaged.", file);
+         }
+      }
+   }
+
+   void save(const std::string& file, const Point& point, const Environment& global, int line) {
+      std::string data;
+      Writer writer (data);
+      data.append(snapshot_magic, 8);
+      writer.string(snapshot_version);
+      writer.string(point.script);
+      writer.number(point.hash);
+      writer.number(point.statement);
+
+      std::uint64_t count = 0;
+      auto count_at = data.size();
+      writer.number(count);
+      global.each_variable([&](const std::string& identifier, const Value& value, bool constant, const Annotation& annotation) {
+         writer.string(identifier);
+         data += char(constant);
+         writer.annotation(annotation);
+         writer.value(value, identifier, line);
+         ++count;
+      });
+      std::memcpy(data.data() + count_at, &count, sizeof(count));
+
+      auto temporary = fmt::format("{}.{}", file, getpid());
+      {
+         std::ofstream fbuf (temporary, std::ios::binary);
+         fmt::raise_if(line, !fbuf.write(data.data(), data.size()) || !fbuf.flush(), "Cannot write snapshot '{}'.", file);
+      }
+      std::error_code error;
+      std::filesystem::rename(temporary, file, error);
+      if (error) {
+         std::filesystem::remove(temporary, error);
+         fmt::raise(line, "Cannot write snapshot '{}'.", file);
+      }
+   }
+
+   Point point(const std::string& file) {
+      fmt::raise_if(err::nline, !file::exists(file), "Cannot restore '{}' as the file does not exist.", file);
+      file::Mapping mapping (file);
+      return Reader(mapping.view(), file).header();
+   }
+
+   void restore(const std::string& file, Environment& global, std::string_view code, const Importer& import) {
+      file::Mapping mapping (file);
+      Reader reader (mapping.view(), file, code, &import);
+      reader.header();
+
+      for (auto count = reader.number(); count > 0; --count) {
+         auto identifier = std::string(reader.string());
+         bool constant = reader.raw<char>() != 0;
+         auto annotation = reader.annotation();
+         global.declare_variable(identifier, reader.value(global), constant, err::nline, annotation);
+      }
+   }
+}
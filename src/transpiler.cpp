@@ -0,0 +1,1165 @@
+#include "transpiler.hpp"
+
+// Includes
+
+#include "fmt.hpp"
+#include <algorithm>
+#include <cstdio>
+
+// Utility functions
+
+// Functions of fun::builtins and their C++ names
+static const std::vector<std::pair<std::string, std::string>> natives {
+   {"print", "fun::print"}, {"println", "fun::println"}, {"printf", "fun::printf"}, {"printfln", "fun::printfln"}, {"format", "fun::format"},
+   {"raise", "fun::raise"}, {"assert", "fun::assert"}, {"throw", "fun::throw_"}, {"exit", "fun::exit"},
+   {"input", "fun::input"}, {"inputnum", "fun::inputnum"}, {"inputch", "fun::inputch"},
+   {"string", "fun::string"}, {"number", "fun::number"}, {"char", "fun::char_"}, {"bool", "fun::bool_"}
+};
+
+static constexpr const char* static_type_names[] {
+   "unknown", "dynamic", "null", "number", "character", "string", "boolean", "array", "function"
+};
+
+static std::string str(int line) {
+   return std::to_string(line);
+}
+
+static std::string native(const std::string& identifier) {
+   for (const auto& [name, function] : natives) {
+      if (name == identifier) {
+         return function;
+      }
+   }
+   return ""s;
+}
+
+static std::string op_name(Type op) {
+   switch (op) {
+   case Type::increment:         return "Type::increment"s;
+   case Type::decrement:         return "Type::decrement"s;
+   case Type::plus_eq:           return "Type::plus_eq"s;
+   case Type::minus_eq:          return "Type::minus_eq"s;
+   case Type::multiply_eq:       return "Type::multiply_eq"s;
+   case Type::divide_eq:         return "Type::divide_eq"s;
+   case Type::remainder_eq:      return "Type::remainder_eq"s;
+   case Type::exponentiate_eq:   return "Type::exponentiate_eq"s;
+   case Type::plus:              return "Type::plus"s;
+   case Type::minus:             return "Type::minus"s;
+   case Type::multiply:          return "Type::multiply"s;
+   case Type::divide:            return "Type::divide"s;
+   case Type::remainder:         return "Type::remainder"s;
+   case Type::exponentiate:      return "Type::exponentiate"s;
+   case Type::log_not:           return "Type::log_not"s;
+   case Type::divisible:         return "Type::divisible"s;
+   case Type::equals:            return "Type::equals"s;
+   case Type::really_equals:     return "Type::really_equals"s;
+   case Type::not_equals:        return "Type::not_equals"s;
+   case Type::really_not_equals: return "Type::really_not_equals"s;
+   case Type::greater:           return "Type::greater"s;
+   case Type::greater_equal:     return "Type::greater_equal"s;
+   case Type::smaller:           return "Type::smaller"s;
+   case Type::smaller_equal:     return "Type::smaller_equal"s;
+   default:                      return "Type(" + std::to_string(int(op)) + ")";
+   }
+}
+
+static std::string quote(const std::string& string) {
+   std::string result = "\"";
+   for (unsigned char ch : string) {
+      if (ch == '"' || ch == '\\') {
+         result += '\\';
+         result += ch;
+      } else if (ch == '\n') {
+         result += "\\n";
+      } else if (ch < 32 || ch >= 127) {
+         char buffer[8];
+         std::snprintf(buffer, sizeof(buffer), "\\%03o", ch);
+         result += buffer;
+      } else {
+         result += ch;
+      }
+   }
+   return result + '"';
+}
+
+// Hexadecimal literals keep every bit of the parsed number
+static std::string literal(long double number) {
+   char buffer[64];
+   std::snprintf(buffer, sizeof(buffer), "%LaL", number);
+   return buffer;
+}
+
+static bool is_expression(const Stmt& stmt) {
+   switch (stmt->type) {
+   case StmtType::assignment:
+   case StmtType::ternary:
+   case StmtType::binary:
+   case StmtType::unary:
+   case StmtType::member:
+   case StmtType::property:
+   case StmtType::call:
+   case StmtType::exists:
+   case StmtType::identifier:
+   case StmtType::number:
+   case StmtType::character:
+   case StmtType::string:
+   case StmtType::array:
+   case StmtType::null:
+      return true;
+   default:
+      return false;
+   }
+}
+
+// Expressions the interpreter evaluates unboxed when they are proven to be numbers
+static bool is_numeric(const Stmt& stmt) {
+   if (stmt->static_type != StaticType::number) {
+      return false;
+   }
+
+   switch (stmt->type) {
+   case StmtType::number:
+   case StmtType::identifier:
+      return true;
+   case StmtType::assignment:
+      return get_stmt<AssignmentExpr>(stmt).left->type == StmtType::identifier;
+   case StmtType::binary:
+      return is_arithmetic(get_stmt<BinaryExpr>(stmt).op);
+   case StmtType::unary:
+      return get_stmt<UnaryExpr>(stmt).op != Type::log_not;
+   default:
+      return false;
+   }
+}
+
+// C++ expression raising the interpreter's error for an undeclared variable
+static std::string missing(const std::string& identifier, int line) {
+   return "fmt::raise(" + str(line) + ", \"Variable '{}' does not exist in the given scope.\", \"" + identifier + "\")";
+}
+
+static std::vector<const Stmt*> children(const Stmt& stmt) {
+   std::vector<const Stmt*> result;
+   auto add = [&](const Stmt& child) {
+      if (child) {
+         result.push_back(&child);
+      }
+   };
+   auto add_all = [&](const std::vector<Stmt>& statements) {
+      for (const auto& child : statements) {
+         add(child);
+      }
+   };
+
+   switch (stmt->type) {
+   case StmtType::var_decl:
+      add_all(get_stmt<VarDeclaration>(stmt).values);
+      break;
+   case StmtType::fn_decl: {
+      auto& decl = get_stmt<FnDeclaration>(stmt);
+      add_all(decl.argument_def);
+      add(decl.return_def);
+      add(decl.body);
+      break;
+   }
+   case StmtType::ifelse: {
+      auto& ifelse = get_stmt<IfElseStmt>(stmt);
+      add(ifelse.ifclause);
+      add_all(ifelse.elifclauses);
+      if (ifelse.elseclause.has_value()) {
+         add(ifelse.elseclause.value());
+      }
+      break;
+   }
+   case StmtType::if_clause:
+      add(get_stmt<IfClauseStmt>(stmt).expr);
+      add(get_stmt<IfClauseStmt>(stmt).stmt);
+      break;
+   case StmtType::while_loop:
+      add(get_stmt<WhileStmt>(stmt).expr);
+      add(get_stmt<WhileStmt>(stmt).stmt);
+      break;
+   case StmtType::for_loop: {
+      auto& for_stmt = get_stmt<ForStmt>(stmt);
+      for (const auto* child : {&for_stmt.initexpr, &for_stmt.condition, &for_stmt.loopexpr}) {
+         if (child->has_value()) {
+            add(child->value());
+         }
+      }
+      add(for_stmt.stmt);
+      break;
+   }
+   case StmtType::return_stmt:
+      add(get_stmt<ReturnStmt>(stmt).value);
+      break;
+   case StmtType::unless_stmt:
+      add(get_stmt<UnlessStmt>(stmt).expr);
+      add(get_stmt<UnlessStmt>(stmt).stmt);
+      break;
+   case StmtType::assignment:
+      add(get_stmt<AssignmentExpr>(stmt).left);
+      add(get_stmt<AssignmentExpr>(stmt).right);
+      break;
+   case StmtType::ternary:
+      add(get_stmt<TernaryExpr>(stmt).left);
+      add(get_stmt<TernaryExpr>(stmt).middle);
+      add(get_stmt<TernaryExpr>(stmt).right);
+      break;
+   case StmtType::binary:
+      add(get_stmt<BinaryExpr>(stmt).left);
+      add(get_stmt<BinaryExpr>(stmt).right);
+      break;
+   case StmtType::unary:
+      add(get_stmt<UnaryExpr>(stmt).value);
+      break;
+   case StmtType::member:
+      add(get_stmt<MemberAccess>(stmt).left);
+      add(get_stmt<MemberAccess>(stmt).key);
+      break;
+   case StmtType::property:
+      add(get_stmt<PropertyAccess>(stmt).left);
+      add_all(get_stmt<PropertyAccess>(stmt).right);
+      break;
+   case StmtType::call:
+      add(get_stmt<CallExpr>(stmt).args);
+      add(get_stmt<CallExpr>(stmt).identifier);
+      break;
+   case StmtType::args:
+      add_all(get_stmt<ArgsListExpr>(stmt).args);
+      break;
+   case StmtType::array:
+      add_all(get_stmt<ArrayLiteral>(stmt).array);
+      break;
+   case StmtType::program:
+      add_all(get_stmt<Program>(stmt).statements);
+      break;
+   default:
+      break;
+   }
+   return result;
+}
+
+// Transpile functions
+
+Transpiler::Transpiler(std::string_view code)
+   : code(code) {}
+
+std::string Transpiler::transpile(const Program& program) {
+   scopes.assign(1, {});
+   globals.push_back("rt::Slot g_null {NullValue::make(err::nline), nullptr, true};"s);
+   globals.push_back("rt::Slot g_true {BoolValue::make(true, err::nline), nullptr, true};"s);
+   globals.push_back("rt::Slot g_false {BoolValue::make(false, err::nline), nullptr, true};"s);
+   for (const auto& name : {"null"s, "true"s, "false"s}) {
+      scopes.front().bound[name] = "g_" + name;
+   }
+
+   for (const auto& [name, function] : natives) {
+      globals.push_back("rt::Slot g_" + name + " {NativeFn::make(" + function + ", \"" + name + "\"s, err::nline), nullptr, true};");
+      scopes.front().bound[name] = "g_" + name;
+   }
+
+   // Every variable of the global scope exists for the whole program, functions look them up when they are called
+   std::vector<std::pair<std::string, bool>> identifiers;
+   for (const auto& stmt : program.statements) {
+      collect(stmt, identifiers);
+   }
+
+   std::unordered_map<std::string, int> declarations;
+   std::unordered_set<std::string> variables;
+   for (const auto& [identifier, is_fn] : identifiers) {
+      if (scopes.front().bound.find(identifier) == scopes.front().bound.end()) {
+         scopes.front().bound[identifier] = "g_" + identifier;
+         globals.push_back("rt::Slot g_" + identifier + ";");
+      }
+
+      if (is_fn) {
+         ++declarations[identifier];
+      } else {
+         variables.insert(identifier);
+      }
+   }
+
+   // Functions declared once and never replaced are called directly
+   for (const auto& stmt : program.statements) {
+      std::vector<const Stmt*> pending {&stmt};
+      while (!pending.empty()) {
+         auto& current = *pending.back();
+         pending.pop_back();
+
+         if (current->type == StmtType::fn_decl) {
+            if (get_stmt<FnDeclaration>(current).identifier->type != StmtType::identifier) {
+               unsupported(current->line, "anonymous functions");
+            }
+            auto& identifier = get_stmt<IdentLiteral>(get_stmt<FnDeclaration>(current).identifier).identifier;
+            function_names[current.get()] = unique("fn", identifier);
+            if (declarations[identifier] == 1 && variables.find(identifier) == variables.end() && native(identifier).empty()) {
+               functions[identifier] = function_names[current.get()];
+            }
+            continue;
+         } else if (current->type == StmtType::program || current->type == StmtType::for_loop) {
+            continue;
+         }
+
+         for (const auto* child : children(current)) {
+            pending.push_back(child);
+         }
+      }
+   }
+
+   // Inside the try statement of main()
+   depth = 2;
+   generate_statements(program.statements, ""s);
+
+   // Main function is called after the program, like in the interpreter
+   if (auto it = functions.find("main"s); it != functions.end()) {
+      emit("if (g_main.value) {"s);
+      emit("   std::vector<Value> args;"s);
+      emit("   " + it->second + "(args, nullptr, err::nline);");
+      emit("}"s);
+   }
+   emit("return 0;"s);
+
+   std::ostringstream result;
+   result << "// Generated by 'cll --emit-cpp', build with the runtime library:\n";
+   result << "// c++ -std=c++17 -O2 -I<cll>/include program.cpp <cll>/build/libcll_runtime.a\n\n";
+   result << "#include \"runtime.hpp\"\n\n";
+   result << "using namespace std::string_literals;\n\n";
+   result << "namespace {\n";
+
+   result << "   // Annotations\n\n";
+   for (const auto& [types, name] : annotations) {
+      result << "   const Annotation " << name << " {StaticType::" << static_type_names[int(types.first)] << ", StaticType::" << static_type_names[int(types.second)] << "};\n";
+   }
+
+   result << "\n   // Globals\n\n";
+   for (const auto& global : globals) {
+      result << "   " << global << '\n';
+   }
+
+   result << "\n   // Functions\n\n";
+   std::vector<std::string> prototypes;
+   for (const auto& [stmt, name] : function_names) {
+      prototypes.push_back(name);
+   }
+
+   std::sort(prototypes.begin(), prototypes.end());
+   for (const auto& name : prototypes) {
+      result << "   Value " << name << "(std::vector<Value>& args, Environment* env, int line);\n";
+   }
+
+   for (const auto& definition : definitions) {
+      result << '\n' << definition;
+   }
+   result << "}\n\n";
+
+   result << "// Main program entry point, errors and exit() end the program like they do in the interpreter\n\n";
+   result << "int main() {\n";
+   result << "   std::string code = " << quote(code) << ";\n";
+   result << "   err::set_program_code(code);\n\n";
+   result << "   try {\n";
+   result << out.str();
+   result << "   } catch (const err::Error& error) {\n";
+   result << "      err::report(error);\n";
+   result << "   } catch (const err::Exit& exit) {\n";
+   result << "      err::report(exit);\n";
+   result << "   }\n";
+   result << "}\n";
+   return result.str();
+}
+
+// Statement generation functions
+
+void Transpiler::generate_stmt(const Stmt& stmt, const std::string& target) {
+   if (stmt->type != StmtType::for_loop && stmt->type != StmtType::program) {
+      declare_slots(stmt);
+   }
+
+   switch (stmt->type) {
+   case StmtType::var_decl:
+      generate_var_decl(get_stmt<VarDeclaration>(stmt), target);
+      break;
+   case StmtType::fn_decl: {
+      auto code = generate_fn_decl(get_stmt<FnDeclaration>(stmt));
+      emit(code);
+      if (!target.empty()) {
+         emit(target + " = NullValue::make(" + str(stmt->line) + ");");
+      }
+      break;
+   }
+   case StmtType::del:
+      for (const auto& identifier : get_stmt<DeleteStmt>(stmt).identifiers) {
+         auto& name = get_stmt<IdentLiteral>(identifier).identifier;
+         auto cpp = slot(name);
+         if (cpp.empty()) {
+            emit(missing(name, stmt->line) + ";");
+            continue;
+         }
+
+         for (size_t i = 0; i + 1 < scopes.size(); ++i) {
+            if (scopes.at(i).bound.find(name) != scopes.at(i).bound.end() && scopes.at(i).bound.at(name) != cpp) {
+               unsupported(stmt->line, "deleting '" + name + "', which shadows another variable");
+            }
+         }
+         emit("rt::remove(" + cpp + ", \"" + name + "\", " + str(stmt->line) + ");");
+      }
+
+      if (!target.empty()) {
+         emit(target + " = NullValue::make(" + str(stmt->line) + ");");
+      }
+      break;
+   case StmtType::ifelse:
+      generate_if_else(get_stmt<IfElseStmt>(stmt), target);
+      break;
+   case StmtType::while_loop:
+      generate_while_loop(get_stmt<WhileStmt>(stmt), target);
+      break;
+   case StmtType::for_loop:
+      generate_for_loop(get_stmt<ForStmt>(stmt), target);
+      break;
+   case StmtType::break_stmt:
+   case StmtType::continue_stmt:
+      generate_jump(stmt);
+      break;
+   case StmtType::return_stmt:
+      generate_return(get_stmt<ReturnStmt>(stmt));
+      break;
+   case StmtType::unless_stmt: {
+      auto& unless = get_stmt<UnlessStmt>(stmt);
+      emit("if (!" + condition(unless.expr) + ") {");
+      ++depth;
+      generate_stmt(unless.stmt, target);
+      --depth;
+
+      if (!target.empty()) {
+         emit("} else {"s);
+         emit("   " + target + " = NullValue::make(" + str(unless.line) + ");");
+      }
+      emit("}"s);
+      break;
+   }
+   case StmtType::program:
+      generate_block(get_stmt<Program>(stmt), target);
+      break;
+   case StmtType::import_stmt:
+      unsupported(stmt->line, "an import statement");
+      break;
+   case StmtType::try_stmt:
+      unsupported(stmt->line, "a try statement");
+      break;
+   default:
+      if (!target.empty()) {
+         emit(target + " = " + value(stmt) + ";");
+      } else if (is_numeric(stmt)) {
+         emit(number(stmt) + ";");
+      } else if (stmt->type == StmtType::assignment) {
+         emit(assignment(get_stmt<AssignmentExpr>(stmt), false) + ";");
+      } else {
+         emit(value(stmt) + ";");
+      }
+      break;
+   }
+}
+
+// Return statements jump past the end of the innermost block
+void Transpiler::generate_block(const Program& program, const std::string& target) {
+   auto label = unique("end", ""s);
+   scopes.emplace_back();
+   blocks.push_back({BlockKind::inner, label, target});
+   emit("{"s);
+   ++depth;
+   generate_statements(program.statements, target);
+   --depth;
+   emit("}"s);
+   blocks.pop_back();
+   scopes.pop_back();
+
+   if (used_labels.count(label)) {
+      emit(label + ":;");
+   }
+}
+
+void Transpiler::generate_statements(const std::vector<Stmt>& statements, const std::string& target) {
+   if (statements.empty() && !target.empty()) {
+      emit(target + " = NullValue::make();");
+   }
+
+   for (size_t i = 0; i < statements.size(); ++i) {
+      generate_stmt(statements.at(i), (i + 1 == statements.size() ? target : ""s));
+   }
+}
+
+void Transpiler::generate_var_decl(const VarDeclaration& decl, const std::string& target) {
+   size_t isize = decl.identifiers.size(), vsize = decl.values.size();
+   bool single_decl = (vsize == 1 && isize != 1);
+   std::string line = str(decl.line), constant = (decl.constant ? "true"s : "false"s);
+
+   if (single_decl) {
+      emit("{"s);
+      ++depth;
+      emit("Value first = " + value(decl.values.at(0)) + ";");
+   }
+
+   for (size_t i = 0; i < isize; ++i) {
+      auto& identifier = get_stmt<IdentLiteral>(decl.identifiers.at(i));
+      auto value = (single_decl ? "first->copy()"s : (i >= vsize ? "NullValue::make()"s : this->value(decl.values.at(i))));
+
+      // Bind the slot only now, the values still see the variables they shadow
+      auto& scope = scopes.back();
+      if (scope.bound.find(identifier.identifier) == scope.bound.end()) {
+         scope.bound[identifier.identifier] = scope.pending.at(identifier.identifier);
+         scope.pending.erase(identifier.identifier);
+      }
+      emit("rt::declare(" + scope.bound.at(identifier.identifier) + ", " + value + ", " + constant + ", " + annotation(identifier.annotation) + ", \"" + identifier.identifier + "\", " + line + ");");
+   }
+
+   if (single_decl) {
+      --depth;
+      emit("}"s);
+   }
+
+   if (!target.empty()) {
+      emit(target + " = NullValue::make(" + line + ");");
+   }
+}
+
+// Functions are generated as C++ functions, the declaration evaluates default values and declares the function value
+std::string Transpiler::generate_fn_decl(const FnDeclaration& decl) {
+   auto& identifier = get_stmt<IdentLiteral>(decl.identifier).identifier;
+   if (in_function || scopes.size() != 1) {
+      unsupported(decl.line, "nested function declarations");
+   }
+
+   auto& name = function_names.at(&decl);
+   std::string line = str(decl.line);
+   std::vector<std::string> defaults;
+   std::ostringstream declaration;
+
+   for (size_t i = 0; i < decl.argument_def.size(); ++i) {
+      defaults.push_back("d" + name.substr(2) + "_" + std::to_string(i));
+      globals.push_back("Value " + defaults.back() + ";");
+      declaration << defaults.back() << " = " << value(decl.argument_def.at(i)) << ";\n" << std::string(depth * 3, ' ');
+   }
+
+   std::string return_def = "r" + name.substr(2);
+   if (decl.returns->type == StmtType::identifier) {
+      globals.push_back("Value " + return_def + ";");
+      declaration << return_def << " = " << (decl.return_def->type != StmtType::null ? value(decl.return_def) : "NullValue::make(" + line + ")") << ";\n" << std::string(depth * 3, ' ');
+   }
+   declaration << "rt::declare(" << slot(identifier) << ", NativeFn::make(" << name << ", \"" << identifier << "\"s, " << line << "), true, nullptr, \"" << identifier << "\", " << line << ");";
+
+   // Function body
+   std::ostringstream body;
+   std::swap(out, body);
+   auto saved_depth = depth;
+   auto saved_current = current;
+   auto saved_scopes = scopes.size();
+   depth = 1;
+   in_function = true;
+   current = {name, identifier, (decl.return_type.accepts_any() ? nullptr : &decl.return_type)};
+   auto saved_blocks = std::move(blocks);
+   auto saved_loops = std::move(loops);
+   blocks.clear();
+   loops.clear();
+
+   emit("Value " + name + "(std::vector<Value>& args, Environment* env, int line) {");
+   ++depth;
+   emit("rt::arity(args, " + std::to_string(decl.arguments.size()) + ", " + std::to_string(decl.def_args) + ", line);");
+   scopes.emplace_back();
+
+   for (size_t i = 0; i < decl.arguments.size(); ++i) {
+      auto& arg = decl.arguments.at(i);
+      if (arg->type != StmtType::identifier) {
+         unsupported(arg->line, "a parameter that is not an identifier");
+      }
+
+      auto& parameter = get_stmt<IdentLiteral>(arg);
+      auto& bound = scopes.back().bound;
+      if (bound.find(parameter.identifier) == bound.end()) {
+         bound[parameter.identifier] = unique("v", parameter.identifier);
+         emit("rt::Slot " + bound.at(parameter.identifier) + ";");
+      }
+
+      size_t first_default = decl.arguments.size() - decl.def_args;
+      auto argument = "std::move(args.at(" + std::to_string(i) + "))";
+      if (i >= first_default) {
+         argument = "(args.size() > " + std::to_string(i) + " ? " + argument + " : " + defaults.at(i - first_default) + "->copy())";
+      }
+      emit("rt::declare(" + bound.at(parameter.identifier) + ", " + argument + ", false, " + annotation(parameter.annotation) + ", \"" + parameter.identifier + "\", line);");
+   }
+
+   if (decl.returns->type == StmtType::identifier) {
+      auto& returns = get_stmt<IdentLiteral>(decl.returns);
+      auto& bound = scopes.back().bound;
+      if (bound.find(returns.identifier) == bound.end()) {
+         bound[returns.identifier] = unique("v", returns.identifier);
+         emit("rt::Slot " + bound.at(returns.identifier) + ";");
+      }
+      emit("rt::declare(" + bound.at(returns.identifier) + ", " + return_def + "->copy(), false, " + annotation(returns.annotation) + ", \"" + returns.identifier + "\", " + line + ");");
+   }
+
+   // The value of the last statement is returned
+   auto& statements = get_stmt<Program>(decl.body).statements;
+   auto returns = (current.returns ? annotation(*current.returns) : "nullptr"s);
+   blocks.push_back({BlockKind::function, ""s, ""s});
+
+   if (!statements.empty() && is_expression(statements.back())) {
+      for (size_t i = 0; i + 1 < statements.size(); ++i) {
+         generate_stmt(statements.at(i), ""s);
+      }
+      declare_slots(statements.back());
+      emit("return rt::returns(" + value(statements.back()) + ", " + returns + ", \"" + identifier + "\", line);");
+   } else {
+      emit("Value result;"s);
+      generate_statements(statements, "result"s);
+      emit("return rt::returns(std::move(result), " + returns + ", \"" + identifier + "\", line);");
+   }
+
+   blocks = std::move(saved_blocks);
+   loops = std::move(saved_loops);
+   scopes.resize(saved_scopes);
+   --depth;
+   emit("}"s);
+
+   std::swap(out, body);
+   definitions.push_back(body.str());
+   depth = saved_depth;
+   current = saved_current;
+   in_function = false;
+   return declaration.str();
+}
+
+void Transpiler::generate_if_else(const IfElseStmt& ifelse, const std::string& target) {
+   auto clause = [&](const Stmt& stmt) {
+      ++depth;
+      generate_stmt(get_stmt<IfClauseStmt>(stmt).stmt, target);
+      --depth;
+   };
+
+   emit("if (" + condition(get_stmt<IfClauseStmt>(ifelse.ifclause).expr) + ") {");
+   clause(ifelse.ifclause);
+
+   for (const auto& elif : ifelse.elifclauses) {
+      emit("} else if (" + condition(get_stmt<IfClauseStmt>(elif).expr) + ") {");
+      clause(elif);
+   }
+
+   if (ifelse.elseclause.has_value()) {
+      emit("} else {"s);
+      clause(ifelse.elseclause.value());
+   } else if (!target.empty()) {
+      emit("} else {"s);
+      emit("   " + target + " = NullValue::make(" + str(ifelse.line) + ");");
+   }
+   emit("}"s);
+}
+
+void Transpiler::generate_while_loop(const WhileStmt& while_stmt, const std::string& target) {
+   if (!target.empty()) {
+      emit(target + " = NullValue::make(" + str(while_stmt.line) + ");");
+   }
+
+   emit("while (" + (while_stmt.infinite ? "true"s : condition(while_stmt.expr)) + ") {");
+   ++depth;
+   loops.push_back({""s, target});
+   generate_stmt(while_stmt.stmt, target);
+   loops.pop_back();
+   --depth;
+   emit("}"s);
+}
+
+// The body is evaluated in the scope of the loop, so variables declared by it are declared before the loop
+void Transpiler::generate_for_loop(const ForStmt& for_stmt, const std::string& target) {
+   auto& body = get_stmt<Program>(for_stmt.stmt);
+   scopes.emplace_back();
+   emit("{"s);
+   ++depth;
+
+   if (!target.empty()) {
+      emit(target + " = NullValue::make(" + str(for_stmt.line) + ");");
+   }
+
+   if (for_stmt.initexpr.has_value()) {
+      generate_stmt(for_stmt.initexpr.value(), ""s);
+   }
+
+   std::vector<std::pair<std::string, bool>> identifiers;
+   for (const auto& stmt : body.statements) {
+      collect(stmt, identifiers);
+   }
+
+   for (const auto& [identifier, is_fn] : identifiers) {
+      auto& scope = scopes.back();
+      if (scope.bound.find(identifier) != scope.bound.end()) {
+         continue;
+      } else if (!slot(identifier).empty()) {
+         unsupported(for_stmt.line, "a for loop body declaring '" + identifier + "', which shadows another variable");
+      }
+
+      scope.bound[identifier] = (scope.pending.count(identifier) ? scope.pending.at(identifier) : unique("v", identifier));
+      if (!scope.pending.count(identifier)) {
+         emit("rt::Slot " + scope.bound.at(identifier) + ";");
+      }
+      scope.pending.erase(identifier);
+   }
+
+   auto next = unique("next", ""s);
+   if (for_stmt.condition.has_value()) {
+      declare_slots(for_stmt.condition.value());
+   }
+   emit("while (" + (for_stmt.condition.has_value() ? condition(for_stmt.condition.value()) : "true"s) + ") {");
+   ++depth;
+
+   loops.push_back({next, target});
+   blocks.push_back({BlockKind::inner, next, target});
+   emit("{"s);
+   ++depth;
+   generate_statements(body.statements, target);
+   --depth;
+   emit("}"s);
+   blocks.pop_back();
+   loops.pop_back();
+
+   if (used_labels.count(next)) {
+      emit(next + ":;");
+   }
+
+   if (for_stmt.loopexpr.has_value()) {
+      generate_stmt(for_stmt.loopexpr.value(), ""s);
+   }
+   --depth;
+   emit("}"s);
+
+   --depth;
+   emit("}"s);
+   scopes.pop_back();
+}
+
+// Return leaves the innermost block, which is only the function itself at its top level
+void Transpiler::generate_return(const ReturnStmt& return_stmt) {
+   if (!in_function) {
+      emit("fmt::raise(" + str(return_stmt.line) + ", \"'ReturnStatement' outside of a function.\");");
+      return;
+   } else if (blocks.empty() || blocks.back().kind == BlockKind::barrier) {
+      unsupported(return_stmt.line, "a return statement used as a value");
+   }
+
+   auto& block = blocks.back();
+   auto returned = [&](const std::string& value) {
+      if (block.kind == BlockKind::function) {
+         auto returns = (current.returns ? annotation(*current.returns) : "nullptr"s);
+         return "return rt::returns(" + value + ", " + returns + ", \"" + current.identifier + "\", line);";
+      }
+      return "return " + value + ";";
+   };
+
+   if (block.kind == BlockKind::inner) {
+      generate_stmt(return_stmt.value, block.target);
+      used_labels.insert(block.label);
+      emit("goto " + block.label + ";");
+   } else if (is_expression(return_stmt.value)) {
+      emit(returned(value(return_stmt.value)));
+   } else {
+      auto temporary = unique("t", ""s);
+      emit("{"s);
+      ++depth;
+      emit("Value " + temporary + ";");
+      generate_stmt(return_stmt.value, temporary);
+      emit(returned("std::move(" + temporary + ")"));
+      --depth;
+      emit("}"s);
+   }
+}
+
+void Transpiler::generate_jump(const Stmt& stmt) {
+   bool is_break = (stmt->type == StmtType::break_stmt);
+   if (loops.empty() && !in_function) {
+      emit("fmt::raise(" + str(stmt->line) + ", \"'" + (is_break ? "BreakStatement"s : "ContinueStatement"s) + "' outside of a loop.\");");
+      return;
+   } else if (loops.empty() || loops.back().barrier) {
+      unsupported(stmt->line, (is_break ? "a break"s : "a continue"s) + " statement outside of a loop of the same function");
+   }
+
+   // The loop evaluates to the null value of the jump
+   if (!loops.back().target.empty()) {
+      emit(loops.back().target + " = NullValue::make(" + str(stmt->line) + ");");
+   }
+
+   if (is_break) {
+      emit("break;"s);
+   } else if (loops.back().next.empty()) {
+      emit("continue;"s);
+   } else {
+      used_labels.insert(loops.back().next);
+      emit("goto " + loops.back().next + ";");
+   }
+}
+
+// Expression generation functions
+
+// C++ expression creating the value of the expression
+std::string Transpiler::value(const Stmt& expr) {
+   std::string line = str(expr->line);
+   if (is_numeric(expr) && expr->type != StmtType::number && expr->type != StmtType::identifier) {
+      return "NumberValue::make(" + number(expr) + ", " + line + ")";
+   }
+
+   switch (expr->type) {
+   case StmtType::number:
+      return "NumberValue::make(" + literal(get_stmt<NumberLiteral>(expr).number) + ", " + line + ")";
+   case StmtType::character:
+      return "CharValue::make(char(" + std::to_string(int(get_stmt<CharLiteral>(expr).ch)) + "), " + line + ")";
+   case StmtType::string:
+      return "StringValue::make(" + quote(get_stmt<StringLiteral>(expr).string) + "s, " + line + ")";
+   case StmtType::null:
+      return "NullValue::make(" + line + ")";
+   case StmtType::identifier: {
+      auto& identifier = get_stmt<IdentLiteral>(expr).identifier;
+      auto cpp = slot(identifier);
+      if (cpp.empty()) {
+         return "(" + missing(identifier, expr->line) + ", Value())";
+      }
+      return "rt::get(" + cpp + ", \"" + identifier + "\", " + line + ")->copy()";
+   }
+   case StmtType::exists: {
+      auto& identifier = get_stmt<IdentLiteral>(get_stmt<ExistsStmt>(expr).identifier).identifier;
+      auto cpp = slot(identifier);
+      return "BoolValue::make(" + (cpp.empty() ? "false"s : "bool(" + cpp + ".value)") + ", " + line + ")";
+   }
+   case StmtType::array:
+      return "[&]() -> Value { " + arguments(get_stmt<ArrayLiteral>(expr).array) + "return Array::make(std::move(args), " + line + "); }()";
+   case StmtType::binary: {
+      auto& binary = get_stmt<BinaryExpr>(expr);
+      if ((is_comparison(binary.op) && binary.left->static_type == StaticType::number && binary.right->static_type == StaticType::number) || binary.op == Type::log_and || binary.op == Type::log_or) {
+         return "BoolValue::make(" + condition(expr) + ", " + line + ")";
+      } else if (binary.op == Type::binary_cond) {
+         return "[&]() -> Value { auto left = " + value(binary.left) + "; return (left->type == ValueType::null ? " + value(binary.right) + " : std::move(left)); }()";
+      }
+      return "rt::binary(" + op_name(binary.op) + ", {" + value(binary.left) + ", " + value(binary.right) + "}, " + line + ")";
+   }
+   case StmtType::unary: {
+      auto& unary = get_stmt<UnaryExpr>(expr);
+      if ((unary.op == Type::increment || unary.op == Type::decrement) && unary.value->type == StmtType::identifier) {
+         auto& identifier = get_stmt<IdentLiteral>(unary.value).identifier;
+         auto cpp = slot(identifier);
+         if (cpp.empty()) {
+            return value(unary.value);
+         }
+
+         auto method = (unary.op == Type::increment ? "increment"s : "decrement"s);
+         return "rt::assign(" + cpp + ", rt::get(" + cpp + ", \"" + identifier + "\", " + line + ")->" + method + "(), \"" + identifier + "\", " + line + ")->copy()";
+      }
+      return "rt::unary(" + op_name(unary.op) + ", " + value(unary.value) + ", " + line + ")";
+   }
+   case StmtType::assignment:
+      return assignment(get_stmt<AssignmentExpr>(expr), true);
+   case StmtType::ternary: {
+      auto& ternary = get_stmt<TernaryExpr>(expr);
+      return "(" + condition(ternary.left) + " ? " + value(ternary.middle) + " : " + value(ternary.right) + ")";
+   }
+   case StmtType::member: {
+      auto& member = get_stmt<MemberAccess>(expr);
+      return "rt::member({" + value(member.left) + ", " + value(member.key) + "}, " + line + ")";
+   }
+   case StmtType::property:
+      return property(get_stmt<PropertyAccess>(expr));
+   case StmtType::call:
+      return call(get_stmt<CallExpr>(expr));
+   default:
+      return lambda(expr);
+   }
+}
+
+// C++ long double expression, mirrors Interpreter::evaluate_number()
+std::string Transpiler::number(const Stmt& expr) {
+   std::string line = str(expr->line);
+
+   switch (expr->type) {
+   case StmtType::number:
+      return literal(get_stmt<NumberLiteral>(expr).number);
+   case StmtType::identifier: {
+      auto& identifier = get_stmt<IdentLiteral>(expr).identifier;
+      auto cpp = slot(identifier);
+      if (cpp.empty()) {
+         break;
+      }
+      return "rt::number(" + cpp + ", \"" + identifier + "\", " + line + ")";
+   }
+   case StmtType::binary: {
+      auto& binary = get_stmt<BinaryExpr>(expr);
+      if (!is_arithmetic(binary.op)) {
+         break;
+      }
+      return "rt::arithmetic(" + op_name(binary.op) + ", {" + number(binary.left) + ", " + number(binary.right) + "}, " + line + ")";
+   }
+   case StmtType::unary: {
+      auto& unary = get_stmt<UnaryExpr>(expr);
+      if ((unary.op == Type::increment || unary.op == Type::decrement) && unary.value->type == StmtType::identifier) {
+         auto& identifier = get_stmt<IdentLiteral>(unary.value).identifier;
+         auto cpp = slot(identifier);
+         if (cpp.empty()) {
+            return "(" + missing(identifier, expr->line) + ", 0.0L)";
+         }
+         return "rt::assign_number(" + cpp + ", rt::number(" + cpp + ", \"" + identifier + "\", " + line + ") " + (unary.op == Type::increment ? "+" : "-") + " 1, \"" + identifier + "\", " + line + ")";
+      }
+
+      switch (unary.op) {
+      case Type::minus:
+         return "-" + number(unary.value);
+      case Type::increment:
+         return "(" + number(unary.value) + " + 1)";
+      case Type::decrement:
+         return "(" + number(unary.value) + " - 1)";
+      default:
+         return number(unary.value);
+      }
+   }
+   case StmtType::assignment: {
+      auto& assignment = get_stmt<AssignmentExpr>(expr);
+      if (assignment.left->type != StmtType::identifier) {
+         break;
+      }
+
+      auto& identifier = get_stmt<IdentLiteral>(assignment.left).identifier;
+      auto cpp = slot(identifier);
+      if (cpp.empty()) {
+         return "(" + missing(identifier, expr->line) + ", 0.0L)";
+      } else if (assignment.op == Type::assign) {
+         return "rt::assign_number(" + cpp + ", " + number(assignment.right) + ", \"" + identifier + "\", " + line + ")";
+      }
+
+      // Right side is evaluated before the variable is read
+      return "[&]() { long double right = " + number(assignment.right) + "; return rt::assign_number(" + cpp + ", rt::arithmetic(" + op_name(compound_op(assignment.op)) + ", {rt::number(" + cpp + ", \"" + identifier + "\", " + line + "), right}, " + line + "), \"" + identifier + "\", " + line + "); }()";
+   }
+   default:
+      break;
+   }
+   return value(expr) + "->as_number()";
+}
+
+// C++ bool expression of the truthiness of the expression
+std::string Transpiler::condition(const Stmt& expr) {
+   if (expr->type == StmtType::unary && get_stmt<UnaryExpr>(expr).op == Type::log_not) {
+      return "!" + condition(get_stmt<UnaryExpr>(expr).value);
+   } else if (is_numeric(expr)) {
+      return "(" + number(expr) + " != 0)";
+   } else if (expr->type == StmtType::identifier) {
+      auto& identifier = get_stmt<IdentLiteral>(expr).identifier;
+      if ((identifier == "true"s || identifier == "false"s) && slot(identifier) == "g_" + identifier) {
+         return identifier;
+      }
+   } else if (expr->type == StmtType::binary) {
+      auto& binary = get_stmt<BinaryExpr>(expr);
+      if (binary.op == Type::log_and || binary.op == Type::log_or) {
+         return "(" + condition(binary.left) + (binary.op == Type::log_and ? " && " : " || ") + condition(binary.right) + ")";
+      } else if (is_comparison(binary.op) && binary.left->static_type == StaticType::number && binary.right->static_type == StaticType::number) {
+         return "rt::compare(" + op_name(binary.op) + ", {" + number(binary.left) + ", " + number(binary.right) + "}, " + str(binary.line) + ")";
+      }
+   }
+   return value(expr) + "->as_bool()";
+}
+
+std::string Transpiler::assignment(const AssignmentExpr& assignment, bool boxed) {
+   std::string line = str(assignment.line);
+   if (assignment.left->type != StmtType::identifier) {
+      return "(fmt::raise(" + str(assignment.left->line) + ", \"Expected an 'IdentifierLiteral' at the left side of the '{}' operator, got '{}'.\", \"" + std::string(type_str[int(assignment.op)]) + "\", \"" + std::string(stmt_type_str[int(assignment.left->type)]) + "\"), Value())";
+   }
+
+   auto& identifier = get_stmt<IdentLiteral>(assignment.left).identifier;
+   auto cpp = slot(identifier);
+   if (cpp.empty()) {
+      return "(" + missing(identifier, assignment.line) + ", Value())";
+   }
+
+   auto right = value(assignment.right);
+   if (assignment.op != Type::assign) {
+      right = "rt::compound(" + op_name(assignment.op) + ", " + right + ", " + cpp + ", \"" + identifier + "\", " + line + ")";
+   }
+   return "rt::assign(" + cpp + ", " + right + ", \"" + identifier + "\", " + line + ")" + (boxed ? "->copy()" : "");
+}
+
+// Arguments are evaluated before the function is looked up
+std::string Transpiler::call(const CallExpr& call) {
+   std::string line = str(call.line);
+   auto result = "[&]() -> Value { " + arguments(get_stmt<ArgsListExpr>(call.args).args);
+
+   if (call.identifier->type != StmtType::identifier) {
+      return result + "return rt::call(" + value(call.identifier) + ", args, " + line + "); }()";
+   }
+
+   auto& identifier = get_stmt<IdentLiteral>(call.identifier).identifier;
+   auto cpp = slot(identifier);
+   if (cpp.empty()) {
+      return result + missing(identifier, call.line) + "; }()";
+   } else if (cpp == "g_" + identifier && !native(identifier).empty()) {
+      return result + "return " + native(identifier) + "(args, nullptr, " + line + "); }()";
+   } else if (auto it = functions.find(identifier); cpp == "g_" + identifier && it != functions.end()) {
+      return result + "rt::get(" + cpp + ", \"" + identifier + "\", " + line + "); return " + it->second + "(args, nullptr, " + line + "); }()";
+   }
+   return result + "return rt::call(rt::get(" + cpp + ", \"" + identifier + "\", " + line + "), args, " + line + "); }()";
+}
+
+// Properties that override their value assign it to the variable they were called on
+std::string Transpiler::property(const PropertyAccess& prop) {
+   std::string line = str(prop.line), bound = "nullptr"s, identifier;
+   if (prop.left->type == StmtType::identifier) {
+      identifier = get_stmt<IdentLiteral>(prop.left).identifier;
+      bound = (slot(identifier).empty() ? "nullptr"s : "&" + slot(identifier));
+   }
+
+   auto result = "[&]() -> Value { Value left = " + value(prop.left) + "; rt::Slot* bound = " + bound + "; ";
+   for (const auto& property : prop.right) {
+      auto& call = get_stmt<CallExpr>(property);
+      auto& name = get_stmt<IdentLiteral>(call.identifier).identifier;
+      auto& args = get_stmt<ArgsListExpr>(call.args).args;
+
+      result += "{ std::vector<Value> args; args.reserve(" + std::to_string(args.size() + 2) + "); args.push_back(NullValue::make(" + str(prop.left->line) + ")); args.push_back(left->copy()); ";
+      for (const auto& arg : args) {
+         result += "args.push_back(" + value(arg) + "); ";
+      }
+      result += "left = rt::property(left, \"" + name + "\", args, bound, \"" + identifier + "\", " + line + "); } ";
+   }
+   return result + "return left; }()";
+}
+
+// Statements used as values are evaluated in a lambda, blocks keep their own scope
+std::string Transpiler::lambda(const Stmt& stmt) {
+   bool is_block = (stmt->type == StmtType::program);
+   if (!is_block) {
+      declare_slots(stmt);
+   }
+
+   std::ostringstream body;
+   std::swap(out, body);
+   auto saved_depth = depth;
+   depth = 1;
+
+   loops.push_back({""s, ""s, true});
+   if (is_block) {
+      auto& statements = get_stmt<Program>(stmt).statements;
+      scopes.emplace_back();
+      blocks.push_back({BlockKind::lambda, ""s, ""s});
+
+      if (!statements.empty() && is_expression(statements.back())) {
+         for (size_t i = 0; i + 1 < statements.size(); ++i) {
+            generate_stmt(statements.at(i), ""s);
+         }
+         declare_slots(statements.back());
+         emit("return " + value(statements.back()) + ";");
+      } else {
+         emit("Value result;"s);
+         generate_statements(statements, "result"s);
+         emit("return result;"s);
+      }
+      scopes.pop_back();
+   } else {
+      blocks.push_back({BlockKind::barrier, ""s, ""s});
+      emit("Value result;"s);
+      generate_stmt(stmt, "result"s);
+      emit("return result;"s);
+   }
+   blocks.pop_back();
+   loops.pop_back();
+
+   std::swap(out, body);
+   depth = saved_depth;
+
+   // Indent the body relative to the statement the lambda is part of
+   std::string indent (depth * 3, ' '), result = "[&]() -> Value {\n";
+   std::istringstream lines (body.str());
+   for (std::string text; std::getline(lines, text);) {
+      result += indent + text + '\n';
+   }
+   return result + indent + "}()";
+}
+
+std::string Transpiler::arguments(const std::vector<Stmt>& args) {
+   std::string result = "std::vector<Value> args; ";
+   if (!args.empty()) {
+      result += "args.reserve(" + std::to_string(args.size()) + "); ";
+   }
+
+   for (const auto& arg : args) {
+      result += "args.push_back(" + value(arg) + "); ";
+   }
+   return result;
+}
+
+// Utility functions
+
+void Transpiler::emit(const std::string& line) {
+   out << std::string(depth * 3, ' ') << line << '\n';
+}
+
+// Declare slots for the variables the statement declares in the current scope
+void Transpiler::declare_slots(const Stmt& stmt) {
+   std::vector<std::pair<std::string, bool>> identifiers;
+   collect(stmt, identifiers);
+
+   auto& scope = scopes.back();
+   for (const auto& [identifier, is_fn] : identifiers) {
+      if (!is_fn && scope.bound.find(identifier) == scope.bound.end() && scope.pending.find(identifier) == scope.pending.end()) {
+         scope.pending[identifier] = unique("v", identifier);
+         emit("rt::Slot " + scope.pending.at(identifier) + ";");
+      }
+   }
+}
+
+// Collect variables and functions declared by the statement in the current scope
+void Transpiler::collect(const Stmt& stmt, std::vector<std::pair<std::string, bool>>& identifiers) const {
+   switch (stmt->type) {
+   case StmtType::var_decl:
+      for (const auto& identifier : get_stmt<VarDeclaration>(stmt).identifiers) {
+         identifiers.push_back({get_stmt<IdentLiteral>(identifier).identifier, false});
+      }
+      break;
+   case StmtType::fn_decl: {
+      auto& decl = get_stmt<FnDeclaration>(stmt);
+      if (decl.identifier->type != StmtType::identifier) {
+         unsupported(decl.line, "anonymous functions");
+      }
+      identifiers.push_back({get_stmt<IdentLiteral>(decl.identifier).identifier, true});
+      for (const auto& def : decl.argument_def) {
+         collect(def, identifiers);
+      }
+      collect(decl.return_def, identifiers);
+      return;
+   }
+   case StmtType::program:
+   case StmtType::for_loop:
+      return;
+   default:
+      break;
+   }
+
+   for (const auto* child : children(stmt)) {
+      collect(*child, identifiers);
+   }
+}
+
+std::string Transpiler::slot(const std::string& identifier) const {
+   for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+      if (auto found = it->bound.find(identifier); found != it->bound.end()) {
+         return found->second;
+      }
+   }
+   return ""s;
+}
+
+std::string Transpiler::annotation(const Annotation& annotation) {
+   if (annotation.accepts_any()) {
+      return "nullptr"s;
+   }
+
+   auto key = std::make_pair(annotation.type, annotation.element);
+   if (annotations.find(key) == annotations.end()) {
+      annotations[key] = "a" + std::to_string(annotations.size() + 1);
+   }
+   return "&" + annotations.at(key);
+}
+
+std::string Transpiler::unique(const std::string& prefix, const std::string& identifier) {
+   return prefix + std::to_string(++counter) + (identifier.empty() ? ""s : "_" + identifier);
+}
+
+void Transpiler::unsupported(int line, const std::string& what) const {
+   fmt::raise(line, "Cannot emit C++ for {}.", what);
+}
@@ -16,15 +16,99 @@ bool one(ValueType t1, ValueType t2, ValueType type) {
    return (t1 == type || t2 == type) && t1 != t2;
 }
 
+// Memory accounting
+
+namespace mem {
+   thread_local Account* account = nullptr;
+
+   void reserve(std::uint64_t bytes, int line) {
+      if (account && account->limit && account->used + bytes > account->limit) {
+         account->overdrawn = true;
+         fmt::raise(line, "Exceeded the budget of {} bytes of memory.", account->limit);
+      }
+   }
+
+   // Size of the value itself, without what it holds
+   std::uint64_t object_size(ValueType type) {
+      switch (type) {
+      case ValueType::identifier: return sizeof(IdentValue);
+      case ValueType::number: return sizeof(NumberValue);
+      case ValueType::character: return sizeof(CharValue);
+      case ValueType::string: return sizeof(StringValue);
+      case ValueType::boolean: return sizeof(BoolValue);
+      case ValueType::array: return sizeof(Array);
+      case ValueType::native_fn: return sizeof(NativeFn);
+      case ValueType::fn: return sizeof(Function);
+      case ValueType::module: return sizeof(ModuleValue);
+      case ValueType::error: return sizeof(ErrorValue);
+      default: return sizeof(NullValue);
+      }
+   }
+
+   std::uint64_t footprint(const ValueLiteral& value) {
+      auto size = object_size(value.type);
+      if (value.type == ValueType::string) {
+         size += static_cast<const StringValue&>(value).string.capacity();
+      } else if (value.type == ValueType::array) {
+         const auto& array = static_cast<const Array&>(value).array;
+         size += array.capacity() * sizeof(Value);
+         for (const auto& element : array) {
+            size += footprint(*element);
+         }
+      }
+      return size;
+   }
+}
+
 // Value functions
 
 ValueLiteral::ValueLiteral(ValueType type, int line)
-   : type(type), line(line) {}
+   : type(type), line(line) {
+   if (mem::account) {
+      mem::charge(mem::object_size(type));
+   }
+}
 
 void ValueLiteral::print() const {
    std::cout << as_string();
 }
 
+// Check value against type annotation
+
+bool ValueLiteral::matches(const Annotation& annotation) const {
+   switch (annotation.type) {
+   case StaticType::unknown:
+   case StaticType::dynamic:
+      return true;
+   case StaticType::null:
+      return type == ValueType::null;
+   case StaticType::number:
+      return type == ValueType::number;
+   case StaticType::character:
+      return type == ValueType::character;
+   case StaticType::string:
+      return type == ValueType::string;
+   case StaticType::boolean:
+      return type == ValueType::boolean;
+   case StaticType::function:
+      return type == ValueType::fn || type == ValueType::native_fn;
+   case StaticType::array: {
+      if (type != ValueType::array) {
+         return false;
+      }
+
+      for (const auto& element : static_cast<const Array*>(this)->array) {
+         if (!element->matches({annotation.element})) {
+            return false;
+         }
+      }
+      return true;
+   }
+   default:
+      return false;
+   }
+}
+
 // Operator functions
 
 // Unary negation operator
@@ -79,6 +163,9 @@ Value ValueLiteral::add(Value& other) const {
    if (any(t1, t2, ValueType::null)) {
       return NullValue::make(line);
    } else if (t1 == t2 && t1 == ValueType::array) {
+      if (mem::account) {
+         mem::reserve(mem::footprint(*this) + mem::footprint(*other), line);
+      }
       auto copy1 = this->copy();
       auto copy2 = other->copy();
 
@@ -88,21 +175,26 @@ Value ValueLiteral::add(Value& other) const {
       for (auto& element : array2.array) {
          array1.array.push_back(std::move(element));
       }
+      array1.recharge();
       return std::move(copy1);
-   } else if (t1 == ValueType::array) {
-      auto copy = this->copy();
-      auto& array = get_value<Array>(copy);
-
-      array.array.push_back(other->copy());
-      return std::move(copy);
-   } else if (t2 == ValueType::array) {
-      auto copy = other->copy();
+   } else if (any(t1, t2, ValueType::array)) {
+      if (mem::account) {
+         mem::reserve(mem::footprint(*this) + mem::footprint(*other), line);
+      }
+      auto copy = (t1 == ValueType::array ? this->copy() : other->copy());
       auto& array = get_value<Array>(copy);
 
-      array.array.insert(array.array.begin(), this->copy());
+      if (t1 == ValueType::array) {
+         array.array.push_back(other->copy());
+      } else {
+         array.array.insert(array.array.begin(), this->copy());
+      }
+      array.recharge();
       return std::move(copy);
    } else if (any(t1, t2, ValueType::string)) {
-      return StringValue::make(as_string() + other->as_string(), line);
+      auto left = as_string(), right = other->as_string();
+      mem::reserve(left.size() + right.size(), line);
+      return StringValue::make(left + right, line);
    } else if (!any(t1, t2, ValueType::identifier)) {
       if (t1 == ValueType::number) {
          return NumberValue::make(as_number() + other->as_number(), line);
@@ -141,9 +233,11 @@ Value ValueLiteral::multiply(Value& other) const {
       return NullValue::make(line);
    } else if (one(t1, t2, ValueType::string) && (one(t1, t2, ValueType::number) || one(t1, t2, ValueType::character) || one(t1, t2, ValueType::boolean))) {
       auto temp = (t1 == ValueType::string ? as_string() : other->as_string());
+      auto count = (t1 == ValueType::string ? other->as_number() : as_number());
+      mem::reserve(std::min<long double>(temp.size() * std::max(std::ceil(count), 0.0L), UINT64_MAX), line);
       std::string result;
 
-      for (int i = 0; i < (t1 == ValueType::string ? other->as_number() : as_number()); ++i) {
+      for (int i = 0; i < count; ++i) {
          result += temp;
       }
       return StringValue::make(result, line);
@@ -351,7 +445,9 @@ Value CharValue::copy() const {
 // String value
 
 StringValue::StringValue(const std::string& string, int line)
-   : string(string), ValueLiteral(ValueType::string, line) {}
+   : string(string), ValueLiteral(ValueType::string, line) {
+   mem::charge(this->string.capacity());
+}
 
 std::string StringValue::as_string() const {
    return string;
@@ -406,7 +502,9 @@ Value BoolValue::copy() const {
 // Array value
 
 Array::Array(std::vector<Value> array, int line)
-   : array(std::move(array)), ValueLiteral(ValueType::array, line) {}
+   : array(std::move(array)), ValueLiteral(ValueType::array, line) {
+   recharge();
+}
 
 std::string Array::as_string() const {
    std::string result = "[ "s;
@@ -463,8 +561,8 @@ Value NativeFn::copy() const {
 
 // User-defined function value
 
-Function::Function(const std::string& identifier, const std::vector<std::string>& parameters, std::vector<Value> parameter_def, const std::string& returns, Value return_def, Environment* env, Stmt body, int def_args, int line)
-   : identifier(identifier), parameters(parameters), parameter_def(std::move(parameter_def)), returns(returns), return_def(std::move(return_def)), env(env), body(std::move(body)), def_args(def_args), ValueLiteral(ValueType::fn, line) {}
+Function::Function(const std::string& identifier, const std::vector<std::string>& parameters, std::vector<Value> parameter_def, std::vector<Annotation> parameter_types, const std::string& returns, Value return_def, Annotation returns_type, Annotation return_type, Environment* env, Stmt body, int def_args, int line)
+   : identifier(identifier), parameters(parameters), parameter_def(std::move(parameter_def)), parameter_types(std::move(parameter_types)), returns(returns), return_def(std::move(return_def)), returns_type(returns_type), return_type(return_type), env(env), body(std::move(body)), def_args(def_args), ValueLiteral(ValueType::fn, line) {}
 
 std::string Function::as_string() const {
    return identifier;
@@ -487,7 +585,67 @@ Value Function::copy() const {
    for (const auto& param_def : parameter_def) {
       copied_param_def.push_back(param_def->copy());
    }
-   return Function::make(identifier, parameters, std::move(copied_param_def), returns, return_def->copy(), env, body->copy(), def_args, line);
+   auto copied = Function::make(identifier, parameters, std::move(copied_param_def), parameter_types, returns, return_def->copy(), returns_type, return_type, env, body->copy(), def_args, line);
+   get_value<Function>(copied).guards = guards;
+   get_value<Function>(copied).guarded_body = guarded_body;
+   get_value<Function>(copied).compiled = compiled;
+   get_value<Function>(copied).compiled_guarded = compiled_guarded;
+   get_value<Function>(copied).parsed = parsed;
+   get_value<Function>(copied).source = source;
+   get_value<Function>(copied).captured = (captured ? captured : weak_captured.lock());
+   return copied;
+}
+
+// Module value
+
+ModuleValue::ModuleValue(const std::string& identifier, Environment* env, int line)
+   : identifier(identifier), env(env), ValueLiteral(ValueType::module, line) {}
+
+std::string ModuleValue::as_string() const {
+   return identifier;
+}
+
+long double ModuleValue::as_number() const {
+   fmt::raise(line, "Cannot convert 'Module' to 'Number'.");
+}
+
+char ModuleValue::as_char() const {
+   fmt::raise(line, "Cannot convert 'Module' to 'Character'.");
+}
+
+bool ModuleValue::as_bool() const {
+   fmt::raise(line, "Cannot convert 'Module' to 'Boolean'.");
+}
+
+Value ModuleValue::copy() const {
+   auto copied = ModuleValue::make(identifier, env, line);
+   get_value<ModuleValue>(copied).path = path;
+   return copied;
+}
+
+// Error value
+
+ErrorValue::ErrorValue(const std::string& message, int error_line, int code, int line)
+   : message(message), error_line(error_line), code(code), ValueLiteral(ValueType::error, line) {}
+
+std::string ErrorValue::as_string() const {
+   return message;
+}
+
+long double ErrorValue::as_number() const {
+   fmt::raise(line, "Cannot convert 'Error' to 'Number'.");
+}
+
+char ErrorValue::as_char() const {
+   fmt::raise(line, "Cannot convert 'Error' to 'Character'.");
+}
+
+bool ErrorValue::as_bool() const {
+   fmt::raise(line, "Cannot convert 'Error' to 'Boolean'.");
+}
+
+Value ErrorValue::copy() const {
+   return ErrorValue::make(message, error_line, code, line);
 }
 
 // Null value
@@ -0,0 +1,227 @@
+// Includes
+
+#include "cache.hpp"
+#include "checker.hpp"
+#include "error.hpp"
+#include "file.hpp"
+#include "inference.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "module.hpp"
+#include "parser.hpp"
+#include "snapshot.hpp"
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+// Consistency check
+// Runs the paths that only large or repeated runs take on generated programs and compares them with the plain
+// path, since normal use rarely exercises them. Prints every mismatch and exits with 1 if there is one.
+
+static int failures = 0;
+
+static void check(bool cond, const std::string& what) {
+   if (!cond) {
+      std::cout << "Mismatch: " << what << '\n';
+      ++failures;
+   }
+}
+
+// Chunks of the program vary in length, and hold strings and comments with newlines and comment markers in them, so
+// chunk boundaries land inside every kind of token
+static std::string generate(std::size_t size) {
+   std::string code;
+   for (std::size_t i = 0; code.size() < size; ++i) {
+      auto n = std::to_string(i);
+      code += "// Line comment " + n + " with \"quotes\" and /* markers\n";
+      code += "let value_" + n + " = " + n + " * 2.5e-1 + 0x1F, text_" + n + " = \"// not a comment /* " + n + "\\n\\\"\"\n";
+      code += "/* Block comment " + n + "\n   spanning lines with \"quotes\" // and markers\n" + std::string(i % 97, '*') + "*/\n";
+      code += "fn f_" + n + "(a: number, b) -> number {\n   return a + b * 'c' - " + std::string(i % 13, '(') + n + std::string(i % 13, ')') + "\n}\n";
+      code += "println(text_" + n + ", f_" + n + "(value_" + n + ", " + n + "), [1, 2, 3], true, null)\n\n";
+   }
+   return code;
+}
+
+// Program declaring and printing values of every kind, with functions using every kind of statement
+static std::string generate_program(int count) {
+   std::string code = "let total = 0\n";
+   for (int i = 0; i < count; ++i) {
+      auto n = std::to_string(i);
+      code += "let list_" + n + " = [" + n + ", \"item " + n + "\", 'x', true, null, [" + n + " * 2, [-" + n + "]]]\n";
+      code += "con name_" + n + ": string = \"name\\t" + n + "\"\n";
+      code += "fn step_" + n + "(x, y: number = 2) -> number {\n"
+              "   let sum = 0\n"
+              "   for let k = 0; k < x; k++ do\n"
+              "      sum += k * y\n"
+              "   if sum > 10 do\n"
+              "      sum -= " + n + "\n"
+              "   elif sum > 5 do\n"
+              "      sum *= 2\n"
+              "   else do\n"
+              "      sum = -sum\n"
+              "   return sum\n"
+              "}\n";
+      code += "let twice_" + n + " = fn (x) { return x * 2 }\n";
+      code += "try do throw(\"failed " + n + "\", " + n + ") catch error do total += error.code()\n";
+      code += "let caught_" + n + " = null\n";
+      code += "try do list_" + n + ".at(9) catch error do caught_" + n + " = error\n";
+      code += "while total % 7 != 0 do\n   total += 1\n";
+      code += "total += step_" + n + "(" + std::to_string(i % 9) + ") + twice_" + n + "(" + n + ") + step_" + n + "(2, 1)\n";
+      code += "println(name_" + n + ", list_" + n + ", total, caught_" + n + ")\n";
+   }
+   return code;
+}
+
+static std::string serialize(const std::vector<Stmt>& statements) {
+   std::string data;
+   for (const auto& stmt : statements) {
+      check(cache::write_stmt(data, stmt), "statement that cannot be cached");
+   }
+   return data;
+}
+
+// Checks and runs a program in the global environment the way the interpreter does, and returns what it printed
+static std::string run(Program& program, std::string_view code, Environment& global) {
+   std::ostringstream output;
+   auto buffer = std::cout.rdbuf(output.rdbuf());
+
+   mod::Registry modules (std::filesystem::current_path().string());
+   Interpreter interpreter (modules);
+   Checker().check(program);
+   modules.load(program, code);
+   TypeInference().analyze(program);
+   interpreter.evaluate(program, global);
+
+   std::cout.rdbuf(buffer);
+   return output.str();
+}
+
+// Lexer
+// Sources of at least twice the smallest chunk are lexed in chunks, stitched together they match the sequential lexer
+
+static void check_lexer(std::string_view code) {
+   Lexer sequential (code);
+   auto& expected = sequential.lex();
+
+   for (unsigned threads : {2u, 3u, 4u, 7u}) {
+      Lexer parallel (code);
+      auto& tokens = parallel.lex(threads);
+      auto where = " lexing on " + std::to_string(threads) + " threads";
+
+      check(tokens.size() == expected.size(), "token count" + where);
+      for (std::size_t i = 0; i < tokens.size() && i < expected.size(); ++i) {
+         const auto& token = tokens.at(i);
+         const auto& other = expected.at(i);
+         if (token.type != other.type || token.lexeme != other.lexeme || token.line != other.line || token.number != other.number || token.ch != other.ch) {
+            check(false, "token " + std::to_string(i) + " at line " + std::to_string(other.line) + where);
+            break;
+         }
+      }
+   }
+}
+
+// Cache
+// A program loaded from the cache is the tree that was stored, and runs the same
+
+static void check_cache(std::string_view code) {
+   auto directory = (std::filesystem::temp_directory_path() / ("cll-consistency-" + std::to_string(getpid()))).string();
+   auto hash = file::hash(code);
+
+   Lexer lexer (code);
+   Parser parser (lexer.lex());
+   auto& parsed = parser.parse();
+   cache::store(directory, code, hash, parsed, 1);
+
+   Program cached;
+   std::uint64_t parse_time = 0;
+   bool loaded = cache::load(directory, code, hash, cached, parse_time);
+   std::filesystem::remove_all(directory);
+   check(loaded, "cached program could not be loaded");
+   if (!loaded) {
+      return;
+   }
+
+   check(cached.statements.size() == parsed.statements.size(), "statement count of the cached program");
+   check(serialize(cached.statements) == serialize(parsed.statements), "syntax tree of the cached program");
+   check(parse_time == 1, "parse time of the cached program");
+
+   Environment global, cached_global;
+   check(run(cached, code, cached_global) == run(parsed, code, global), "output of the cached program");
+}
+
+// Snapshots
+// Globals restored from a snapshot hold the values of those saved, and their functions return the same
+
+static void check_snapshot(std::string_view code, int count) {
+   auto file = (std::filesystem::temp_directory_path() / ("cll-consistency-" + std::to_string(getpid()) + ".snap")).string();
+
+   Lexer lexer (code);
+   Parser parser (lexer.lex());
+   Environment global;
+   run(parser.parse(), code, global);
+   snap::save(file, {file, file::hash(code), 0}, global, err::nline);
+
+   Environment restored;
+   snap::restore(file, restored, code, [](const std::string& identifier, const std::string&) {
+      check(false, "module '" + identifier + "' in a snapshot of a program importing none");
+      return NullValue::make(err::nline);
+   });
+   std::filesystem::remove(file);
+
+   std::size_t variables = 0;
+   global.each_variable([&](const std::string& identifier, const Value& value, bool, const Annotation&) {
+      ++variables;
+      if (!restored.variable_exists(identifier)) {
+         check(false, "restored variable '" + identifier + "' is missing");
+         return;
+      }
+
+      auto other = restored.get_variable(identifier, err::nline);
+      if (value->type != other->type) {
+         check(false, "type of restored variable '" + identifier + "'");
+      } else if (value->type == ValueType::fn) {
+         std::string body, other_body;
+         bool stored = cache::write_stmt(body, get_value<Function>(value).body) && cache::write_stmt(other_body, get_value<Function>(other).body);
+         check(stored && body == other_body, "body of restored function '" + identifier + "'");
+      } else {
+         check(value->as_string() == other->as_string(), "value of restored variable '" + identifier + "'");
+      }
+   });
+   std::size_t restored_variables = 0;
+   restored.each_variable([&](const std::string&, const Value&, bool, const Annotation&) {
+      ++restored_variables;
+   });
+   check(restored_variables == variables, "variable count of the restored globals");
+
+   // Functions of the restored globals refer to them
+   mod::Registry modules (std::filesystem::current_path().string());
+   Interpreter interpreter (modules);
+   for (int i = 0; i < count; ++i) {
+      auto n = std::to_string(i);
+      for (auto name : {"step_" + n, "twice_" + n}) {
+         std::vector<Value> args, other_args;
+         args.push_back(NumberValue::make(i % 11, err::nline));
+         other_args.push_back(NumberValue::make(i % 11, err::nline));
+         auto result = interpreter.call_function(global, global.get_variable(name, err::nline), args, err::nline);
+         auto other = interpreter.call_function(restored, restored.get_variable(name, err::nline), other_args, err::nline);
+         check(result->as_string() == other->as_string(), "result of restored function '" + name + "'");
+      }
+   }
+}
+
+int main() {
+   auto code = generate(2 * Lexer::min_chunk_size + Lexer::min_chunk_size / 2);
+   err::set_program_code(code);
+
+   check_lexer(code);
+
+   auto program = generate_program(200);
+   err::set_program_code(program);
+   check_cache(program);
+   check_snapshot(program, 200);
+
+   std::cout << (failures ? "Consistency check failed." : "Consistency check passed.") << '\n';
+   return (failures ? 1 : 0);
+}